@@ -0,0 +1,172 @@
+#include "benchHarness.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace Simp
+{
+	namespace
+	{
+		std::vector<std::unique_ptr<BenchCase>>& getRegistry()
+		{
+			static std::vector<std::unique_ptr<BenchCase>> registry;
+			return registry;
+		}
+
+		std::string formatRate(double perSecond, const char* unit)
+		{
+			const char* prefixes[] = { "", "k", "M", "G", "T" };
+			int prefix = 0;
+			while (perSecond >= 1000.0 && prefix < 4)
+			{
+				perSecond /= 1000.0;
+				prefix++;
+			}
+			std::ostringstream text;
+			text << std::fixed << std::setprecision(2) << perSecond << ' ' << prefixes[prefix] << unit << "/s";
+			return text.str();
+		}
+
+		std::string formatTime(double seconds)
+		{
+			const char* units[] = { "s", "ms", "us", "ns" };
+			int unit = 0;
+			while (seconds < 1.0 && unit < 3)
+			{
+				seconds *= 1000.0;
+				unit++;
+			}
+			std::ostringstream text;
+			text << std::fixed << std::setprecision(2) << seconds << ' ' << units[unit];
+			return text.str();
+		}
+
+		// Grows the iteration count until a run takes minTime, then reports that run.
+		void run(const BenchCase& bench, int64_t size, double minTime)
+		{
+			uint64_t iterations = 1;
+			while (true)
+			{
+				BenchState state(size, iterations);
+				bench.function(state);
+				const double seconds = state.getSeconds();
+				if (seconds >= minTime || iterations >= 1000000000ull)
+				{
+					std::string name = bench.name;
+					if (!bench.sizes.empty())
+						name += '/' + std::to_string(size);
+					std::cout << std::left << std::setw(40) << name << std::right << std::setw(14)
+						<< formatTime(seconds / iterations) << std::setw(12) << iterations;
+					if (state.getItemsProcessed() > 0)
+						std::cout << std::setw(20) << formatRate(state.getItemsProcessed() / seconds, "items");
+					if (state.getBytesProcessed() > 0)
+						std::cout << std::setw(16) << formatRate(state.getBytesProcessed() / seconds, "B");
+					std::cout << std::endl;
+					return;
+				}
+				// Aim a bit past minTime from the last rate, without jumping more than 100x at once.
+				const double scale = seconds > 0.0 ? minTime * 1.4 / seconds : 100.0;
+				iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * std::min(scale, 100.0)));
+			}
+		}
+	}
+
+	BenchState::BenchState(int64_t _arg, uint64_t _iterations) : arg(_arg), iterations(_iterations),
+		remaining(_iterations), started(false), paused(false), elapsed(Clock::duration::zero()), itemsProcessed(0),
+		bytesProcessed(0)
+	{
+	}
+
+	bool BenchState::keepRunning()
+	{
+		if (!started)
+		{
+			started = true;
+			start = Clock::now();
+		}
+		if (remaining == 0)
+		{
+			if (!paused)
+				elapsed += Clock::now() - start;
+			paused = true;
+			return false;
+		}
+		remaining--;
+		return true;
+	}
+
+	void BenchState::pauseTiming()
+	{
+		if (paused)
+			return;
+		elapsed += Clock::now() - start;
+		paused = true;
+	}
+
+	void BenchState::resumeTiming()
+	{
+		if (!paused)
+			return;
+		start = Clock::now();
+		paused = false;
+	}
+
+	BenchCase* BenchCase::args(std::initializer_list<int64_t> values)
+	{
+		for (int64_t value : values)
+		{
+			if (std::find(sizes.begin(), sizes.end(), value) == sizes.end())
+				sizes.push_back(value);
+		}
+		return this;
+	}
+
+	BenchCase* BenchCase::range(int64_t low, int64_t high, int64_t multiplier)
+	{
+		for (int64_t size = low; size <= high; size *= std::max<int64_t>(multiplier, 2))
+			sizes.push_back(size);
+		return this;
+	}
+
+	BenchCase* registerBenchmark(const char* name, void (*function)(BenchState&))
+	{
+		getRegistry().emplace_back(new BenchCase());
+		BenchCase* bench = getRegistry().back().get();
+		bench->name = name;
+		bench->function = function;
+		return bench;
+	}
+}
+
+// CPU microbenchmarks of the engine hot paths, no GL context needed.
+// simp_bench [--filter TEXT] [--min-time SECONDS]
+int main(int argc, char** argv)
+{
+	std::string filter;
+	double minTime = 0.5;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (arg == "--min-time" && i + 1 < argc)
+			minTime = std::atof(argv[++i]);
+	}
+
+	std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(14) << "Time" << std::setw(12)
+		<< "Iterations" << std::setw(20) << "Items" << std::setw(16) << "Bytes" << std::endl;
+	for (const auto& bench : Simp::getRegistry())
+	{
+		if (!filter.empty() && bench->name.find(filter) == std::string::npos)
+			continue;
+		if (bench->sizes.empty())
+			Simp::run(*bench, 0, minTime);
+		for (int64_t size : bench->sizes)
+			Simp::run(*bench, size, minTime);
+	}
+	return EXIT_SUCCESS;
+}
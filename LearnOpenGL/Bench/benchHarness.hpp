@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#define SIMP_BENCH_CONCAT_(a, b) a##b
+#define SIMP_BENCH_CONCAT(a, b) SIMP_BENCH_CONCAT_(a, b)
+// Registers void function(BenchState&), returns the case so sizes can be chained: SIMP_BENCHMARK(f)->range(64, 1 << 16);
+#define SIMP_BENCHMARK(function) \
+	static ::Simp::BenchCase* SIMP_BENCH_CONCAT(benchCase, __LINE__) = ::Simp::registerBenchmark(#function, function)
+
+namespace Simp
+{
+	// Passed to a benchmark function, which loops while keepRunning and reports how much it processed.
+	// The timer covers the loop only, setup before the first keepRunning is free.
+	class BenchState
+	{
+	public:
+		BenchState(int64_t _arg, uint64_t _iterations);
+
+		bool keepRunning();
+		// Excludes per iteration setup from the time.
+		void pauseTiming();
+		void resumeTiming();
+
+		// The size the case runs with, 0 without sizes.
+		int64_t getArg() const { return arg; }
+		uint64_t getIterations() const { return iterations; }
+		// Totals over all iterations, reported per second.
+		void setItemsProcessed(int64_t items) { itemsProcessed = items; }
+		void setBytesProcessed(int64_t bytes) { bytesProcessed = bytes; }
+
+		double getSeconds() const { return std::chrono::duration<double>(elapsed).count(); }
+		int64_t getItemsProcessed() const { return itemsProcessed; }
+		int64_t getBytesProcessed() const { return bytesProcessed; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		int64_t arg;
+		uint64_t iterations;
+		uint64_t remaining;
+		bool started;
+		bool paused;
+		Clock::time_point start;
+		Clock::duration elapsed;
+		int64_t itemsProcessed;
+		int64_t bytesProcessed;
+	};
+
+	struct BenchCase
+	{
+		std::string name;
+		void (*function)(BenchState&);
+		std::vector<int64_t> sizes;
+
+		// Sizes already in the list are skipped.
+		BenchCase* args(std::initializer_list<int64_t> values);
+		// Powers of multiplier from low to high, both included.
+		BenchCase* range(int64_t low, int64_t high, int64_t multiplier = 8);
+	};
+
+	BenchCase* registerBenchmark(const char* name, void (*function)(BenchState&));
+
+	// Keeps the compiler from dropping a result that is never read.
+	template <typename T>
+	inline void doNotOptimize(const T& value)
+	{
+#if defined(_MSC_VER)
+		static const volatile void* sink;
+		sink = &value;
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+}
@@ -0,0 +1,62 @@
+#include "benchScenes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace Simp
+{
+	Camera makeBenchCamera()
+	{
+		Camera camera(glm::vec3(0.0f, 10.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f), 1920, 1080);
+		camera.lookAt(glm::vec3(0.0f, 10.0f, 100.0f), glm::vec3(0.0f));
+		return camera;
+	}
+
+	std::vector<Aabb> makeRandomBoxes(size_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.5f, 4.0f);
+		std::vector<Aabb> boxes(count);
+		for (Aabb& box : boxes)
+		{
+			const glm::vec3 center(position(random), position(random), position(random));
+			const glm::vec3 extent(size(random), size(random), size(random));
+			box = Aabb(center - extent * 0.5f, center + extent * 0.5f);
+		}
+		return boxes;
+	}
+
+	MeshData makeGridMesh(unsigned int side)
+	{
+		MeshData mesh;
+		side = std::max(side, 2u);
+		mesh.vertices.resize(side * side);
+		for (unsigned int y = 0; y < side; y++)
+		{
+			for (unsigned int x = 0; x < side; x++)
+			{
+				const float u = static_cast<float>(x) / (side - 1);
+				const float v = static_cast<float>(y) / (side - 1);
+				Vertex& vertex = mesh.vertices[y * side + x];
+				vertex.position = glm::vec3(u * 10.0f, 0.25f * std::sin(u * 20.0f) * std::cos(v * 20.0f), v * 10.0f);
+				vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+				vertex.uv = glm::vec2(u, v);
+				vertex.tangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+			}
+		}
+
+		mesh.indices.reserve((side - 1) * (side - 1) * 6);
+		for (unsigned int y = 0; y + 1 < side; y++)
+		{
+			for (unsigned int x = 0; x + 1 < side; x++)
+			{
+				const GLuint corner = y * side + x;
+				const GLuint quad[] = { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+		return mesh;
+	}
+}
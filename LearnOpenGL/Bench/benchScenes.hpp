@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "mesh.hpp"
+
+namespace Simp
+{
+	// Synthetic inputs for the benchmarks, the same for a given size and seed on every run.
+
+	// 1920x1080 camera looking at the origin from the edge of the scene.
+	Camera makeBenchCamera();
+	// Boxes of 0.5 to 4 units spread over a 200 unit cube around the origin, about 6 % are in view of the camera.
+	std::vector<Aabb> makeRandomBoxes(size_t count, uint32_t seed = 1);
+	// Wavy grid of side x side vertices with two triangles per cell, in scan order like an unoptimized import.
+	MeshData makeGridMesh(unsigned int side);
+}
@@ -0,0 +1,188 @@
+#include "benchHarness.hpp"
+#include "benchScenes.hpp"
+#include "bvh.hpp"
+#include "culling.hpp"
+
+#include <random>
+
+namespace Simp
+{
+	namespace
+	{
+		CullingBounds makeBounds(size_t count)
+		{
+			CullingBounds bounds;
+			bounds.reserve(count);
+			for (const Aabb& box : makeRandomBoxes(count))
+			{
+				const glm::vec3 center = (box.min + box.max) * 0.5f;
+				bounds.add(center, glm::length(box.max - center), box.min, box.max);
+			}
+			return bounds;
+		}
+
+		template <size_t (*kernel)(const Frustum&, const CullingBounds&, uint8_t*)>
+		void cull(BenchState& state)
+		{
+			const size_t count = static_cast<size_t>(state.getArg());
+			const CullingBounds bounds = makeBounds(count);
+			const Frustum frustum = makeBenchCamera().getFrustum();
+			std::vector<uint8_t> visibility(getVisibilityMaskSize(count));
+			while (state.keepRunning())
+				doNotOptimize(kernel(frustum, bounds, visibility.data()));
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+		}
+
+		void cullingSpheres(BenchState& state) { cull<cullSpheres>(state); }
+		void cullingSpheresScalar(BenchState& state) { cull<cullSpheresScalar>(state); }
+		void cullingBoxes(BenchState& state) { cull<cullBoxes>(state); }
+		void cullingBoxesScalar(BenchState& state) { cull<cullBoxesScalar>(state); }
+
+		void bvhBuild(BenchState& state)
+		{
+			const std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			while (state.keepRunning())
+			{
+				bvh.build(boxes, 1);
+				doNotOptimize(bvh.getNodeCount());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * boxes.size()));
+		}
+
+		void bvhBuildParallel(BenchState& state)
+		{
+			const std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			while (state.keepRunning())
+			{
+				bvh.build(boxes);
+				doNotOptimize(bvh.getNodeCount());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * boxes.size()));
+		}
+
+		void bvhRefit(BenchState& state)
+		{
+			std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			bvh.build(boxes);
+			while (state.keepRunning())
+			{
+				bvh.refit(boxes);
+				doNotOptimize(bvh.getBounds());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * boxes.size()));
+		}
+
+		// Every 100th instance moves, back and forth so the tree does not degrade over the iterations.
+		void bvhRefitPartial(BenchState& state)
+		{
+			std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			bvh.build(boxes);
+			std::vector<uint32_t> moved;
+			for (size_t i = 0; i < boxes.size(); i += 100)
+				moved.push_back(static_cast<uint32_t>(i));
+			glm::vec3 offset(0.5f, 0.0f, 0.5f);
+			while (state.keepRunning())
+			{
+				state.pauseTiming();
+				for (uint32_t instance : moved)
+					boxes[instance] = Aabb(boxes[instance].min + offset, boxes[instance].max + offset);
+				offset = -offset;
+				state.resumeTiming();
+				bvh.refit(boxes, moved);
+				doNotOptimize(bvh.getBounds());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * moved.size()));
+		}
+
+		void bvhQueryFrustum(BenchState& state)
+		{
+			const std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			bvh.build(boxes);
+			const Frustum frustum = makeBenchCamera().getFrustum();
+			std::vector<uint32_t> visible;
+			while (state.keepRunning())
+			{
+				visible.clear();
+				bvh.queryFrustum(frustum, visible);
+				doNotOptimize(visible.size());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * boxes.size()));
+		}
+
+		// Random points inside the 200 unit cube of makeRandomBoxes, the same on every run.
+		std::vector<glm::vec3> makeQueryPoints(size_t count)
+		{
+			std::mt19937 random(2);
+			std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+			std::vector<glm::vec3> points(count);
+			for (glm::vec3& point : points)
+				point = glm::vec3(position(random), position(random), position(random));
+			return points;
+		}
+
+		const size_t QUERY_COUNT = 1024;
+
+		// Rays between two random points, closest hit against the instance boxes.
+		void bvhQueryRay(BenchState& state)
+		{
+			const std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			bvh.build(boxes);
+			const std::vector<glm::vec3> origins = makeQueryPoints(QUERY_COUNT * 2);
+			std::vector<Ray> rays(QUERY_COUNT);
+			for (size_t i = 0; i < QUERY_COUNT; i++)
+			{
+				const glm::vec3 delta = origins[QUERY_COUNT + i] - origins[i];
+				rays[i] = { origins[i], glm::normalize(delta), glm::length(delta) };
+			}
+			while (state.keepRunning())
+			{
+				size_t hits = 0;
+				RayHit hit;
+				for (const Ray& ray : rays)
+					hits += bvh.raycast(ray, hit);
+				doNotOptimize(hits);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * QUERY_COUNT));
+		}
+
+		void bvhQueryNearest(BenchState& state)
+		{
+			const std::vector<Aabb> boxes = makeRandomBoxes(static_cast<size_t>(state.getArg()));
+			Bvh bvh;
+			bvh.build(boxes);
+			const std::vector<glm::vec3> points = makeQueryPoints(QUERY_COUNT);
+			while (state.keepRunning())
+			{
+				uint32_t instance;
+				float distance;
+				float total = 0.0f;
+				for (const glm::vec3& point : points)
+				{
+					if (bvh.nearest(point, instance, distance))
+						total += distance;
+				}
+				doNotOptimize(total);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * QUERY_COUNT));
+		}
+	}
+
+	SIMP_BENCHMARK(cullingSpheres)->range(1 << 10, 1 << 19);
+	SIMP_BENCHMARK(cullingSpheresScalar)->range(1 << 10, 1 << 19);
+	SIMP_BENCHMARK(cullingBoxes)->range(1 << 10, 1 << 19);
+	SIMP_BENCHMARK(cullingBoxesScalar)->range(1 << 10, 1 << 19);
+	// Powers of 8 plus the 10k, 100k and 1M instances the BVH is meant for.
+	SIMP_BENCHMARK(bvhBuild)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+	SIMP_BENCHMARK(bvhBuildParallel)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+	SIMP_BENCHMARK(bvhRefit)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+	SIMP_BENCHMARK(bvhRefitPartial)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+	SIMP_BENCHMARK(bvhQueryFrustum)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+	SIMP_BENCHMARK(bvhQueryRay)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+	SIMP_BENCHMARK(bvhQueryNearest)->range(1 << 10, 1 << 16)->args({ 10000, 100000, 1000000 });
+}
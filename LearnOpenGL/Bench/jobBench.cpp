@@ -0,0 +1,113 @@
+#include "benchHarness.hpp"
+#include "jobSystem.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace Simp
+{
+	namespace
+	{
+		const size_t SCALING_ITEMS = 1 << 18;
+
+		// Enough arithmetic per item that scaling is bound by the cores, not by memory.
+		float work(size_t i)
+		{
+			float value = static_cast<float>(i);
+			for (int j = 0; j < 16; j++)
+				value = std::sqrt(value * 1.0001f + 1.0f);
+			return value;
+		}
+
+		int64_t getMaxThreads()
+		{
+			return std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		// Same work on 1 to all threads, the items/s across the sizes are the scaling curve.
+		void jobScaling(BenchState& state)
+		{
+			std::vector<float> results(SCALING_ITEMS);
+			const unsigned int threads = static_cast<unsigned int>(state.getArg());
+			while (state.keepRunning())
+			{
+				parallelFor(0, SCALING_ITEMS, [&](size_t i) { results[i] = work(i); }, 256, threads);
+				doNotOptimize(results.data());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * SCALING_ITEMS));
+		}
+
+		// Fork and join of a loop too small to be worth splitting, the fixed cost parallelFor adds.
+		void parallelForOverhead(BenchState& state)
+		{
+			std::atomic<size_t> sum(0);
+			const size_t count = static_cast<size_t>(state.getArg());
+			while (state.keepRunning())
+				parallelFor(0, count, [&](size_t i) { sum.fetch_add(i, std::memory_order_relaxed); });
+			doNotOptimize(sum.load());
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+		}
+
+		// Empty jobs from one thread, the workers steal from its deque while it keeps pushing.
+		void jobSpawn(BenchState& state)
+		{
+			JobSystem& jobs = JobSystem::get();
+			const size_t count = static_cast<size_t>(state.getArg());
+			std::vector<JobHandle> handles(count);
+			while (state.keepRunning())
+			{
+				for (size_t i = 0; i < count; i++)
+					handles[i] = jobs.schedule([] {});
+				for (const auto& handle : handles)
+					jobs.wait(handle);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+		}
+
+		// Every thread spawns and waits on empty jobs at once, all deques are pushed and robbed concurrently.
+		void jobContention(BenchState& state)
+		{
+			JobSystem& jobs = JobSystem::get();
+			const unsigned int threads = jobs.getThreadCount();
+			const size_t count = static_cast<size_t>(state.getArg());
+			while (state.keepRunning())
+			{
+				parallelFor(0, threads, [&](size_t)
+				{
+					std::vector<JobHandle> handles(count);
+					for (size_t i = 0; i < count; i++)
+						handles[i] = jobs.schedule([] {});
+					for (const auto& handle : handles)
+						jobs.wait(handle);
+				}, 1, threads);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count * threads));
+		}
+
+		// Each job depends on the previous one, the latency of releasing a continuation.
+		void jobChain(BenchState& state)
+		{
+			JobSystem& jobs = JobSystem::get();
+			const size_t count = static_cast<size_t>(state.getArg());
+			while (state.keepRunning())
+			{
+				JobHandle last;
+				for (size_t i = 0; i < count; i++)
+					last = jobs.schedule([] {}, { last });
+				jobs.wait(last);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+		}
+	}
+
+	// Powers of two plus all cores, which the pool caps at its worker count plus the calling thread.
+	SIMP_BENCHMARK(jobScaling)->range(1, getMaxThreads(), 2)->args({ getMaxThreads() });
+	SIMP_BENCHMARK(parallelForOverhead)->args({ 64, 4096 });
+	SIMP_BENCHMARK(jobSpawn)->range(1 << 6, 1 << 12);
+	SIMP_BENCHMARK(jobContention)->range(1 << 6, 1 << 12);
+	SIMP_BENCHMARK(jobChain)->range(1 << 6, 1 << 12);
+}
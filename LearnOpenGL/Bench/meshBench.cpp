@@ -0,0 +1,90 @@
+#include "benchHarness.hpp"
+#include "benchScenes.hpp"
+#include "meshOptimizer.hpp"
+#include "model.hpp"
+#include "vertexCompression.hpp"
+
+#include <assimp/scene.h>
+
+namespace Simp
+{
+	namespace
+	{
+		// The layout Assimp hands to Model::processMesh after IMPORT_FLAGS, the mesh frees the arrays.
+		void fillImportedMesh(const MeshData& source, aiMesh& mesh)
+		{
+			const unsigned int count = static_cast<unsigned int>(source.vertices.size());
+			mesh.mNumVertices = count;
+			mesh.mVertices = new aiVector3D[count];
+			mesh.mNormals = new aiVector3D[count];
+			mesh.mTangents = new aiVector3D[count];
+			mesh.mBitangents = new aiVector3D[count];
+			mesh.mTextureCoords[0] = new aiVector3D[count];
+			for (unsigned int i = 0; i < count; i++)
+			{
+				const Vertex& vertex = source.vertices[i];
+				mesh.mVertices[i] = aiVector3D(vertex.position.x, vertex.position.y, vertex.position.z);
+				mesh.mNormals[i] = aiVector3D(vertex.normal.x, vertex.normal.y, vertex.normal.z);
+				mesh.mTangents[i] = aiVector3D(vertex.tangent.x, vertex.tangent.y, vertex.tangent.z);
+				mesh.mBitangents[i] = aiVector3D(0.0f, 0.0f, 1.0f);
+				mesh.mTextureCoords[0][i] = aiVector3D(vertex.uv.x, vertex.uv.y, 0.0f);
+			}
+
+			mesh.mNumFaces = static_cast<unsigned int>(source.indices.size() / 3);
+			mesh.mFaces = new aiFace[mesh.mNumFaces];
+			for (unsigned int i = 0; i < mesh.mNumFaces; i++)
+			{
+				aiFace& face = mesh.mFaces[i];
+				face.mNumIndices = 3;
+				face.mIndices = new unsigned int[3];
+				for (unsigned int j = 0; j < 3; j++)
+					face.mIndices[j] = source.indices[i * 3 + j];
+			}
+		}
+
+		void meshConvert(BenchState& state)
+		{
+			aiMesh mesh;
+			fillImportedMesh(makeGridMesh(static_cast<unsigned int>(state.getArg())), mesh);
+			MeshData data;
+			while (state.keepRunning())
+			{
+				data.vertices.clear();
+				data.indices.clear();
+				Model::convertMesh(&mesh, data);
+				doNotOptimize(data.indices.data());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * mesh.mNumVertices));
+			state.setBytesProcessed(static_cast<int64_t>(state.getIterations() * mesh.mNumVertices * sizeof(Vertex)));
+		}
+
+		void meshQuantize(BenchState& state)
+		{
+			const MeshData mesh = makeGridMesh(static_cast<unsigned int>(state.getArg()));
+			std::vector<CompactVertex> compact(mesh.vertices.size());
+			while (state.keepRunning())
+				doNotOptimize(quantizeVertices(mesh.vertices.data(), mesh.vertices.size(), compact.data()));
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * mesh.vertices.size()));
+			state.setBytesProcessed(static_cast<int64_t>(state.getIterations() * mesh.vertices.size() * sizeof(Vertex)));
+		}
+
+		// Vertex cache, overdraw and fetch passes, as run once per imported mesh.
+		void meshOptimize(BenchState& state)
+		{
+			const MeshData source = makeGridMesh(static_cast<unsigned int>(state.getArg()));
+			MeshData mesh;
+			while (state.keepRunning())
+			{
+				state.pauseTiming();
+				mesh = source;
+				state.resumeTiming();
+				doNotOptimize(optimizeMesh(mesh).after.acmr);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * source.indices.size() / 3));
+		}
+	}
+
+	SIMP_BENCHMARK(meshConvert)->range(32, 512, 4);
+	SIMP_BENCHMARK(meshQuantize)->range(32, 512, 4);
+	SIMP_BENCHMARK(meshOptimize)->range(32, 512, 4);
+}
@@ -0,0 +1,100 @@
+#include "benchHarness.hpp"
+#include "benchScenes.hpp"
+#include "renderQueue.hpp"
+#include "world.hpp"
+
+#include <cmath>
+#include <memory>
+#include <random>
+
+namespace Simp
+{
+	namespace
+	{
+		// Packets of a scene with a few dozen programs and a few hundred materials and meshes, in submission order.
+		void renderQueueSort(BenchState& state)
+		{
+			const size_t count = static_cast<size_t>(state.getArg());
+			std::mt19937 random(1);
+			std::uniform_int_distribution<uint32_t> program(0, 31);
+			std::uniform_int_distribution<uint32_t> material(0, 511);
+			std::uniform_int_distribution<uint32_t> mesh(0, 1023);
+			std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+			RenderQueue queue;
+			for (size_t i = 0; i < count; i++)
+			{
+				DrawPacket packet = {};
+				packet.key = RenderQueue::makeKey(0, i % 16 == 0, program(random), material(random), mesh(random), depth(random));
+				packet.object = RenderQueue::NO_OBJECT;
+				queue.submit(packet);
+			}
+			while (state.keepRunning())
+			{
+				queue.sort();
+				doNotOptimize(queue.getStats().sortTime);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+		}
+
+		void cameraMatrices(BenchState& state)
+		{
+			Camera camera = makeBenchCamera();
+			float angle = 0.0f;
+			while (state.keepRunning())
+			{
+				angle += 0.01f;
+				camera.lookAt(glm::vec3(100.0f * std::cos(angle), 10.0f, 100.0f * std::sin(angle)), glm::vec3(0.0f));
+				doNotOptimize(camera.getViewMatrix());
+				doNotOptimize(camera.getProjectionMatrix());
+				doNotOptimize(camera.getFrustum());
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations()));
+		}
+
+		// Spot lights are built with calculateSpotAngle.
+		void lightSpotAngles(BenchState& state)
+		{
+			const size_t count = static_cast<size_t>(state.getArg());
+			std::vector<OtherLight> lights;
+			lights.reserve(count);
+			while (state.keepRunning())
+			{
+				lights.clear();
+				for (size_t i = 0; i < count; i++)
+				{
+					const float outer = 20.0f + (i % 40);
+					lights.emplace_back(glm::vec4(0.0f, 1.0f, 0.0f, 0.1f), glm::vec3(1.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+						outer, outer - 5.0f);
+				}
+				doNotOptimize(lights.back().angles);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+		}
+
+		// An eighth of the lights move every frame, the rest are compared and skipped.
+		void lightPacking(BenchState& state)
+		{
+			const size_t count = static_cast<size_t>(state.getArg());
+			std::vector<std::unique_ptr<OtherLight>> lights;
+			for (size_t i = 0; i < count; i++)
+				lights.emplace_back(new OtherLight(glm::vec4(static_cast<float>(i), 1.0f, 0.0f, 0.1f), glm::vec3(1.0f)));
+			std::vector<glm::vec4> data;
+			std::vector<uint8_t> dirty;
+			World::packLights(lights, data, dirty);
+			size_t frame = 0;
+			while (state.keepRunning())
+			{
+				for (size_t i = frame++ % 8; i < count; i += 8)
+					lights[i]->pos.y += 0.01f;
+				doNotOptimize(World::packLights(lights, data, dirty));
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations() * count));
+			state.setBytesProcessed(static_cast<int64_t>(state.getIterations() * count * sizeof(OtherLight)));
+		}
+	}
+
+	SIMP_BENCHMARK(renderQueueSort)->range(1 << 8, 1 << 16);
+	SIMP_BENCHMARK(cameraMatrices);
+	SIMP_BENCHMARK(lightSpotAngles)->range(1 << 6, 1 << 12);
+	SIMP_BENCHMARK(lightPacking)->range(1 << 6, 1 << 12);
+}
@@ -0,0 +1,79 @@
+#include "benchHarness.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// The engine gets stb_image from learnOpenGL.hpp, included by main.cpp only.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace Simp
+{
+	namespace
+	{
+		// Smooth gradients with some noise, compresses about like a photographic texture.
+		std::vector<unsigned char> makeImage(int side, int channels)
+		{
+			std::vector<unsigned char> pixels(static_cast<size_t>(side) * side * channels);
+			uint32_t noise = 1;
+			for (int y = 0; y < side; y++)
+			{
+				for (int x = 0; x < side; x++)
+				{
+					for (int c = 0; c < channels; c++)
+					{
+						noise = noise * 1664525u + 1013904223u;
+						const float wave = 0.5f + 0.5f * std::sin((x * (c + 1) + y * (3 - c)) * 0.02f);
+						pixels[(static_cast<size_t>(y) * side + x) * channels + c] =
+							static_cast<unsigned char>(wave * 223.0f + (noise >> 27));
+					}
+				}
+			}
+			return pixels;
+		}
+
+		void appendBytes(void* context, void* data, int size)
+		{
+			auto* encoded = static_cast<std::vector<unsigned char>*>(context);
+			encoded->insert(encoded->end(), static_cast<unsigned char*>(data), static_cast<unsigned char*>(data) + size);
+		}
+
+		// Decodes like TextureLoader::decode, from memory so the disk stays out of the numbers.
+		void decode(BenchState& state, const std::vector<unsigned char>& encoded, int side, int channels)
+		{
+			while (state.keepRunning())
+			{
+				int width, height, channelNum;
+				stbi_set_flip_vertically_on_load_thread(1);
+				unsigned char* data = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+					&width, &height, &channelNum, 0);
+				doNotOptimize(data);
+				stbi_image_free(data);
+			}
+			state.setItemsProcessed(static_cast<int64_t>(state.getIterations()) * side * side);
+			state.setBytesProcessed(static_cast<int64_t>(state.getIterations()) * side * side * channels);
+		}
+
+		void textureDecodePng(BenchState& state)
+		{
+			const int side = static_cast<int>(state.getArg());
+			std::vector<unsigned char> encoded;
+			stbi_write_png_to_func(appendBytes, &encoded, side, side, 4, makeImage(side, 4).data(), side * 4);
+			decode(state, encoded, side, 4);
+		}
+
+		void textureDecodeJpeg(BenchState& state)
+		{
+			const int side = static_cast<int>(state.getArg());
+			std::vector<unsigned char> encoded;
+			stbi_write_jpg_to_func(appendBytes, &encoded, side, side, 3, makeImage(side, 3).data(), 90);
+			decode(state, encoded, side, 3);
+		}
+	}
+
+	SIMP_BENCHMARK(textureDecodePng)->range(256, 2048, 2);
+	SIMP_BENCHMARK(textureDecodeJpeg)->range(256, 2048, 2);
+}
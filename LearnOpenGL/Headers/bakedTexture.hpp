@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Block compressed formats are not part of every glad profile.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+	#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+	#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+	#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+namespace Simp
+{
+	// Container written by simp_texbake, layout:
+	//   BakedTextureHeader | BakedMipLevel[mipCount] | mip data, largest level first
+	const uint32_t BAKED_TEXTURE_MAGIC = 0x58455453u; // "STEX"
+	// 2 stopped baking gray with alpha to BC4, which dropped the alpha.
+	const uint32_t BAKED_TEXTURE_VERSION = 2;
+
+	const uint32_t BAKED_FLIPPED = 0x00000001u;
+	const uint32_t BAKED_NORMAL_MAP = 0x00000002u;
+	const uint32_t BAKED_SRGB = 0x00000004u;
+	const uint32_t BAKED_ALPHA = 0x00000008u;
+
+#pragma pack(push, 1)
+	struct BakedTextureHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipCount;
+		uint32_t flags;
+		uint32_t reserved;
+	};
+
+	struct BakedMipLevel
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t size;
+	};
+#pragma pack(pop)
+
+	// The baked file sits next to its source image.
+	inline std::string bakedTexturePath(const std::string& path)
+	{
+		return path + ".stex";
+	}
+}
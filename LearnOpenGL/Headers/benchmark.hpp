@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "camera.hpp"
+
+namespace Simp
+{
+	// Camera keyframes interpolated linearly and looped, recorded from a flight or scripted.
+	// Text file, one keyframe per line: time position.xyz target.xyz
+	class CameraPath
+	{
+	public:
+		struct Keyframe
+		{
+			float time; // in s
+			glm::vec3 position;
+			glm::vec3 target;
+		};
+
+		// A circle around center, one lap per period.
+		static CameraPath orbit(const glm::vec3& center, float radius, float height, float period);
+
+		bool load(const std::string& path);
+		bool save(const std::string& path) const;
+
+		// Times have to increase.
+		void add(float time, const glm::vec3& position, const glm::vec3& target);
+		void apply(Camera& camera, float time) const;
+
+		bool isEmpty() const { return keyframes.empty(); }
+		float getDuration() const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+
+	private:
+		std::vector<Keyframe> keyframes;
+	};
+
+	// Per frame samples of named metrics, reported as percentiles in JSON and compared against a baseline of the same
+	// format. Metrics are kept in the order they were first added.
+	class Benchmark
+	{
+	public:
+		struct Percentiles
+		{
+			double p50;
+			double p95;
+			double p99;
+			double max;
+		};
+
+		void add(const std::string& metric, double value);
+
+		size_t getMetricCount() const { return metrics.size(); }
+		Percentiles getPercentiles(size_t metric) const;
+
+		// An empty path writes to std::cout.
+		bool writeJson(const std::string& path, unsigned int frames, unsigned int warmup) const;
+		// Metrics whose p50, p95 or p99 grew more than tolerance (0.1 is 10 %) over the baseline are regressions,
+		// metrics missing on either side are skipped. Timings, the metrics ending in _ms, are only compared with timings
+		// set, they depend on the machine while the counts do not. Returns the number of regressions, -1 when the
+		// baseline is unreadable.
+		int compare(const std::string& baselinePath, double tolerance, bool timings = false) const;
+
+		static bool isTiming(const std::string& metric);
+
+	private:
+		struct Metric
+		{
+			std::string name;
+			std::vector<double> samples;
+		};
+
+		std::vector<Metric> metrics;
+		std::unordered_map<std::string, size_t> metricIndex;
+	};
+}
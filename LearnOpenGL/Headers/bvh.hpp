@@ -0,0 +1,135 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+#include "frustum.hpp"
+#include "mesh.hpp"
+
+namespace Simp
+{
+	struct Aabb
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+
+		Aabb() : min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max()) {}
+		Aabb(const glm::vec3& _min, const glm::vec3& _max) : min(_min), max(_max) {}
+
+		// Per component so the build loops stay branch free and vectorizable.
+		void grow(const glm::vec3& point)
+		{
+			min.x = std::min(min.x, point.x); min.y = std::min(min.y, point.y); min.z = std::min(min.z, point.z);
+			max.x = std::max(max.x, point.x); max.y = std::max(max.y, point.y); max.z = std::max(max.z, point.z);
+		}
+		void grow(const Aabb& box)
+		{
+			min.x = std::min(min.x, box.min.x); min.y = std::min(min.y, box.min.y); min.z = std::min(min.z, box.min.z);
+			max.x = std::max(max.x, box.max.x); max.y = std::max(max.y, box.max.y); max.z = std::max(max.z, box.max.z);
+		}
+		glm::vec3 center() const { return (min + max) * 0.5f; }
+		float surfaceArea() const
+		{
+			const float x = std::max(max.x - min.x, 0.0f);
+			const float y = std::max(max.y - min.y, 0.0f);
+			const float z = std::max(max.z - min.z, 0.0f);
+			return 2.0f * (x * y + y * z + z * x);
+		}
+	};
+
+	struct Ray
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		float tMax;
+	};
+
+	struct RayHit
+	{
+		uint32_t instance;
+		float t;
+	};
+
+	// Bounding volume hierarchy over instance bounds, built top down with binned SAH.
+	// Instances are identified by their index into the bounds passed to build.
+	class Bvh
+	{
+	public:
+		static const uint32_t INVALID_INSTANCE = 0xffffffffu;
+
+		// Tests a ray that already hit the bounds of an instance against its geometry,
+		// returns false on a miss and otherwise the distance along the ray in t.
+		typedef std::function<bool(uint32_t instance, const Ray& ray, float& t)> RayRefine;
+
+		Bvh() : nodeCount(0) {}
+
+		// The top levels are split serially with binning spread over threads, the subtrees
+		// below are built in parallel (threadCount 0 = all cores).
+		void build(const std::vector<Aabb>& bounds, unsigned int threadCount = 0);
+		// Updates every node after instances moved, the topology stays the same.
+		void refit(const std::vector<Aabb>& bounds);
+		// Only walks up from the leaves of the moved instances.
+		void refit(const std::vector<Aabb>& bounds, const std::vector<uint32_t>& moved);
+
+		void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& instances) const;
+		// Closest hit, against instance bounds unless refine is given.
+		bool raycast(const Ray& ray, RayHit& hit, const RayRefine& refine = RayRefine()) const;
+		// Instance whose bounds are closest to point, distance is 0 inside the bounds.
+		bool nearest(const glm::vec3& point, uint32_t& instance, float& distance,
+					 float maxDistance = std::numeric_limits<float>::max()) const;
+
+		size_t getNodeCount() const { return nodes.size(); }
+		const Aabb& getBounds() const { return nodes[0].bounds; }
+		bool empty() const { return nodes.empty(); }
+
+	private:
+		// Leaves have count > 0 and own indices [first, first + count),
+		// inner nodes have their children at first and first + 1.
+		struct Node
+		{
+			Aabb bounds;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		// Instance data partitioned in place during the build, keeps the accesses sequential.
+		struct Reference
+		{
+			Aabb bounds;
+			glm::vec3 centroid;
+			uint32_t instance;
+		};
+
+		struct Task
+		{
+			uint32_t node;
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		bool split(const Task& task, Task& left, Task& right, unsigned int threadCount);
+		void buildSubtree(const Task& task);
+		void makeLeaf(const Task& task);
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> leaves; // leaf node of every instance
+		std::vector<Aabb> boxes; // of every instance
+		std::vector<Reference> references;
+		std::atomic<uint32_t> nodeCount;
+
+		Bvh(Bvh const&) = delete;
+		Bvh& operator=(Bvh const&) = delete;
+	};
+
+	// Moller-Trumbore against every triangle, ray and vertices in the same space.
+	bool intersectTriangles(const Ray& ray, const Vertex* vertices, const GLuint* indices, size_t indexCount, float& t);
+}
@@ -2,6 +2,8 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "frustum.hpp"
+
 namespace Simp
 {
 	class Camera
@@ -16,10 +18,21 @@ namespace Simp
 		Camera(glm::vec3 position, glm::vec3 yup, int width, int height);
 
 		glm::vec3 getPosition() const { return position; }
+		glm::vec3 getForward() const { return w; }
+		float getVerticalFov() const { return verticalFov; } // in degrees
+		int getWidth() const { return width; }
+		int getHeight() const { return height; }
+		float getAspectRatio() const { return aspectratio; }
+		float getNear() const { return zNear; }
+		float getFar() const { return zFar; }
 		glm::mat4 getViewMatrix() const;
 		glm::mat4 getProjectionMatrix() const;
+		// World space planes of the view frustum.
+		Frustum getFrustum() const;
 
 		void resize(int _width, int _height);
+		// Places the camera and turns it towards target, for scripted paths.
+		void lookAt(const glm::vec3& _position, const glm::vec3& target);
 		void processKeyboard(const glm::vec3& dir, float deltaTime);
 		void processMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
 		void processMouseScroll(float yoffset);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "frustum.hpp"
+
+namespace Simp
+{
+	// Bounding spheres and boxes in structure of arrays layout for the batch culling kernels.
+	// Boxes are stored as center and half extent.
+	class CullingBounds
+	{
+	public:
+		size_t add(const glm::vec3& sphereCenter, float sphereRadius, const glm::vec3& boxMin, const glm::vec3& boxMax);
+		void set(size_t index, const glm::vec3& sphereCenter, float sphereRadius,
+				 const glm::vec3& boxMin, const glm::vec3& boxMax);
+		void reserve(size_t count);
+		void clear();
+
+		size_t size() const { return radius.size(); }
+
+		std::vector<float> sphereX;
+		std::vector<float> sphereY;
+		std::vector<float> sphereZ;
+		std::vector<float> radius;
+		std::vector<float> boxX;
+		std::vector<float> boxY;
+		std::vector<float> boxZ;
+		std::vector<float> extentX;
+		std::vector<float> extentY;
+		std::vector<float> extentZ;
+	};
+
+	// One bit per object, bit i % 8 of byte i / 8 is set when object i is visible.
+	inline size_t getVisibilityMaskSize(size_t count) { return (count + 7) / 8; }
+	inline bool isVisible(const uint8_t* visibility, size_t index) { return (visibility[index >> 3] >> (index & 7)) & 1u; }
+
+	// Test 8 (AVX2) or 4 (SSE2) objects per iteration depending on the instruction set the
+	// build targets, see SIMP_AVX2. Both return the number of visible objects.
+	size_t cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility);
+	size_t cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility);
+
+	// Reference kernels, used on other architectures.
+	size_t cullSpheresScalar(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility);
+	size_t cullBoxesScalar(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility);
+
+	const char* getCullingInstructionSet();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Directory for generated data (baked meshes, program binaries, ...), set by CMake.
+#ifndef SIMP_CACHE_DIR
+	#define SIMP_CACHE_DIR "cache"
+#endif
+
+namespace Simp
+{
+	const uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+	// 64 bit FNV-1a, chain calls by passing the previous result as seed.
+	uint64_t hashBytes(const void* data, size_t size, uint64_t seed = HASH_SEED);
+	uint64_t hashString(const std::string& str, uint64_t seed = HASH_SEED);
+
+	std::string toHex(uint64_t value);
+
+	// Returns SIMP_CACHE_DIR/name and creates the cache directory if needed.
+	std::string cachePath(const std::string& name);
+
+	// Read only memory mapped file.
+	class MappedFile
+	{
+	public:
+		MappedFile() : data(nullptr), size(0), handle(nullptr), mapping(nullptr) {}
+		~MappedFile() { close(); }
+
+		bool open(const std::string& path);
+		void close();
+
+		const unsigned char* getData() const { return data; }
+		size_t getSize() const { return size; }
+		bool isOpen() const { return data != nullptr; }
+
+	private:
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		const unsigned char* data;
+		size_t size;
+		void* handle;
+		void* mapping;
+	};
+}
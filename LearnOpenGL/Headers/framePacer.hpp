@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+
+#include "streamBuffer.hpp"
+
+namespace Simp
+{
+	// Lets the CPU record up to framesInFlight frames ahead of the GPU, with one fence per submitted frame.
+	// beginFrame blocks only when the oldest frame that has to be finished is still on the GPU, unlike a glFinish
+	// every frame. The StreamBuffer rings have FRAMES sections, so they are never written while the GPU reads them.
+	// Zero frames in flight keeps the old behaviour and finishes the GPU at the end of every frame.
+	// A latency bound additionally waits for queued frames older than the bound before the next frame samples input.
+	class FramePacer
+	{
+	public:
+		static const unsigned int MAX_FRAMES_IN_FLIGHT = StreamBuffer::FRAMES;
+
+		struct Stats
+		{
+			unsigned int frames;
+			double frameTime; // in ms, beginFrame to beginFrame
+			double waitTime; // in ms, blocked in beginFrame
+			// Frames still queued on the GPU when a frame begins, before any wait, the overlap of CPU and GPU.
+			double queuedFrames;
+			// Submit of a frame until the CPU saw its fence signaled, in ms, an upper bound of the GPU latency.
+			double latency;
+			unsigned int latencyWaits; // frames that waited because of the latency bound
+		};
+
+		explicit FramePacer(unsigned int framesInFlight = 2, double latencyBound = 0.0);
+		~FramePacer();
+
+		// Clamped to MAX_FRAMES_IN_FLIGHT.
+		void setFramesInFlight(unsigned int _framesInFlight);
+		unsigned int getFramesInFlight() const { return framesInFlight; }
+		// In ms, 0 for no bound.
+		void setLatencyBound(double _latencyBound) { latencyBound = _latencyBound; }
+
+		// Call before the frame samples input and writes any per frame buffer.
+		void beginFrame();
+		// Call after the swap, in place of glFinish.
+		void endFrame();
+
+		// Averages since the last resetStats.
+		Stats getStats() const;
+		void resetStats() { totals = Stats(); retired = 0; }
+
+	private:
+		FramePacer(FramePacer const&) = delete;
+		FramePacer& operator=(FramePacer const&) = delete;
+
+		typedef std::chrono::steady_clock Clock;
+
+		struct Pending
+		{
+			GLsync fence;
+			Clock::time_point submitted;
+		};
+
+		// Waits up to timeout ns for the oldest frame, retires it when signaled.
+		bool retire(GLuint64 timeout);
+
+		unsigned int framesInFlight;
+		double latencyBound;
+		// Ring of submitted frames, oldest first.
+		Pending pending[MAX_FRAMES_IN_FLIGHT];
+		unsigned int first;
+		unsigned int count;
+		Clock::time_point lastBegin;
+		bool started;
+		// Sums, divided by getStats.
+		Stats totals;
+		unsigned int retired;
+	};
+}
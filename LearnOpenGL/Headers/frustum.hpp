@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace Simp
+{
+	// Six inward facing planes (n, d) with dot(n, p) + d >= 0 inside, in the order
+	// left, right, bottom, top, near, far.
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+
+		// Planes of a view projection matrix, normalized so distances are in world units.
+		static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+		// The same frustum in the local space of transform. The planes are not renormalized,
+		// which keeps box tests exact under non uniform scale.
+		Frustum transformed(const glm::mat4& transform) const;
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const
+		{
+			for (int i = 0; i < 6; i++)
+			{
+				if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+					return false;
+			}
+			return true;
+		}
+
+		bool intersectsBox(const glm::vec3& minimum, const glm::vec3& maximum) const
+		{
+			const glm::vec3 center = (minimum + maximum) * 0.5f;
+			const glm::vec3 extent = (maximum - minimum) * 0.5f;
+			for (int i = 0; i < 6; i++)
+			{
+				const glm::vec3 normal(planes[i]);
+				if (glm::dot(normal, center) + planes[i].w < -glm::dot(glm::abs(normal), extent))
+					return false;
+			}
+			return true;
+		}
+	};
+
+	inline Frustum Frustum::fromMatrix(const glm::mat4& m)
+	{
+		const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0;
+		frustum.planes[1] = row3 - row0;
+		frustum.planes[2] = row3 + row1;
+		frustum.planes[3] = row3 - row1;
+		frustum.planes[4] = row3 + row2;
+		frustum.planes[5] = row3 - row2;
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
+	inline Frustum Frustum::transformed(const glm::mat4& transform) const
+	{
+		const glm::mat4 transpose = glm::transpose(transform);
+		Frustum frustum;
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] = transpose * planes[i];
+		return frustum;
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace Simp
+{
+	struct VertexAttribute
+	{
+		GLuint location;
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLuint offset;
+	};
+
+	struct VertexFormat
+	{
+		GLsizei stride;
+		std::vector<VertexAttribute> attributes;
+		// Vertices are stored as CompactVertex and need a per mesh dequantization.
+		bool quantized;
+
+		// Layout of Simp::Vertex.
+		static VertexFormat standard();
+		// Layout of Simp::CompactVertex.
+		static VertexFormat compact();
+	};
+
+	// First fit free list over [0, capacity) with coalescing on free.
+	class RangeAllocator
+	{
+	public:
+		static const size_t INVALID = static_cast<size_t>(-1);
+
+		RangeAllocator() : capacity(0), freeSize(0) {}
+
+		// Marks [0, used) as allocated and the rest as free.
+		void reset(size_t _capacity, size_t used = 0);
+		void grow(size_t _capacity);
+
+		size_t allocate(size_t size);
+		void free(size_t offset, size_t size);
+
+		size_t getCapacity() const { return capacity; }
+		size_t getFreeSize() const { return freeSize; }
+		size_t getLargestFree() const;
+
+	private:
+		std::map<size_t, size_t> freeBlocks;
+		size_t capacity;
+		size_t freeSize;
+	};
+
+	// Suballocates the vertices and indices of every mesh of one vertex format
+	// from a single VBO/EBO pair behind one VAO, meshes are drawn with base vertex draws.
+	// Index ranges are tracked in bytes, meshes with at most 65536 vertices get 16 bit indices.
+	class GeometryArena
+	{
+	public:
+		typedef unsigned int Handle;
+		static const Handle INVALID_HANDLE = static_cast<Handle>(-1);
+
+		struct DrawRange
+		{
+			GLint baseVertex;
+			GLuint firstIndex; // in elements of indexType
+			GLsizei indexCount;
+			GLenum indexType;
+		};
+
+		explicit GeometryArena(const VertexFormat& _format,
+							   size_t vertexCapacity = 1 << 18, size_t indexCapacity = 1 << 20);
+		~GeometryArena();
+
+		// Vertices have to match the arena format.
+		Handle allocate(const void* vertices, GLsizei vertexCount, const GLuint* indices, GLsizei indexCount);
+		void free(Handle handle);
+
+		// Ranges move when the arena is defragmented, resolve them at draw time.
+		DrawRange getDrawRange(Handle handle) const;
+		// Sub range of the indices of an allocation, firstIndex is relative to the allocation.
+		DrawRange getDrawRange(Handle handle, GLuint firstIndex, GLsizei indexCount) const;
+
+		void bind() const;
+		void draw(Handle handle) const;
+		void draw(Handle handle, GLuint firstIndex, GLsizei indexCount) const;
+
+		// Share of free space not usable for the largest allocation, 0 means no fragmentation.
+		float getFragmentation() const;
+		// Compacts every live allocation to the front of the buffers.
+		void defragment();
+		// Defragments once fragmentation passes the threshold, Model calls it after freeing its meshes.
+		bool maybeDefragment(float threshold = 0.5f);
+		// Changes whenever defragment moves the ranges, users that bake ranges compare it to rebuild them.
+		unsigned int getGeneration() const { return generation; }
+
+		const VertexFormat& getFormat() const { return format; }
+		GLuint getVertexArray() const { return vao; }
+		size_t getVertexBytes() const { return (vertices.getCapacity() - vertices.getFreeSize()) * format.stride; }
+		size_t getIndexBytes() const { return indices.getCapacity() - indices.getFreeSize(); }
+
+	private:
+		GeometryArena(GeometryArena const&) = delete;
+		GeometryArena& operator=(GeometryArena const&) = delete;
+
+		struct Allocation
+		{
+			size_t vertexOffset;
+			size_t vertexCount;
+			size_t indexOffset; // in bytes
+			size_t indexCount;
+			size_t indexSize;
+			bool live;
+		};
+
+		void createBuffers(size_t vertexCapacity, size_t indexBytes, GLuint& newVbo, GLuint& newEbo) const;
+		void setupVertexArray();
+		void reserve(size_t vertexCount, size_t indexBytes);
+
+		static size_t getIndexBytes(const Allocation& allocation)
+		{
+			return (allocation.indexCount * allocation.indexSize + 3) & ~static_cast<size_t>(3);
+		}
+		static GLenum getIndexType(const Allocation& allocation)
+		{
+			return allocation.indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		}
+
+		VertexFormat format;
+		GLuint vao;
+		GLuint vbo;
+		GLuint ebo;
+		RangeAllocator vertices;
+		RangeAllocator indices;
+		std::vector<Allocation> allocations;
+		std::vector<Handle> freeHandles;
+		unsigned int generation;
+	};
+}
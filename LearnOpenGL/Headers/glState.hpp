@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glad/glad.h>
+
+namespace Simp
+{
+	// Shadow copy of the GL binding and fixed function state, calls that would not change anything are dropped.
+	// Every engine path binds through it, a raw glBind* elsewhere desynchronizes the copy until invalidate.
+	// Only use it from the GL thread.
+	class GLState
+	{
+	public:
+		static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+		// Calls per frame, issued reached the driver, filtered were no-ops.
+		struct Stats
+		{
+			unsigned int issued;
+			unsigned int filtered;
+			unsigned int programIssued;
+			unsigned int vertexArrayIssued;
+			unsigned int textureIssued;
+			unsigned int capabilityIssued;
+			unsigned int framebufferIssued;
+		};
+
+		static GLState& get();
+
+		// Each returns true when the call was issued.
+		bool useProgram(GLuint program);
+		bool bindVertexArray(GLuint vertexArray);
+		bool activeTexture(unsigned int unit);
+		// Binds to the given unit, making it active if needed.
+		bool bindTexture(unsigned int unit, GLenum target, GLuint texture);
+		// Binds to the active unit, for uploads.
+		bool bindTexture(GLenum target, GLuint texture);
+		bool bindFramebuffer(GLenum target, GLuint framebuffer);
+
+		// GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_STENCIL_TEST and GL_SCISSOR_TEST are cached, other caps pass through.
+		bool setEnabled(GLenum cap, bool enabled);
+		bool enable(GLenum cap) { return setEnabled(cap, true); }
+		bool disable(GLenum cap) { return setEnabled(cap, false); }
+		bool blendFunc(GLenum source, GLenum destination);
+		bool depthFunc(GLenum func);
+		bool depthMask(bool write);
+		bool cullFace(GLenum mode);
+		bool frontFace(GLenum mode);
+		bool viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+		// Deleting a bound object makes GL rebind 0, the copy has to follow.
+		void deleteProgram(GLuint program);
+		void deleteVertexArray(GLuint vertexArray);
+		void deleteTexture(GLuint texture);
+		void deleteFramebuffer(GLuint framebuffer);
+
+		// Forgets everything, the next call of each kind is issued. For state changed behind the layer's back.
+		void invalidate();
+
+		const Stats& getStats() const { return stats; }
+		void resetStats() { stats = Stats(); }
+
+	private:
+		GLState();
+		GLState(GLState const&) = delete;
+		GLState& operator=(GLState const&) = delete;
+
+		enum Capability
+		{
+			BLEND,
+			CULL_FACE,
+			DEPTH_TEST,
+			STENCIL_TEST,
+			SCISSOR_TEST,
+			CAPABILITY_COUNT
+		};
+
+		// Texture targets with a binding per unit in the copy.
+		enum TextureTarget
+		{
+			TEXTURE_2D,
+			TEXTURE_CUBE_MAP,
+			TEXTURE_TARGET_COUNT
+		};
+
+		bool issue(unsigned int& counter);
+		bool filter();
+
+		// UNKNOWN for names and unknown for enums and flags until the first call.
+		static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+		GLuint program;
+		GLuint vertexArray;
+		unsigned int activeUnit;
+		GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+		GLuint drawFramebuffer;
+		GLuint readFramebuffer;
+		// -1 unknown, 0 disabled, 1 enabled.
+		int capabilities[CAPABILITY_COUNT];
+		GLenum blendSource;
+		GLenum blendDestination;
+		GLenum depthFunction;
+		int depthWrite;
+		GLenum cullMode;
+		GLenum frontMode;
+		GLint viewportRect[4];
+		Stats stats;
+	};
+}
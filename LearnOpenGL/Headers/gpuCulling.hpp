@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "camera.hpp"
+#include "geometryArena.hpp"
+#include "instanceBatch.hpp"
+#include "lodSelector.hpp"
+#include "model.hpp"
+#include "renderQueue.hpp"
+#include "shader.hpp"
+#include "shaderVariants.hpp"
+
+namespace Simp
+{
+	// GPU driven culling of many instances of one model with cull.comp.
+	// Instances and mesh records are uploaded once. Every frame a compute pass tests each instance against
+	// the frustum, picks the level of detail and appends it to the DrawElementsIndirectCommand of its mesh
+	// and level, a second pass compacts the commands and writes the draw count per mesh.
+	// Every mesh is then one multi draw indirect packet, the CPU cost does not depend on the instance count.
+	class GpuCulling
+	{
+	public:
+		static const unsigned int MAX_LODS = 8;
+		// Shader storage bindings of cull.comp, the INDIRECT vertex shaders read the instances as well.
+		static const GLuint INSTANCES_BINDING = 4;
+		static const GLuint MESHES_BINDING = 5;
+		static const GLuint COMMANDS_BINDING = 6;
+		static const GLuint OUTPUT_BINDING = 7;
+		// Vertex attribute with the instance index, added to the vertex array of the arena.
+		static const GLuint INSTANCE_ATTRIBUTE = 4;
+
+		// The ranges of the meshes are baked into the commands, which are rebuilt when the arena defragments.
+		GpuCulling(const Model& model, const GeometryArena& arena, const std::vector<InstanceData>& instances);
+		~GpuCulling();
+
+		// Dispatches both passes for the camera, call before the queue executes. Rewrites the commands first
+		// when the arena moved the ranges since the last call.
+		void cull(const Camera& camera, const LodSelector& selector);
+		// Queues one indirect packet per mesh with the INSTANCED | INDIRECT variant of its maps.
+		void submit(RenderQueue& queue, ShaderVariants& variants);
+
+		size_t getInstanceCount() const { return instanceCount; }
+		size_t getCommandCount() const { return commandCount; }
+
+	private:
+		GpuCulling(GpuCulling const&) = delete;
+		GpuCulling& operator=(GpuCulling const&) = delete;
+
+		// std430 layout of Mesh in cull.comp.
+		struct MeshRecord
+		{
+			glm::vec4 boxCenter;
+			glm::vec4 boxExtent;
+			glm::vec4 sphere; // radius in w
+			uint32_t firstCommand;
+			uint32_t lodCount;
+			uint32_t padding[2];
+			float errors[MAX_LODS];
+		};
+
+		// DrawElementsIndirectCommand
+		struct Command
+		{
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+
+		// One command per level of every mesh with its current range in the arena, no instances yet.
+		std::vector<Command> makeCommands() const;
+
+		const Model& model;
+		const GeometryArena& arena;
+		unsigned int arenaGeneration;
+		Shader cullShader;
+		Shader compactShader;
+		Shader::Uniform planes[6];
+		GLuint instanceBuffer;
+		GLuint meshBuffer;
+		GLuint commandBuffer;
+		GLuint visibleBuffer;
+		// Draw counts of the meshes followed by the compacted commands.
+		GLuint drawBuffer;
+		std::vector<IndirectDraw> draws;
+		size_t instanceCount;
+		size_t commandCount;
+	};
+}
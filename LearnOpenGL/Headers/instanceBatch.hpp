@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "renderQueue.hpp"
+#include "streamBuffer.hpp"
+
+namespace Simp
+{
+	// Per instance data, std430 layout of the Instances block in Shaders/instancing.glsl.
+	struct InstanceData
+	{
+		glm::mat4 model;
+		// Columns of the normal matrix, w unused.
+		glm::vec4 normalMatrix[3];
+		// Free for the shader, e.g. a color.
+		glm::vec4 parameters;
+
+		static InstanceData make(const glm::mat4& model, const glm::vec4& parameters = glm::vec4(1.0f));
+	};
+
+	// Collects instances of repeated draws for a frame and turns every distinct draw into one instanced packet.
+	// Packets that share shader, material, vertex array, state and range are merged, the shader has to be an
+	// INSTANCED variant that reads the instance with instanceOffset + gl_InstanceID from INSTANCES_BINDING.
+	class InstanceBatch
+	{
+	public:
+		static const GLuint INSTANCES_BINDING = 3;
+
+		struct Stats
+		{
+			size_t instances;
+			unsigned int draws;
+			size_t bytes;
+		};
+
+		explicit InstanceBatch(size_t capacity = 1024);
+
+		// The packet is the template of the draw, its object carries the uniforms shared by all instances.
+		void add(const DrawPacket& packet, const InstanceData& instance);
+
+		// Uploads the instances of the frame and submits one instanced packet per draw.
+		void submit(RenderQueue& queue);
+		// Drops the instances, keeps the draws and the memory.
+		void clear();
+
+		// Of the last submit.
+		const Stats& getStats() const { return stats; }
+
+	private:
+		InstanceBatch(InstanceBatch const&) = delete;
+		InstanceBatch& operator=(InstanceBatch const&) = delete;
+
+		struct Draw
+		{
+			DrawPacket packet;
+			std::vector<InstanceData> instances;
+		};
+
+		static uint64_t hashPacket(const DrawPacket& packet);
+		static bool isSameDraw(const DrawPacket& a, const DrawPacket& b);
+
+		std::vector<Draw> draws;
+		// Packet hash to the draws with that hash.
+		std::unordered_multimap<uint64_t, size_t> lookup;
+		size_t lastDraw;
+		StreamBuffer buffer;
+		Stats stats;
+	};
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Simp
+{
+	struct Job;
+
+	enum class JobLane
+	{
+		Any, // any worker, or a thread waiting on a job
+		Main // only the GL thread, in runMainThreadJobs or while it waits
+	};
+
+	// Refers to a scheduled job, a default constructed handle counts as done.
+	class JobHandle
+	{
+	public:
+		JobHandle() {}
+
+		bool isDone() const;
+
+	private:
+		friend class JobSystem;
+
+		explicit JobHandle(std::shared_ptr<Job> _job) : job(std::move(_job)) {}
+
+		std::shared_ptr<Job> job;
+	};
+
+	// The engine's worker threads, each with its own deque. A thread pops its newest job, idle threads steal the
+	// oldest job of another deque, so split work spreads out in big pieces and stays warm where it was split.
+	// Jobs may depend on other jobs and only start once those are done, wait() runs other jobs instead of blocking.
+	// The first call to get() has to come from the GL thread, it becomes the main thread with its own deque.
+	class JobSystem
+	{
+	public:
+		struct Stats
+		{
+			uint64_t executed; // jobs run by the workers and the main thread
+			uint64_t stolen; // of those, jobs taken from another thread's deque
+		};
+
+		// Hardware threads minus the main thread, overridden by the SIMP_JOB_THREADS variable.
+		// With zero workers jobs only run while the main thread waits.
+		static unsigned int defaultWorkerCount();
+
+		static JobSystem& get();
+
+		JobHandle schedule(std::function<void()> function, JobLane lane = JobLane::Any);
+		// Runs once every dependency is done, the continuation of each of them.
+		JobHandle schedule(std::function<void()> function, std::initializer_list<JobHandle> dependencies,
+			JobLane lane = JobLane::Any);
+		JobHandle schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies,
+			JobLane lane = JobLane::Any);
+
+		// Runs other jobs until job is done. A worker waiting on a Main job spins until the main thread runs it.
+		void wait(const JobHandle& job);
+		// Call on the main thread once per frame, runs the Main jobs queued so far and returns how many.
+		size_t runMainThreadJobs();
+
+		unsigned int getWorkerCount() const { return workerCount; }
+		// Workers plus the main thread.
+		unsigned int getThreadCount() const { return workerCount + 1; }
+		bool isMainThread() const { return std::this_thread::get_id() == mainThread; }
+
+		// Totals since the start.
+		Stats getStats() const;
+
+	private:
+		JobSystem();
+		~JobSystem();
+		JobSystem(JobSystem const&) = delete;
+		JobSystem& operator=(JobSystem const&) = delete;
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<std::shared_ptr<Job>> jobs;
+			// Lets thieves skip empty deques without locking them.
+			std::atomic<size_t> size;
+			std::atomic<uint64_t> executed;
+			std::atomic<uint64_t> stolen;
+		};
+
+		JobHandle create(std::function<void()>& function, const JobHandle* dependencies, size_t count, JobLane lane);
+		// Drops one blocker of job, queues it when none are left.
+		void release(const std::shared_ptr<Job>& job);
+		void push(const std::shared_ptr<Job>& job);
+		// The own deque first, then the others, index is NO_QUEUE on threads outside the system.
+		std::shared_ptr<Job> findJob(unsigned int index);
+		void execute(const std::shared_ptr<Job>& job, unsigned int index);
+		void work(unsigned int index);
+
+		unsigned int workerCount;
+		std::thread::id mainThread;
+		// 0 belongs to the main thread, 1 to workerCount to the workers.
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		std::mutex mainMutex;
+		std::deque<std::shared_ptr<Job>> mainJobs;
+		// Jobs in the deques, idle workers sleep while it is zero.
+		std::atomic<size_t> queued;
+		std::atomic<unsigned int> sleeping;
+		std::atomic<unsigned int> nextQueue;
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		bool stopping;
+	};
+}
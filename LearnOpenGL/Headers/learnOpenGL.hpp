@@ -20,5 +20,7 @@
 
 const int cWindowWidth = 1920;
 const int cWindowHeight = 1080;
+// Store model geometry as Simp::CompactVertex instead of Simp::Vertex.
+const bool cCompactVertices = true;
 
 #endif
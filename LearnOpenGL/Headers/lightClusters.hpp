@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "camera.hpp"
+#include "streamBuffer.hpp"
+
+namespace Simp
+{
+	struct OtherLight;
+
+	// Froxel grid over the view frustum: screen space tiles times exponential depth slices.
+	// Point and spot lights are binned into the clusters on the CPU, phong.frag reads the
+	// per cluster (offset, count) grid and the flat light index list from SSBOs.
+	class LightClusters
+	{
+	public:
+		static const unsigned int TILES_X = 16;
+		static const unsigned int TILES_Y = 9;
+		static const unsigned int SLICES = 24;
+		static const unsigned int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+		// Shader storage binding points used by phong.frag.
+		static const GLuint LIGHTS_BINDING = 0;
+		static const GLuint GRID_BINDING = 1;
+		static const GLuint INDICES_BINDING = 2;
+
+		struct Stats
+		{
+			size_t lightCount;
+			size_t indexCount;
+			unsigned int maxLightsPerCluster;
+			float averageLightsPerCluster; // over clusters with at least one light
+			double buildTime; // in ms
+		};
+
+		explicit LightClusters(unsigned int _threadCount = 0);
+		~LightClusters();
+
+		// Assigns the world space lights to the clusters of the camera, CPU only.
+		void build(const Camera& camera, const std::vector<std::unique_ptr<OtherLight>>& lights);
+		// Uploads the grid and the index list and binds them.
+		void upload();
+		// Bytes written and GL calls made since the last call.
+		StreamBuffer::Stats getUploadStats();
+
+		// Tile size in pixels (xy) and slice = log(depth) * z + w.
+		glm::vec4 getParameters() const { return parameters; }
+		const std::vector<glm::uvec2>& getGrid() const { return grid; }
+		const std::vector<uint32_t>& getIndices() const { return indices; }
+		const Stats& getStats() const { return stats; }
+
+	private:
+		LightClusters(LightClusters const&) = delete;
+		LightClusters& operator=(LightClusters const&) = delete;
+
+		// Light in view space with the depth and slice range it touches.
+		struct ViewLight
+		{
+			glm::vec3 center;
+			float radius;
+			glm::vec3 dir;
+			float cosOuter; // <= 0 for point lights and wide spots, culled as spheres
+			float sinOuter;
+			float depthMin;
+			float depthMax;
+			int sliceMin;
+			int sliceMax;
+		};
+
+		void updateClusterBounds(const Camera& camera);
+		// Conservative screen tiles of the light between two view depths, false when off screen.
+		bool getTileRange(const ViewLight& light, float depthMin, float depthMax, int tileMin[2], int tileMax[2]) const;
+		bool intersects(const ViewLight& light, unsigned int cluster) const;
+
+		unsigned int threadCount;
+		glm::vec4 parameters;
+		// Projection the cluster bounds were built for.
+		glm::vec4 projection;
+		glm::ivec2 viewport;
+		float tangents[2];
+		float sliceDepths[SLICES + 1];
+		std::vector<glm::vec3> clusterMin;
+		std::vector<glm::vec3> clusterMax;
+		// Bounding spheres of the clusters for the spot light cone test, radius in w.
+		std::vector<glm::vec4> clusterSpheres;
+
+		std::vector<ViewLight> viewLights;
+		// One bit per light for every cluster, rows of maskWords words.
+		std::vector<uint64_t> masks;
+		size_t maskWords;
+		std::vector<glm::uvec2> grid;
+		std::vector<uint32_t> indices;
+		Stats stats;
+
+		StreamBuffer gridBuffer;
+		StreamBuffer indexBuffer;
+	};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+#include "camera.hpp"
+#include "mesh.hpp"
+
+namespace Simp
+{
+	// Picks levels of detail from the screen space size of their error.
+	// With a triangle budget the pixel threshold adapts from frame to frame to stay within it.
+	class LodSelector
+	{
+	public:
+		explicit LodSelector(float _pixelError = 1.0f, float _hysteresis = 0.25f, size_t _triangleBudget = 0);
+
+		// Call once per frame before selecting.
+		void update(const Camera& camera);
+
+		// Coarsest level whose error projects below the threshold at the distance of the bounding sphere.
+		// Switching to a coarser level than current needs an extra hysteresis margin to avoid popping.
+		// The sphere is in world space, errorScale takes the level errors there as well.
+		unsigned int select(const std::vector<LodLevel>& lods, const glm::vec3& center, float radius,
+							float errorScale, unsigned int current);
+
+		void setTriangleBudget(size_t budget) { triangleBudget = budget; }
+		float getPixelError() const { return threshold; }
+		float getPixelsPerUnit() const { return pixelsPerUnit; }
+		size_t getTriangleCount() const { return triangles; }
+
+	private:
+		glm::vec3 cameraPosition;
+		float pixelsPerUnit; // at unit distance
+		float pixelError;
+		float threshold;
+		float hysteresis;
+		size_t triangleBudget;
+		size_t triangles;
+	};
+}
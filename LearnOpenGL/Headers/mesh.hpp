@@ -4,6 +4,8 @@
 
 #include <vector>
 #include "shader.hpp"
+#include "geometryArena.hpp"
+#include "renderQueue.hpp"
 
 namespace Simp
 {
@@ -17,6 +19,10 @@ namespace Simp
 	const unsigned int DIFFUSE = 0x00000001u;
 	const unsigned int SPECULAR = 0x00000002u;
 	const unsigned int NORMAL = 0x00000004u;
+	// Shader variant bit of the instanced vertex path, after the map bits.
+	const unsigned int INSTANCED = 0x00000008u;
+	// With INSTANCED, the instance index comes from the GPU culling output, see GpuCulling.
+	const unsigned int INDIRECT = 0x00000010u;
 
 #pragma pack(push, 1)
 	struct Vertex
@@ -24,8 +30,7 @@ namespace Simp
 		glm::vec3 position;
 		glm::vec3 normal;
 		glm::vec2 uv;
-		glm::vec3 tangent;
-		glm::vec3 bitangent;
+		glm::vec4 tangent; // w is the bitangent sign
 	};
 #pragma pack(pop)
 
@@ -38,27 +43,69 @@ namespace Simp
 	};
 #pragma pack(pop)
 
-	class Mesh
+	// Range of a level of detail in the index list of a mesh, all levels share the vertices.
+	struct LodLevel
 	{
-	public:
-		GLuint vao;
-		GLuint vbo;
-		GLuint ebo;
+		GLuint indexOffset;
+		GLuint indexCount;
+		float error; // in model units
+	};
 
+	// CPU side mesh as produced by the importer, textures only carry type and path.
+	struct MeshData
+	{
 		std::vector<Vertex> vertices;
 		std::vector<GLuint> indices;
 		std::vector<Texture> textures;
+		std::vector<LodLevel> lods;
+	};
+
+	// Lightweight record of a range in a GeometryArena, the arena VAO has to be bound before drawing.
+	class Mesh
+	{
+	public:
+		GeometryArena& arena;
+		GeometryArena::Handle allocation;
+		GLsizei indexCount;
+		// Maps quantized positions back into model space, only used with a compact arena.
+		glm::vec3 positionScale;
+		glm::vec3 positionOffset;
+		// Bounding sphere and box in model space.
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+
+		std::vector<Texture> textures;
+		// Textures with their sampler uniforms, maps holds the texture types present and selects the shader variant.
+		Material material;
+		std::vector<LodLevel> lods;
+		// Level drawn last, the LOD selector uses it for hysteresis.
+		unsigned int currentLod;
 
-		Mesh(const std::vector<Vertex>& _vertices,
+		// Without levels the whole index list is level 0.
+		Mesh(GeometryArena& _arena,
+			 const std::vector<Vertex>& _vertices,
 			 const std::vector<GLuint>& _indices,
-			 const std::vector<Texture>& _textures);
+			 const std::vector<Texture>& _textures,
+			 const std::vector<LodLevel>& _lods = std::vector<LodLevel>());
+		Mesh(GeometryArena& _arena,
+			 const Vertex* _vertices, GLsizei vertexCount,
+			 const GLuint* _indices, GLsizei _indexCount,
+			 const std::vector<Texture>& _textures,
+			 const std::vector<LodLevel>& _lods = std::vector<LodLevel>());
 
 		~Mesh()
 		{
-			glDeleteVertexArrays(1, &vao);
+			arena.free(allocation);
 		}
 
-		void draw(Shader& shader);
+		// Queues a draw of the level with the object uniforms, depth is the normalized view depth.
+		void submit(RenderQueue& queue, Shader& shader, uint32_t object, unsigned int lod, float depth) const;
+		// Index range of the level in the arena buffers.
+		GeometryArena::DrawRange getDrawRange(unsigned int lod) const;
+		// Packet of that draw without submitting it, e.g. as the template of an instanced draw.
+		DrawPacket makePacket(Shader& shader, uint32_t object, unsigned int lod, float depth) const;
 
 	private:
 		// Disable Copying and Assignment
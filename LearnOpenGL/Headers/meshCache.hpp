@@ -0,0 +1,78 @@
+#pragma once
+
+#include "fileCache.hpp"
+#include "mesh.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Simp
+{
+	// Pointers into a mapped cache file, valid while the MeshCache is open.
+	struct MeshView
+	{
+		const Vertex* vertices;
+		GLsizei vertexCount;
+		const GLuint* indices;
+		GLsizei indexCount;
+		std::vector<Texture> textures;
+		std::vector<LodLevel> lods;
+	};
+
+	// Binary mesh cache, layout:
+	//   Header | (Record | TextureEntry* | LodEntry*)* | 16 byte aligned vertex and index blobs
+	class MeshCache
+	{
+	public:
+		static const uint32_t MAGIC = 0x48534d53u; // "SMSH"
+		static const uint32_t VERSION = 5;
+
+		// Key of a source asset, bump VERSION whenever the import pipeline changes.
+		static uint64_t key(const MappedFile& source, unsigned int importFlags);
+		static bool write(const std::string& path, uint64_t key, const std::vector<MeshData>& meshes);
+
+		// Maps the file and validates it against the expected key.
+		bool open(const std::string& path, uint64_t key);
+
+		const std::vector<MeshView>& getMeshes() const { return meshes; }
+
+	private:
+#pragma pack(push, 1)
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key;
+			uint32_t meshCount;
+			uint32_t vertexSize;
+			uint64_t fileSize;
+		};
+
+		struct Record
+		{
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint64_t vertexOffset;
+			uint64_t indexOffset;
+			uint32_t textureCount;
+			uint32_t lodCount;
+		};
+
+		struct TextureEntry
+		{
+			uint32_t type;
+			uint32_t pathLength;
+		};
+
+		struct LodEntry
+		{
+			uint32_t indexOffset;
+			uint32_t indexCount;
+			float error;
+		};
+#pragma pack(pop)
+
+		MappedFile file;
+		std::vector<MeshView> meshes;
+	};
+}
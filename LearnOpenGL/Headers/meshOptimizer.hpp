@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+#include "mesh.hpp"
+
+namespace Simp
+{
+	// Size of the FIFO post-transform cache the optimizer targets and simulates.
+	const unsigned int VERTEX_CACHE_SIZE = 16;
+
+	struct VertexCacheStats
+	{
+		float acmr; // transformed vertices per triangle
+		float atvr; // transformed vertices per referenced vertex
+	};
+
+	struct MeshOptimizationStats
+	{
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
+	VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount,
+										unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+	// Tipsify (Sander et al. 2007), reorders triangles for the post-transform cache.
+	// Appends the first triangle of every cluster that starts after a dead end to clusters.
+	void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount,
+							 unsigned int cacheSize = VERTEX_CACHE_SIZE, std::vector<size_t>* clusters = nullptr);
+
+	// Splits the cache ordered triangles into clusters whose ACMR stays within threshold times
+	// the mesh ACMR, then sorts the clusters outside in so front faces tend to be drawn first.
+	void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices,
+						  const std::vector<size_t>& clusters, float threshold = 1.05f,
+						  unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+	// Orders vertices by first use and drops unreferenced ones.
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	// Runs all passes above in order.
+	MeshOptimizationStats optimizeMesh(MeshData& mesh);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+#include "mesh.hpp"
+
+namespace Simp
+{
+	const unsigned int MAX_LOD_LEVELS = 5;
+	// Levels below this many triangles are not generated.
+	const size_t MIN_LOD_TRIANGLES = 32;
+
+	// Quadric error simplification through half edge collapses down to about targetIndexCount.
+	// Vertices on UV or normal seams and on open borders never move, so seams stay intact.
+	// error receives the largest collapse error in model units.
+	std::vector<GLuint> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+									 size_t targetIndexCount, float* error = nullptr);
+
+	// Appends up to maxLevels - 1 levels with about half the triangles of the previous one
+	// to mesh.indices and fills mesh.lods, level 0 is the mesh itself.
+	void generateLods(MeshData& mesh, unsigned int maxLevels = MAX_LOD_LEVELS);
+}
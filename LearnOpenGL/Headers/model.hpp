@@ -10,31 +10,78 @@
 #endif
 
 #include "shader.hpp"
+#include "camera.hpp"
+#include "culling.hpp"
+#include "instanceBatch.hpp"
+#include "lodSelector.hpp"
 #include "mesh.hpp"
+#include "shaderVariants.hpp"
+#include "textureLoader.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace Simp
 {
-	unsigned int loadTexture(const std::string& path, bool flip);
-
 	class Model
 	{
 	public:
-		Model(const std::string& path);
+		// Without JoinIdenticalVertices OBJ faces get their own corners and the vertex cache has nothing to reuse.
+		static const unsigned int IMPORT_FLAGS =
+			aiProcess_JoinIdenticalVertices |
+			aiProcess_GenSmoothNormals |
+			aiProcess_CalcTangentSpace |
+			aiProcess_Triangulate |
+			aiProcess_FlipUVs;
+
+		// The first import is baked to SIMP_CACHE_DIR, later loads map the baked file instead.
+		// Textures are requested from the loader, flush it before the first draw.
+		// Geometry is suballocated from the arena, which has to outlive the model.
+		Model(const std::string& path, GeometryArena& _arena, TextureLoader& loader, bool useCache = true);
 		~Model();
 
-		void draw(Shader& shader);
+		// Queues the meshes whose boxes intersect the frustum at the level picked by the selector,
+		// transform places the model in the world.
+		void submit(RenderQueue& queue, ShaderVariants& variants, LodSelector& selector, const glm::mat4& transform,
+					const Frustum& frustum, const Camera& camera);
+		// Adds the visible meshes of every instance to the batch with the INSTANCED variants,
+		// levels are picked per instance. The objects of the meshes go to the queue.
+		void submit(InstanceBatch& batch, RenderQueue& queue, ShaderVariants& variants, LodSelector& selector,
+					const std::vector<InstanceData>& instances, const Frustum& frustum);
+
+		size_t getMeshCount() const { return meshes.size(); }
+		const std::vector<std::unique_ptr<Mesh>>& getMeshes() const { return meshes; }
+		// Meshes store CompactVertex and need positionScale and positionOffset.
+		bool isQuantized() const { return arena.getFormat().quantized; }
+		size_t getVisibleMeshCount() const { return visibleMeshes; }
+
+		double getLoadTime() const { return loadTime; }
+		bool isLoadedFromCache() const { return loadedFromCache; }
+
+		// Vertices and indices of an imported mesh, which has to be triangulated with tangents.
+		static void convertMesh(const aiMesh* mesh, MeshData& data);
+
 	private:
+		GeometryArena& arena;
 		std::vector<std::unique_ptr<Mesh>> meshes;
-		std::vector<Texture> texturesLoaded;
+		CullingBounds bounds; // of the meshes, in model space
+		std::vector<uint8_t> visibility;
+		size_t visibleMeshes;
+		std::vector<GLuint> textureReferences;
 		std::string directory;
+		double loadTime;
+		bool loadedFromCache;
 
-		void processNode(const aiNode* node, const aiScene* scene);
-		void processMesh(const aiMesh* mesh, const aiScene* scene);
+		// Culls the meshes into visibility and picks the level of every visible mesh.
+		void selectLods(LodSelector& selector, const glm::mat4& transform, const Frustum& frustum);
+		bool import(const std::string& path, std::vector<MeshData>& data);
+		void processNode(const aiNode* node, const aiScene* scene, std::vector<MeshData>& data);
+		void processMesh(const aiMesh* mesh, const aiScene* scene, MeshData& data);
 
-		std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType aiType, TextureType type);
+		void collectMaterialTextures(const aiMaterial* mat, aiTextureType aiType, TextureType type,
+									 std::vector<Texture>& textures) const;
+		std::vector<Texture> loadMaterialTextures(const std::vector<Texture>& references, TextureLoader& loader);
 
 		Model(Model const&) = delete;
 		Model& operator=(Model const&) = delete;
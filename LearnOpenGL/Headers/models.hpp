@@ -210,7 +210,7 @@ namespace Simp
 		GLuint vbo;
 
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		GLState::get().bindVertexArray(vao);
 
 		glGenBuffers(1, &vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -224,7 +224,7 @@ namespace Simp
 		glEnableVertexAttribArray(1);
 		glEnableVertexAttribArray(2);
 		glEnableVertexAttribArray(3);
-		glBindVertexArray(0);
+		GLState::get().bindVertexArray(0);
 		glDeleteBuffers(1, &vbo);
 		return vao;
 	}
@@ -235,7 +235,7 @@ namespace Simp
 		GLuint vao;
 
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		GLState::get().bindVertexArray(vao);
 
 		glGenBuffers(1, &vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -243,7 +243,7 @@ namespace Simp
 
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(0);
-		glBindVertexArray(0);
+		GLState::get().bindVertexArray(0);
 		glDeleteBuffers(1, &vbo);
 		return vao;
 	}
@@ -254,7 +254,7 @@ namespace Simp
 		GLuint vbo;
 
 		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		GLState::get().bindVertexArray(vao);
 
 		glGenBuffers(1, &vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -264,7 +264,7 @@ namespace Simp
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 		glEnableVertexAttribArray(1);
-		glBindVertexArray(0);
+		GLState::get().bindVertexArray(0);
 		glDeleteBuffers(1, &vbo);
 		return vao;
 	}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "jobSystem.hpp"
+
+namespace Simp
+{
+	// Calls fn(i) for every i in [begin, end) on up to threadCount threads of the job system (0 = all of them).
+	// Threads claim chunks from a shared counter, the caller takes part too. Claims start at a share of what is left
+	// and shrink down to grain towards the end, so few claims are made and the last ones still balance the load.
+	template<typename Function>
+	void parallelFor(size_t begin, size_t end, Function fn, size_t grain = 1, unsigned int threadCount = 0)
+	{
+		if (begin >= end)
+			return;
+
+		grain = std::max<size_t>(grain, 1);
+		JobSystem& jobs = JobSystem::get();
+		if (threadCount == 0)
+			threadCount = jobs.getThreadCount();
+		const size_t chunks = (end - begin + grain - 1) / grain;
+		threadCount = static_cast<unsigned int>(std::min<size_t>(threadCount, chunks));
+		if (threadCount <= 1)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				fn(i);
+			}
+			return;
+		}
+
+		std::atomic<size_t> next(begin);
+		auto run = [&]()
+		{
+			size_t first = next.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				size_t size;
+				do
+				{
+					if (first >= end)
+						return;
+					size = std::max<size_t>((end - first) / (2 * threadCount) / grain, 1) * grain;
+				} while (!next.compare_exchange_weak(first, first + size, std::memory_order_relaxed));
+
+				const size_t last = std::min(first + size, end);
+				for (size_t i = first; i < last; i++)
+				{
+					fn(i);
+				}
+				first = next.load(std::memory_order_relaxed);
+			}
+		};
+
+		// Helpers that start after the range is claimed return right away.
+		std::vector<JobHandle> helpers;
+		helpers.reserve(threadCount - 1);
+		for (unsigned int i = 1; i < threadCount; i++)
+		{
+			helpers.push_back(jobs.schedule([&run] { run(); }));
+		}
+		run();
+		for (const auto& helper : helpers)
+		{
+			jobs.wait(helper);
+		}
+	}
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Builds without SIMP_PROFILER compile the scopes out entirely.
+#ifndef SIMP_PROFILER
+	#define SIMP_PROFILER 1
+#endif
+
+#define SIMP_PROFILE_CONCAT_(a, b) a##b
+#define SIMP_PROFILE_CONCAT(a, b) SIMP_PROFILE_CONCAT_(a, b)
+#if SIMP_PROFILER
+	// Times the rest of the enclosing block, name has to be a string literal.
+	#define SIMP_PROFILE_CPU(name) ::Simp::Profiler::CpuScope SIMP_PROFILE_CONCAT(profileScope, __LINE__)(name)
+	// Times the GL commands issued in the rest of the enclosing block, and the CPU time with them.
+	#define SIMP_PROFILE_GPU(name) ::Simp::Profiler::GpuScope SIMP_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+	#define SIMP_PROFILE_CPU(name) ((void)0)
+	#define SIMP_PROFILE_GPU(name) ((void)0)
+#endif
+
+namespace Simp
+{
+	// Frame profiler with nested CPU scopes and GL_TIMESTAMP query pairs for GPU scopes.
+	// GPU results are read GPU_FRAMES frames later and dropped rather than waited for when not ready.
+	// Durations are aggregated per scope over a window of frames, and the events can be kept for a Chrome trace.
+	// Disabled, a scope costs one branch. Only use it from the GL thread.
+	class Profiler
+	{
+	public:
+		static const unsigned int GPU_FRAMES = 4;
+		// Frames the percentiles are taken over.
+		static const unsigned int WINDOW = 240;
+
+		// Duration of a scope in one frame.
+		struct FrameSample
+		{
+			const std::string* name;
+			bool gpu;
+			double time; // in ms
+		};
+
+		struct ScopeStats
+		{
+			std::string name;
+			bool gpu;
+			size_t samples;
+			// In ms.
+			double p50;
+			double p95;
+			double p99;
+			double max;
+		};
+
+		class CpuScope
+		{
+		public:
+			explicit CpuScope(const char* name) : index(Profiler::get().beginCpu(name)) {}
+			~CpuScope() { Profiler::get().endCpu(index); }
+
+		private:
+			uint32_t index;
+		};
+
+		class GpuScope
+		{
+		public:
+			explicit GpuScope(const char* name) : cpu(name), index(Profiler::get().beginGpu(name)) {}
+			~GpuScope() { Profiler::get().endGpu(index); }
+
+		private:
+			CpuScope cpu;
+			uint32_t index;
+		};
+
+		static Profiler& get();
+
+		void setEnabled(bool _enabled);
+		bool isEnabled() const { return enabled; }
+		// Keeps every event for writeTrace, up to capacity events.
+		void setTracing(bool _tracing, size_t capacity = 1 << 20);
+
+		void beginFrame();
+		void endFrame();
+
+		// NO_SCOPE when disabled.
+		uint32_t beginCpu(const char* name);
+		void endCpu(uint32_t index);
+		uint32_t beginGpu(const char* name);
+		void endGpu(uint32_t index);
+
+		// Percentiles over the last WINDOW frames, in first seen order.
+		std::vector<ScopeStats> getStats() const;
+		void print() const;
+		// Chrome trace event JSON, load it in chrome://tracing or Perfetto.
+		bool writeTrace(const std::string& path) const;
+
+		unsigned int getDroppedGpuScopes() const { return droppedGpuScopes; }
+		// Samples added since beginFrame, the CPU scopes of this frame and the GPU scopes of GPU_FRAMES frames ago.
+		// The names stay valid until the next beginFrame.
+		const std::vector<FrameSample>& getFrameSamples() const { return frameSamples; }
+
+		static const uint32_t NO_SCOPE = 0xFFFFFFFFu;
+
+	private:
+		Profiler();
+		Profiler(Profiler const&) = delete;
+		Profiler& operator=(Profiler const&) = delete;
+
+		struct Event
+		{
+			const char* name;
+			int64_t start; // in ns since the profiler was created
+			int64_t end;
+			uint32_t depth;
+			bool gpu;
+		};
+
+		// GPU scope of a frame waiting for its queries.
+		struct GpuPending
+		{
+			const char* name;
+			GLuint begin;
+			GLuint end;
+			uint32_t depth;
+			bool ended; // end was issued, scopes left open have no end timestamp
+		};
+
+		struct GpuFrame
+		{
+			std::vector<GpuPending> scopes;
+			std::vector<GLuint> queries;
+			size_t usedQueries = 0;
+			// Issued last, the queries of the frame complete in order so all are ready once it is.
+			// Nested scopes end in reverse, so this is not the end of the last scope.
+			GLuint lastQuery = 0;
+			// CPU minus GPU clock when the frame started, in ns.
+			int64_t clockOffset = 0;
+		};
+
+		struct Series
+		{
+			std::string name;
+			bool gpu;
+			// Duration per frame in ms, the same scope entered twice in a frame adds up.
+			std::vector<double> samples;
+			size_t next = 0;
+			double frameTotal = 0.0;
+			bool touched = false;
+		};
+
+		int64_t now() const;
+		GLuint acquireQuery(GpuFrame& frame);
+		void collectGpu(GpuFrame& frame);
+		// Adds the event to the totals of its scope for the frame, and to the trace.
+		void record(const Event& event);
+		// Turns the totals of the frame into samples.
+		void flushSeries(bool gpu);
+
+		bool enabled;
+		bool tracing;
+		bool inFrame;
+		size_t traceCapacity;
+		std::chrono::steady_clock::time_point epoch;
+
+		std::vector<Event> events; // of the current frame
+		std::vector<uint32_t> stack;
+		uint32_t gpuDepth;
+		std::vector<Event> trace;
+
+		GpuFrame gpuFrames[GPU_FRAMES];
+		unsigned int frame;
+		unsigned int droppedGpuScopes;
+
+		// A deque keeps the names of the frame samples in place when scopes are added.
+		std::deque<Series> series;
+		std::unordered_map<std::string, size_t> seriesIndex;
+		std::vector<FrameSample> frameSamples;
+	};
+}
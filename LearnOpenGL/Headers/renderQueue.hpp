@@ -0,0 +1,174 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "shader.hpp"
+
+namespace Simp
+{
+	// Textures and constants shared by draws, the render queue only rebinds what differs from the previous draw.
+	struct Material
+	{
+		static const unsigned int MAX_TEXTURES = 8;
+
+		// Unique, part of the sort key.
+		uint32_t id;
+		unsigned int textureCount;
+		GLuint textures[MAX_TEXTURES];
+		// Sampler bound to the texture unit of the same index.
+		UniformName samplers[MAX_TEXTURES];
+		// DIFFUSE, SPECULAR and NORMAL, only read by shaders that branch on material.maps.
+		unsigned int maps;
+		glm::vec3 specular;
+		float shininess;
+
+		Material();
+
+		void addTexture(GLuint texture, UniformName sampler);
+	};
+
+	// Per draw uniforms, stored by the queue for the frame and referenced by index from the packets.
+	struct DrawObject
+	{
+		enum Flags : uint32_t
+		{
+			// Binds model.
+			MODEL = 1,
+			// Binds invModel and compactVertex.
+			NORMAL_MATRIX = 2,
+			// Vertices are CompactVertex, binds positionScale and positionOffset.
+			COMPACT = 4
+		};
+
+		glm::mat4 model;
+		glm::mat3 invModel;
+		glm::vec3 positionScale;
+		glm::vec3 positionOffset;
+		uint32_t flags;
+	};
+
+	// Multi draw indirect commands of a packet, written on the GPU, see GpuCulling.
+	struct IndirectDraw
+	{
+		GLuint commandBuffer;
+		GLintptr commandOffset; // of the first DrawElementsIndirectCommand
+		GLsizei maxDrawCount;
+		GLuint countBuffer;
+		GLintptr countOffset; // of the GLuint draw count, only read with ARB_indirect_parameters
+	};
+
+	struct DrawPacket
+	{
+		// Fixed function state the packet needs.
+		enum State : uint32_t
+		{
+			NO_CULL = 1
+		};
+
+		uint64_t key;
+		Shader* shader;
+		const Material* material; // may be null
+		GLuint vertexArray;
+		uint32_t object; // RenderQueue::NO_OBJECT for none
+		uint32_t state;
+		GLenum mode;
+		GLenum indexType; // 0 for non indexed draws
+		GLint baseVertex;
+		GLuint first; // first vertex or first index in elements of indexType
+		GLsizei count;
+		GLsizei instanceCount; // 0 for a plain draw
+		GLuint baseInstance; // bound to instanceOffset, see InstanceBatch
+		const IndirectDraw* indirect; // replaces the range when not null, indexed draws only
+	};
+
+	// Draw packets collected every frame, sorted by a 64 bit key and submitted with only the state that changes.
+	//
+	// Key layout from the most significant bit:
+	//   opaque:      pass 4 | 0 | program 10 | material 12 | mesh 10 | depth 24 front to back | 3 unused
+	//   transparent: pass 4 | 1 | depth 24 back to front | program 10 | material 12 | mesh 10 | 3 unused
+	class RenderQueue
+	{
+	public:
+		static const uint32_t NO_OBJECT = 0xFFFFFFFFu;
+
+		// glMultiDrawElementsIndirectCount(ARB), not part of the core 4.3 headers.
+		typedef void (APIENTRY* DrawIndirectCount)(GLenum mode, GLenum type, const void* indirect, GLintptr drawCount,
+			GLsizei maxDrawCount, GLsizei stride);
+
+		struct Stats
+		{
+			unsigned int draws;
+			size_t instances; // drawn by instanced packets
+			unsigned int indirectDraws; // multi draw calls of indirect packets, included in draws
+			unsigned int programChanges;
+			unsigned int vertexArrayChanges;
+			unsigned int materialChanges;
+			unsigned int textureBinds;
+			unsigned int objectChanges;
+			unsigned int stateChanges;
+			double sortTime; // in ms
+			double submitTime; // in ms
+		};
+
+		// With a count function indirect packets draw only the commands the GPU wrote,
+		// without one all maxDrawCount commands are submitted and the unused ones draw nothing.
+		static void setDrawIndirectCount(DrawIndirectCount function) { drawIndirectCount = function; }
+		static bool hasDrawIndirectCount() { return drawIndirectCount != nullptr; }
+
+		// Depth is the view depth divided by the far plane, clamped to [0, 1].
+		static uint64_t makeKey(unsigned int pass, bool transparent, uint32_t program, uint32_t material, uint32_t mesh, float depth);
+
+		uint32_t addObject(const DrawObject& object);
+		void submit(const DrawPacket& packet);
+
+		// Radix sorts the packets by key, stable for equal keys.
+		void sort();
+		// Submits the sorted packets through GLState, the state of the last packet stays bound.
+		void execute();
+		// Drops the packets and objects of the frame, keeps the memory.
+		void clear();
+		// Named passes are timed as profiler GPU scopes by execute.
+		void setPassName(unsigned int pass, const char* name) { passNames[pass & 0xF] = name; }
+
+		size_t getPacketCount() const { return packets.size(); }
+		// Of the last sort and execute.
+		const Stats& getStats() const { return stats; }
+
+	private:
+		struct SortItem
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		// Uniforms the queue binds, resolved once per program change.
+		struct ProgramUniforms
+		{
+			Shader::Uniform model;
+			Shader::Uniform invModel;
+			Shader::Uniform compactVertex;
+			Shader::Uniform positionScale;
+			Shader::Uniform positionOffset;
+			Shader::Uniform maps;
+			Shader::Uniform specular;
+			Shader::Uniform shininess;
+			Shader::Uniform instanceOffset;
+		};
+
+		void bindMaterial(Shader& shader, const ProgramUniforms& uniforms, const Material& material);
+		void bindObject(Shader& shader, const ProgramUniforms& uniforms, const DrawObject& object);
+
+		static DrawIndirectCount drawIndirectCount;
+
+		std::vector<DrawPacket> packets;
+		std::vector<DrawObject> objects;
+		std::vector<SortItem> items;
+		std::vector<SortItem> scratch;
+		Stats stats = {};
+		const char* passNames[16] = {};
+	};
+}
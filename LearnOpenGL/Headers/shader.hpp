@@ -6,52 +6,238 @@
 
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "glState.hpp"
+
+#define SIMP_UNIFORM(name) ::Simp::UniformName(name, std::integral_constant<uint32_t, ::Simp::hashUniformName(name)>::value)
 
 namespace Simp
 {
+	// FNV-1a of a uniform name, evaluated at compile time for string literals.
+	constexpr uint32_t hashUniformName(const char* name)
+	{
+		uint32_t hash = 2166136261u;
+		while (*name != '\0')
+			hash = (hash ^ static_cast<unsigned char>(*name++)) * 16777619u;
+		return hash;
+	}
+
+	// Hashed uniform name. Converting from a string hashes it at run time, SIMP_UNIFORM hashes at compile time.
+	struct UniformName
+	{
+		uint32_t hash;
+		const char* name; // only kept for warnings
+
+		constexpr UniformName() : hash(hashUniformName("")), name("") {}
+		constexpr UniformName(const char* _name) : hash(hashUniformName(_name)), name(_name) {}
+		constexpr UniformName(const char* _name, uint32_t _hash) : hash(_hash), name(_name) {}
+	};
+
 	class Shader
 	{
 	public:
-		Shader() { id = glCreateProgram(); }
-		~Shader() { glDeleteProgram(id); }
+		// Resolved uniform of one program, the fastest way to bind in hot loops.
+		// Debug builds check the GL type against the setter of every bind.
+		struct Uniform
+		{
+			int slot = -1;
+			GLenum type = GL_NONE;
+			bool valid() const { return slot >= 0; }
+		};
 
+		struct CacheStats
+		{
+			unsigned int hits;
+			unsigned int misses;
+			unsigned int rejected; // binaries the driver refused to load
+			double linkTime; // in ms, spent in link by every program
+		};
+
+		Shader() : serial(nextSerial++) { id = glCreateProgram(); }
+		~Shader() { cancelReload(); GLState::get().deleteProgram(id); }
+
+		// Full path of a file in the shader directory.
+		static std::string getPath(const std::string& fileName);
+
+		// Reads the source and expands its includes, compiling is deferred to link so a cached binary can skip it.
 		Shader& attach(const std::string& fileName);
+		// Adds #define name value after the #version line of every attached source.
+		Shader& define(const std::string& name, const std::string& value = "");
+		// Loads the program binary cached for the sources, defines and driver, or compiles and links
+		// the sources and caches the binary. Then reflects every active uniform and uniform block.
 		Shader& link();
 		void use();
 
+		// Rereads the sources and starts building a new program, the current one stays in use until it links.
+		void reload();
+		// Advances a pending reload, with KHR_parallel_shader_compile without waiting on the driver.
+		// Call once per frame, returns true on the frame the new program was swapped in.
+		bool poll();
+		bool isReloading() const { return pending.program != 0; }
+		// Time from reload to swap of the last successful reload, in ms.
+		double getReloadTime() const { return reloadTime; }
+
+		bool hasSource(const std::string& fileName) const;
+		std::vector<std::string> getFileNames() const;
+
+		// Changes when a reload swaps the program.
 		GLuint getHandle() const { return id; }
+		// Unique per Shader and stable across reloads, used in sort keys.
+		uint32_t getSerial() const { return serial; }
 
-		void bind(GLuint location, GLuint value);
-		void bind(GLuint location, int value);
-		void bind(GLuint location, bool value);
-		void bind(GLuint location, float value);
-		void bind(GLuint location, const glm::vec3& value);
-		void bind(GLuint location, const glm::mat3& value);
-		void bind(GLuint location, const glm::mat4& value);
+		// Optional uniforms do not warn when the program lacks them.
+		Uniform getUniform(UniformName name, bool required = true) const;
+		bool hasUniform(UniformName name) const { return find(name.hash) >= 0; }
+		// GL_INVALID_INDEX when the program has no such block.
+		GLuint getUniformBlock(UniformName name) const;
+
+		// Values equal to the last one bound are not uploaded again.
+		template<typename T>
+		Shader& bind(Uniform uniform, const T& value)
+		{
+			if (uniform.valid())
+				set(uniforms[uniform.slot], value);
+			return *this;
+		}
 
 		template<typename T>
-		Shader& bind(const std::string& path, T&& value)
+		Shader& bind(UniformName name, const T& value)
 		{
-			GLuint location = glGetUniformLocation(id, path.c_str());
-			if (location == -1)
-				std::cout << "WARNING::uniform location missing! " << path << std::endl;
+			const int slot = find(name.hash);
+			if (slot >= 0)
+				set(uniforms[slot], value);
 			else
-				bind(location, std::forward<T>(value));
+				warnMissing(name);
 			return *this;
 		}
 
+		// GL calls made and skipped by bind since the last resetStats.
+		unsigned int getUploadCount() const { return uploadCount; }
+		unsigned int getSkippedCount() const { return skippedCount; }
+		void resetStats() { uploadCount = 0; skippedCount = 0; }
+
+		// Disabling the binary cache forces every link to compile, binaries are still written.
+		static void setBinaryCache(bool enabled) { binaryCache = enabled; }
+		static const CacheStats& getCacheStats() { return cacheStats; }
+
 	private:
 		// Disable Copying and Assignment
 		Shader(Shader const&) = delete;
 		Shader& operator=(Shader const&) = delete;
 
-		GLuint create(const std::string& fileName);
+		struct UniformInfo
+		{
+			std::string name; // only kept for warnings
+			GLint location;
+			GLenum type;
+			bool cached;
+			bool mismatched; // a setter of another type was already reported
+			// Shadow copy of the value last uploaded, large enough for a mat4.
+			unsigned char value[sizeof(glm::mat4)];
+		};
+
+		// Name of a uniform, the base name of an array is a second key of element 0.
+		struct UniformKey
+		{
+			uint32_t hash;
+			int slot;
+		};
+
+		struct BlockInfo
+		{
+			uint32_t hash;
+			GLuint index;
+		};
+
+		struct Source
+		{
+			std::string fileName;
+			// With the includes expanded.
+			std::string code;
+			// Included files, include i is GLSL source string number i + 1 in compile errors.
+			std::vector<std::string> includes;
+		};
 
+		struct BinaryHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key;
+			uint32_t format;
+			uint32_t size;
+		};
+
+		// Program being rebuilt by a reload.
+		struct Pending
+		{
+			GLuint program = 0;
+			std::vector<GLuint> shaders;
+			bool linking = false;
+			std::chrono::steady_clock::time_point start;
+		};
+
+		static bool readFile(const std::string& fileName, std::string& code, bool required = true);
+		// Reads the file and expands its #include "file" directives, every file is included once.
+		static bool readSource(Source& source);
+		static bool expandIncludes(const std::string& fileName, const std::string& code, int number, Source& source, std::string& output);
+		static GLuint create(const std::string& fileName);
+		// Starts compiling a source with the defines injected, the status is not queried.
+		GLuint compileStage(const Source& source) const;
+		bool checkStage(GLuint shader, const Source& source);
+		bool checkProgram(GLuint program);
+		void detachStages(GLuint program);
+		void compileNext();
+		void cancelReload();
+		uint64_t getCacheKey() const;
+		bool loadBinary(const std::string& path, uint64_t key);
+		void saveBinary(const std::string& path, uint64_t key);
+		void reflect();
+		int find(uint32_t hash) const;
+		void warnMissing(UniformName name);
+		// Copies the value into the shadow and returns false when it did not change.
+		// Debug builds warn once when the uniform is not of the setter's type.
+		bool update(UniformInfo& uniform, GLenum type, const void* value, size_t size);
+
+		void set(UniformInfo& uniform, GLuint value);
+		void set(UniformInfo& uniform, int value);
+		void set(UniformInfo& uniform, bool value);
+		void set(UniformInfo& uniform, float value);
+		void set(UniformInfo& uniform, const glm::vec3& value);
+		void set(UniformInfo& uniform, const glm::vec4& value);
+		void set(UniformInfo& uniform, const glm::mat3& value);
+		void set(UniformInfo& uniform, const glm::mat4& value);
+
+		static const uint32_t BINARY_MAGIC = 0x424d4953; // "SIMB"
+		static const uint32_t BINARY_VERSION = 1;
+		static bool binaryCache;
+		static CacheStats cacheStats;
+		static uint32_t nextSerial;
+
+		uint32_t serial;
 		GLuint id;
 		GLint status;
 		GLint length;
+
+		std::vector<Source> sources;
+		std::vector<std::pair<std::string, std::string>> defines;
+		Pending pending;
+		double reloadTime = 0.0;
+
+		std::vector<UniformInfo> uniforms;
+		std::vector<UniformKey> keys;
+		std::vector<BlockInfo> blocks;
+		// Open addressing table of indices into keys, -1 marks empty buckets.
+		std::vector<int> table;
+		std::unordered_set<uint32_t> missing;
+		unsigned int uploadCount = 0;
+		unsigned int skippedCount = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "shader.hpp"
+
+namespace Simp
+{
+	// Specializations of one program keyed by a feature mask, compiled on first use.
+	// Bit i of the mask adds #define features[i], every specialization also gets #define VARIANT
+	// so the shader can replace runtime branches with compile time ones.
+	// Interface features change what the program reads rather than how it branches, e.g. the vertex inputs,
+	// the uber shader is compiled once per combination of them.
+	class ShaderVariants
+	{
+	public:
+		// Flag of the uber shader keys, compiled without VARIANT and with only the interface feature defines.
+		static const uint32_t UBER = 0x80000000u;
+
+		ShaderVariants(const std::vector<std::string>& _files, const std::vector<std::string>& _features,
+					   uint32_t _interfaceFeatures = 0);
+
+		// Linked program for the feature mask, with specialization disabled the uber shader of its interface features.
+		Shader& get(uint32_t mask);
+
+		// Binds the value to every variant that has the uniform, variants compiled later get it too.
+		template<typename T>
+		void bind(UniformName name, const T& value)
+		{
+			std::function<void(Shader&)> apply = [name, value](Shader& shader)
+			{
+				if (shader.hasUniform(name))
+					shader.bind(name, value);
+			};
+			for (auto& variant : variants)
+				apply(*variant.second);
+			setShared(name.hash, std::move(apply));
+		}
+
+		// Benchmarking switch, without specialization every draw uses the uber shader.
+		void setSpecialized(bool _specialized) { specialized = _specialized; }
+		bool isSpecialized() const { return specialized; }
+
+		// Variants compiled so far.
+		std::vector<Shader*> getShaders() const;
+		size_t getCount() const { return variants.size(); }
+
+	private:
+		ShaderVariants(ShaderVariants const&) = delete;
+		ShaderVariants& operator=(ShaderVariants const&) = delete;
+
+		void setShared(uint32_t hash, std::function<void(Shader&)> apply);
+
+		std::vector<std::string> files;
+		std::vector<std::string> features;
+		uint32_t interfaceFeatures;
+		std::unordered_map<uint32_t, std::unique_ptr<Shader>> variants;
+		// Last value bound through the set per uniform, replayed on new variants.
+		std::vector<std::pair<uint32_t, std::function<void(Shader&)>>> shared;
+		bool specialized;
+	};
+}
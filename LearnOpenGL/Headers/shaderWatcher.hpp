@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+#include "shaderVariants.hpp"
+
+namespace Simp
+{
+	// Watches the shader directory and hot reloads every program using a changed file.
+	// Uses inotify on Linux and polls modification times elsewhere.
+	class ShaderWatcher
+	{
+	public:
+		ShaderWatcher();
+		~ShaderWatcher();
+
+		// The shader has to outlive the watcher.
+		void watch(Shader& shader);
+		// Also watches variants compiled after this call.
+		void watch(ShaderVariants& variants);
+		// Starts reloads for changed files and advances pending ones, call once per frame.
+		void update();
+
+		bool isReloading() const { return !reloading.empty(); }
+
+	private:
+		ShaderWatcher(ShaderWatcher const&) = delete;
+		ShaderWatcher& operator=(ShaderWatcher const&) = delete;
+
+		typedef std::chrono::steady_clock Clock;
+
+		void watchFiles(const Shader& shader);
+		// File names relative to the shader directory that changed since the last call.
+		std::set<std::string> readChanges();
+
+		std::vector<Shader*> shaders;
+		// Variant sets with the number of variants whose files are watched.
+		std::vector<std::pair<ShaderVariants*, size_t>> variantSets;
+		std::vector<Shader*> reloading;
+		int descriptor;
+		// inotify watch descriptor to directory relative to the shader directory.
+		std::map<int, std::string> directories;
+		// Modification times for polling when inotify is not available.
+		std::map<std::string, std::time_t> times;
+		Clock::time_point lastPoll;
+
+		// Reload statistics, reported once every pending reload finished.
+		Clock::time_point reloadStart;
+		Clock::time_point lastUpdate;
+		double longestStall; // in ms, time spent in update
+		double longestFrame; // in ms, time between updates
+	};
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// ARB_buffer_storage flags, not part of the core 4.3 headers.
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace Simp
+{
+	// Buffer split into FRAMES sections that are written round robin, one section per frame.
+	// Sections are persistently mapped with GL 4.4 buffer storage, otherwise written with glBufferSubData.
+	// A fence per section keeps the CPU from overwriting data the GPU may still read.
+	class StreamBuffer
+	{
+	public:
+		static const unsigned int FRAMES = 3;
+
+		// glBufferStorage (ARB_buffer_storage, core in 4.4), not part of the core 4.3 headers.
+		typedef void (APIENTRY* BufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+		struct Stats
+		{
+			size_t bytes;
+			unsigned int calls; // GL calls
+		};
+
+		// Call before the first buffer is created, without a function sections are written with glBufferSubData.
+		static void setBufferStorage(BufferStorage function) { bufferStorage = function; }
+		static bool hasBufferStorage() { return bufferStorage != nullptr; }
+
+		StreamBuffer(GLenum _target, GLsizeiptr _size);
+		~StreamBuffer();
+
+		// Fences the current section and moves on to the next one, blocks only if the GPU still reads it.
+		void advance();
+		// Grows every section to at least size, returns true when the storage was recreated and its contents lost.
+		bool reserve(GLsizeiptr size);
+		// Writes into the current section.
+		void write(GLintptr offset, const void* data, GLsizeiptr size);
+		// Binds the first size bytes of the current section to an indexed binding point.
+		void bind(GLuint binding, GLsizeiptr size);
+
+		GLsizeiptr getSize() const { return size; }
+		unsigned int getSection() const { return section; }
+		bool isPersistent() const { return mapped != nullptr; }
+
+		// Counters since the last resetStats.
+		const Stats& getStats() const { return stats; }
+		void resetStats() { stats = Stats(); }
+
+	private:
+		StreamBuffer(StreamBuffer const&) = delete;
+		StreamBuffer& operator=(StreamBuffer const&) = delete;
+
+		void create();
+		void destroy();
+
+		static BufferStorage bufferStorage;
+
+		GLenum target;
+		GLsizeiptr size;
+		// Section size rounded up to the offset alignment of the target.
+		GLsizeiptr stride;
+		GLuint buffer;
+		unsigned char* mapped;
+		GLsync fences[FRAMES];
+		unsigned int section;
+		Stats stats;
+	};
+}
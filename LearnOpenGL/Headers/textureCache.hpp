@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "textureLoader.hpp"
+
+namespace Simp
+{
+	// Process wide, reference counted textures keyed by normalized path.
+	// Only use it from the GL thread.
+	class TextureCache
+	{
+	public:
+		struct Stats
+		{
+			size_t hits;
+			size_t misses;
+			size_t textures;
+			size_t bytes;
+		};
+
+		static TextureCache& get();
+
+		// Each call takes a reference, misses are decoded through the loader.
+		GLuint acquire(const std::string& path, bool flip, TextureLoader& loader);
+		// The last reference deletes the texture, once its upload has run if that is still queued.
+		void release(GLuint texture);
+
+		// Called once the image data of a cached texture is resident.
+		void trackUpload(GLuint texture, size_t bytes);
+
+		// Waits for the pending uploads and deletes every texture regardless of references,
+		// call before the context goes away.
+		void clear();
+
+		const Stats& getStats() const { return stats; }
+		void printStats() const;
+
+		static std::string normalize(const std::string& path);
+
+	private:
+		TextureCache() : stats() {}
+		TextureCache(TextureCache const&) = delete;
+		TextureCache& operator=(TextureCache const&) = delete;
+
+		struct Entry
+		{
+			GLuint texture;
+			unsigned int references;
+			size_t bytes;
+			// Main lane job that gives the texture its storage.
+			JobHandle upload;
+			// Released while the upload was queued, a continuation of the upload deletes it unless it is acquired again.
+			bool deferred;
+		};
+
+		void destroy(GLuint texture);
+
+		std::unordered_map<std::string, Entry> entries;
+		std::unordered_map<GLuint, std::string> keys;
+		Stats stats;
+	};
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+#include "jobSystem.hpp"
+
+namespace Simp
+{
+	// Decodes images as jobs, each upload is a Main lane continuation of its decode.
+	// Uploads run in poll(), flush() or whenever the GL thread runs its jobs.
+	// A simp_texbake file next to the image is read instead of decoding the image.
+	class TextureLoader
+	{
+	public:
+		TextureLoader() {}
+
+		// Must be called on the GL thread, the returned name is valid right away
+		// but has no storage until the decoded image has been uploaded.
+		// upload, when given, receives the handle of the job that uploads it.
+		GLuint request(const std::string& path, bool flip = true, JobHandle* upload = nullptr);
+
+		// Uploads all finished images without blocking, returns the number of this loader's uploads done since the
+		// last call.
+		size_t poll();
+		// Blocks until every pending request has been uploaded, decoding on the GL thread as well meanwhile.
+		void flush();
+
+		unsigned int getThreadCount() const { return JobSystem::get().getThreadCount(); }
+
+	private:
+		TextureLoader(TextureLoader const&) = delete;
+		TextureLoader& operator=(TextureLoader const&) = delete;
+
+		// Shared by the decode and upload jobs, frees image data that was never uploaded.
+		struct Image
+		{
+			Image(GLuint _texture, const std::string& _path, bool _flip);
+			~Image();
+			Image(Image const&) = delete;
+			Image& operator=(Image const&) = delete;
+
+			GLuint texture;
+			std::string path;
+			bool flip;
+			unsigned char* data;
+			int width;
+			int height;
+			int channelNum;
+			std::vector<unsigned char> baked;
+		};
+
+		static void decode(Image& image);
+		static bool readBaked(const Image& image, std::vector<unsigned char>& baked);
+		static void upload(Image& image);
+
+		// Queued uploads keep running after the loader is gone, they only touch their image.
+		std::vector<JobHandle> uploads;
+	};
+}
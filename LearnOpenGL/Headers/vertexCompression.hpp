@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include "mesh.hpp"
+
+namespace Simp
+{
+	// Quantized counterpart of Simp::Vertex, 20 instead of 48 bytes:
+	//   position  unorm16 x3 relative to the mesh bounds, w is padding
+	//   normal    octahedral snorm10 x2 in a 2_10_10_10 word
+	//   tangent   octahedral snorm10 x2, w holds the bitangent sign
+	//   uv        half x2
+#pragma pack(push, 1)
+	struct CompactVertex
+	{
+		uint16_t position[4];
+		uint32_t normal;
+		uint32_t tangent;
+		uint16_t uv[2];
+	};
+#pragma pack(pop)
+
+	// Maps normalized positions back into model space: position * scale + offset.
+	struct Dequantization
+	{
+		glm::vec3 scale;
+		glm::vec3 offset;
+	};
+
+	uint16_t packHalf(float value);
+	// Octahedral encoding of a unit vector, w is stored in the two top bits as -1 or 1.
+	uint32_t packOctahedral(const glm::vec3& direction, float w);
+
+	Dequantization quantizeVertices(const Vertex* vertices, size_t count, CompactVertex* output);
+}
@@ -6,6 +6,10 @@
 
 #include "shader.hpp"
 #include "camera.hpp"
+#include "instanceBatch.hpp"
+#include "lightClusters.hpp"
+#include "renderQueue.hpp"
+#include "streamBuffer.hpp"
 
 #ifndef SIMP_ASSERT
 	#include <cassert>
@@ -14,13 +18,17 @@
 
 namespace Simp
 {
+	// Lights are laid out like their std140/std430 counterparts in phong.frag and are copied as is.
 #pragma pack(push, 1)
 	struct DirectionalLight
 	{
 		glm::vec3 dir;
+		float dirPadding;
 		glm::vec3 color;
+		float colorPadding;
 
-		DirectionalLight(glm::vec3 _dir, glm::vec3 _color) : dir(_dir), color(_color) {}
+		DirectionalLight(glm::vec3 _dir, glm::vec3 _color) :
+			dir(_dir), dirPadding(0.0f), color(_color), colorPadding(0.0f) {}
 	};
 #pragma pack(pop)
 
@@ -29,8 +37,11 @@ namespace Simp
 	{
 		glm::vec4 pos;
 		glm::vec3 color;
+		float colorPadding;
 		glm::vec3 dir;
+		float dirPadding;
 		glm::vec2 angles;
+		glm::vec2 anglesPadding;
 
 		OtherLight(glm::vec4 _pos, glm::vec3 _color);
 		OtherLight(glm::vec4 _pos, glm::vec3 _color, glm::vec3 _dir, float outter, float inner);
@@ -44,28 +55,48 @@ namespace Simp
 	{
 	public:
 		const static unsigned int MAX_DIRECTIONAL_LIGHTS = 4;
-		const static unsigned int MAX_OTHER_LIGHTS = 32;
+		// Point and spot lights live in a shader storage buffer and are shaded per light cluster.
+		const static unsigned int MAX_OTHER_LIGHTS = 4096;
 		static constexpr const char* uboName = "Lights";
-		const static unsigned int uboSize = sizeof(GLint) * 4 +
-			MAX_DIRECTIONAL_LIGHTS * (sizeof(glm::vec4) * 2) +
-			MAX_OTHER_LIGHTS * (sizeof(glm::vec4) * 4);
+		// Light counts, cluster grid and parameters, directional lights.
+		const static unsigned int uboSize = sizeof(GLint) * 4 + sizeof(glm::uvec4) + sizeof(glm::vec4) +
+			MAX_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight);
 
 		World();
-		~World() { glDeleteBuffers(1, &ubo); }
+		~World();
 
 		World& attachLight(std::unique_ptr<DirectionalLight>& light);
 		World& attachLight(std::unique_ptr<OtherLight>& light);
 
 		void bindBuffer(const Shader& shader);
-		void bindLights();
+		// Rebuilds the light clusters of the camera and uploads the lights that changed since the last frames.
+		void bindLights(const Camera& camera);
+		// Bytes written and GL calls made by the last bindLights.
+		const StreamBuffer::Stats& getUploadStats() const { return uploadStats; }
 
 		const std::vector<std::unique_ptr<DirectionalLight>>& getDirectionalLights() const;
 		const std::vector<std::unique_ptr<OtherLight>>& getOtherLights() const;
+		const LightClusters& getClusters() const { return clusters; }
 
-		void drawPointLights(const Camera& camera, Shader& shader, GLuint vao, GLuint size) const;
+		// Adds a light cube instance for every point and spot light in the frustum, parameters hold the light color.
+		// The shader has to be built with INSTANCED.
+		void submitPointLights(const Camera& camera, InstanceBatch& batch, Shader& shader, GLuint vao, GLuint size) const;
+
+		// Copies the lights that differ from data into it and marks them dirty for every buffer section,
+		// returns the number of changed lights.
+		static size_t packLights(const std::vector<std::unique_ptr<OtherLight>>& lights, std::vector<glm::vec4>& data,
+			std::vector<uint8_t>& dirty);
 
 	private:
-		GLuint ubo;
+		StreamBuffer lightBlock;
+		StreamBuffer lightBuffer;
+		LightClusters clusters;
+		// Copies of the data last written, with the number of buffer sections that still miss it.
+		std::vector<glm::vec4> blockData;
+		unsigned int blockDirty;
+		std::vector<glm::vec4> lightData;
+		std::vector<uint8_t> lightDirty;
+		StreamBuffer::Stats uploadStats;
 		std::vector<std::unique_ptr<DirectionalLight>> directionalLights;
 		std::vector<std::unique_ptr<OtherLight>> otherLights;
 	};
@@ -0,0 +1,42 @@
+// Helper functions shared by the shaders, pulled in with #include "common.glsl".
+
+#define GAMMA 2.2
+#define PI 3.1415926535897932384626433832795028841972
+
+// https://www.shadertoy.com/view/lscSzl
+vec3 encodeSRGB(vec3 linearRGB) {
+	vec3 a = 12.92 * linearRGB;
+	vec3 b = 1.055 * pow(linearRGB, vec3(1.0 / 2.4)) - 0.055;
+	vec3 c = step(vec3(0.0031308), linearRGB);
+	return mix(a, b, c);
+}
+
+vec3 decodeSRGB(vec3 screenRGB) {
+	vec3 a = screenRGB / 12.92;
+	vec3 b = pow((screenRGB + 0.055) / 1.055, vec3(2.4));
+	vec3 c = step(vec3(0.04045), screenRGB);
+	return mix(a, b, c);
+}
+
+vec3 gamma(vec3 color, float g) {
+	return pow(color, vec3(g));
+}
+
+vec3 exposureMapping(vec3 v, float exposure) {
+	return 1.0 - exp(-v * exposure);
+}
+
+vec3 toneMapping(vec3 v) {
+	return v / max(v, 1.0);
+}
+
+const vec2 mapTo01 = vec2(0.159154943092, 0.318309886184);
+
+vec2 sampleSphericalMap(vec3 dir) {
+	// atan/atan2 has range of [-PI, PI], and sin has [-PI/2, PI/2] (with domanin [-1, 1]
+	// atan(y, x), atan(x/y) with [-PI/2, PI/2]
+	vec2 t = vec2(atan(dir.z, dir.x), asin(dir.y));
+	t *= mapTo01;
+	t += .5;
+	return t;
+}
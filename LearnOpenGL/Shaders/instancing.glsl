@@ -0,0 +1,35 @@
+// Per instance data of Simp::InstanceBatch and Simp::GpuCulling, packed like Simp::InstanceData.
+struct Instance {
+	mat4 model;
+	mat3 normalMatrix;
+	vec4 parameters;
+};
+
+// The GPU culled instances stay resident in their own buffer.
+#if defined(INDIRECT)
+#define INSTANCES_BINDING 4
+#else
+#define INSTANCES_BINDING 3
+#endif
+
+layout(std430, binding = INSTANCES_BINDING) readonly buffer Instances {
+	Instance instances[];
+};
+
+#if !defined(INSTANCE_DATA_ONLY)
+#if defined(INDIRECT)
+// Written by cull.comp, fetched with divisor 1 so the baseInstance of the indirect command offsets it.
+layout(location = 4) in uint aInstance;
+
+Instance getInstance() {
+	return instances[aInstance];
+}
+#else
+// First instance of the draw, GLSL 4.30 has no gl_BaseInstance.
+uniform uint instanceOffset;
+
+Instance getInstance() {
+	return instances[instanceOffset + uint(gl_InstanceID)];
+}
+#endif
+#endif
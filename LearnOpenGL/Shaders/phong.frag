@@ -1,53 +1,12 @@
-#version 330 core
+#version 430 core
 
-// Helper functions
-
-#define GAMMA 2.2
-#define PI 3.1415926535897932384626433832795028841972
+#include "common.glsl"
 
 // _Time - Time since level load (t/20, t, t*2, t*3), use to animate things inside the shaders.
 // _SinTime _CosTime = (t/8, t/4, t/2, t).
 // unity_DeltaTime = Delta time: (dt, 1/dt, smoothDt, 1/smoothDt)
 uniform vec4 _Time;
 
-// https://www.shadertoy.com/view/lscSzl
-vec3 encodeSRGB(vec3 linearRGB) {
-	vec3 a = 12.92 * linearRGB;
-	vec3 b = 1.055 * pow(linearRGB, vec3(1.0 / 2.4)) - 0.055;
-	vec3 c = step(vec3(0.0031308), linearRGB);
-	return mix(a, b, c);
-}
-
-vec3 decodeSRGB(vec3 screenRGB) {
-	vec3 a = screenRGB / 12.92;
-	vec3 b = pow((screenRGB + 0.055) / 1.055, vec3(2.4));
-	vec3 c = step(vec3(0.04045), screenRGB);
-	return mix(a, b, c);
-}
-
-vec3 gamma(vec3 color, float g) {
-	return pow(color, vec3(g));
-}
-
-vec3 exposureMapping(vec3 v, float exposure) {
-	return 1.0 - exp(-v * exposure);
-}
-
-vec3 toneMapping(vec3 v) {
-	return v / max(v, 1.0);
-}
-
-const vec2 mapTo01 = vec2(0.159154943092, 0.318309886184);
-
-vec2 sampleSphericalMap(vec3 dir) {
-	// atan/atan2 has range of [-PI, PI], and sin has [-PI/2, PI/2] (with domanin [-1, 1]
-	// atan(y, x), atan(x/y) with [-PI/2, PI/2]
-	vec2 t = vec2(atan(dir.z, dir.x), asin(dir.y));
-	t *= mapTo01;
-	t += .5;
-	return t;
-}
-
 // Material varying/uniforms
 
 in vs_out {
@@ -58,6 +17,7 @@ in vs_out {
 } varyings;
 
 uniform vec3 cameraPos;
+uniform mat4 view;
 uniform float exposure;
 uniform sampler2D skybox;
 // uniform samplerCube skybox;
@@ -80,7 +40,25 @@ uniform Material material;
 const uint cDiffuse = 0x00000001u;
 const uint cSpecular = 0x00000002u;
 const uint cNormal = 0x00000004u;
-#define MAP_DEFINDED(C) (material.maps & C) != 0u
+
+// Variants get the maps as HAS_*_MAP defines and the map branches fold away at compile time,
+// the uber shader reads them from material.maps for every fragment.
+#if defined(VARIANT)
+const uint cMaps = 0u
+	#if defined(HAS_DIFFUSE_MAP)
+	| cDiffuse
+	#endif
+	#if defined(HAS_SPECULAR_MAP)
+	| cSpecular
+	#endif
+	#if defined(HAS_NORMAL_MAP)
+	| cNormal
+	#endif
+	;
+#define MAP_DEFINDED(C) ((cMaps & C) != 0u)
+#else
+#define MAP_DEFINDED(C) ((material.maps & C) != 0u)
+#endif
 
 struct Surface {
 	vec3 pos;
@@ -109,7 +87,9 @@ Surface getSurface(Material material) {
 	}
 
 	if(MAP_DEFINDED(cNormal)) {
-		surface.normal = texture(material.texture_normal0, varyings.TexCoords).rgb * 2.0 - 1.0;
+		// Only xy are stored for BC5 normal maps, rebuild z from the unit length.
+		vec2 xy = texture(material.texture_normal0, varyings.TexCoords).rg * 2.0 - 1.0;
+		surface.normal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
 		surface.normal = normalize(varyings.TBN * surface.normal);
 	} else {
 		surface.normal = normalize(varyings.Normal);
@@ -122,20 +102,25 @@ Surface getSurface(Material material) {
 // Light calculation.
 
 #define MAX_DIRECTIONAL_LIGHTS 4
-#define MAX_OTHER_LIGHTS 32
-#define SQUER_FALLOF_WINDOWING // SQUER_FALLOF
-#define BLIN_PHONG
+// Defaults, the models can also be picked with injected defines.
+#if !defined(SQUER_FALLOF) && !defined(SQUER_FALLOF_WINDOWING)
+	#define SQUER_FALLOF_WINDOWING
+#endif
+#if !defined(PHONG) && !defined(BLIN_PHONG)
+	#define BLIN_PHONG
+#endif
 
 struct DirLight {
 	vec3 dir;
 	vec3 color;
 };
 
+// Members are padded to vec4 to match the std430 layout written by World.
 struct OtherLight {
 	vec4 pos;
-	vec3 color;
-	vec3 dir;
-	vec2 spotAngles;
+	vec4 color;
+	vec4 dir;
+	vec4 spotAngles;
 };
 
 struct Light {
@@ -144,13 +129,37 @@ struct Light {
 	float attenuation;
 };
 
-layout(std140) uniform Lights {
+// Bound in the shader so hot reloaded programs keep the binding.
+layout(std140, binding = 0) uniform Lights {
 	uniform int directionalLightNum;
 	uniform int otherLightNum;
+	// Tiles in x and y, depth slices.
+	uniform uvec4 clusterGrid;
+	// Tile size in pixels, slice = log(depth) * z + w.
+	uniform vec4 clusterParameters;
 	uniform DirLight directionalLight[MAX_DIRECTIONAL_LIGHTS];
-	uniform OtherLight otherLights[MAX_OTHER_LIGHTS];
 };
 
+layout(std430, binding = 0) readonly buffer OtherLights {
+	OtherLight otherLights[];
+};
+
+// Offset into lightIndices and light count of every cluster.
+layout(std430, binding = 1) readonly buffer LightClusters {
+	uvec2 lightClusters[];
+};
+
+layout(std430, binding = 2) readonly buffer LightIndices {
+	uint lightIndices[];
+};
+
+uvec2 getLightCluster(Surface surface) {
+	float depth = -(view * vec4(surface.pos, 1.0)).z;
+	float slice = clamp(floor(log(depth) * clusterParameters.z + clusterParameters.w), 0.0, float(clusterGrid.z - 1u));
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterParameters.xy), clusterGrid.xy - 1u);
+	return lightClusters[(uint(slice) * clusterGrid.y + tile.y) * clusterGrid.x + tile.x];
+}
+
 Light getDirLight(int index) {
 	Light light;
 	light.dir = -directionalLight[index].dir;
@@ -174,8 +183,8 @@ float getAttenuation(int index, vec3 posToLight) {
 }
 
 float getSpotAngleAtteuation(int index, vec3 dirToLight) {
-	vec2 spot = otherLights[index].spotAngles;
-	vec3 spotDir = -normalize(otherLights[index].dir);
+	vec2 spot = otherLights[index].spotAngles.xy;
+	vec3 spotDir = -normalize(otherLights[index].dir.xyz);
 	return clamp(dot(spotDir, dirToLight) * spot.x + spot.y, 0.0, 1.0);
 }
 
@@ -188,7 +197,7 @@ Light getOtherLight(int index, Surface surface) {
 
 	Light light;
 	light.dir = dirToLight;
-	light.color = otherLights[index].color;
+	light.color = otherLights[index].color.rgb;
 	light.attenuation = atten * attenAngle;
 	return light;
 }
@@ -220,13 +229,15 @@ vec3 calculateLight(Surface surface, Light light) {
 void main() {
 	Surface surface = getSurface(material);
 
-	vec3 color;
+	vec3 color = vec3(0.0);
 	for(int i = 0; i < directionalLightNum; i++) {
 		color += calculateLight(surface, getDirLight(i));
 	}
 
-	for(int i = 0; i < otherLightNum; i++) {
-		color += calculateLight(surface, getOtherLight(i, surface));
+	// Only the lights binned into the cluster of this fragment.
+	uvec2 cluster = getLightCluster(surface);
+	for(uint i = 0u; i < cluster.y; i++) {
+		color += calculateLight(surface, getOtherLight(int(lightIndices[cluster.x + i]), surface));
 	}
 
 	// color = toneMapping(color, exposure);
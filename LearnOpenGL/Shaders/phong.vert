@@ -1,9 +1,11 @@
-#version 330 core
+#version 430 core
 
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
+// With compactVertex the attributes hold a Simp::CompactVertex:
+// unorm16 position, octahedral normal and tangent in xy, bitangent sign in tangent w.
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec4 aNormal;
 layout(location = 2) in vec2 aUV;
-layout(location = 3) in vec3 aTangent;
+layout(location = 3) in vec4 aTangent;
 
 out vs_out {
 	vec3 WSPosition;
@@ -17,19 +19,53 @@ uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 invModel;
 
+uniform bool compactVertex;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+// INSTANCED variants take model and normal matrix from the instance buffer instead of the uniforms.
+#if defined(INSTANCED)
+#include "instancing.glsl"
+#endif
+
+vec3 decodeOctahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
 void main() {
+#if defined(INSTANCED)
+	Instance instance = getInstance();
+	mat4 modelMatrix = instance.model;
+	mat3 normalMatrix = instance.normalMatrix;
+#else
+	mat4 modelMatrix = model;
+	mat3 normalMatrix = invModel;
+#endif
+
+	vec3 position = aPos.xyz;
+	vec3 vertexNormal = aNormal.xyz;
+	vec3 vertexTangent = aTangent.xyz;
+	if (compactVertex) {
+		position = aPos.xyz * positionScale + positionOffset;
+		vertexNormal = decodeOctahedral(aNormal.xy);
+		vertexTangent = decodeOctahedral(aTangent.xy);
+	}
+
 	// vec3 normal = invModel * aNormal;
-	vec3 normal = invModel * aNormal; // vec3(model * vec4(aNormal, 0.0));
-	vec3 tangent = invModel * aTangent; // vec3(model * vec4(aTangent, 0.0));
+	vec3 normal = normalMatrix * vertexNormal; // vec3(model * vec4(aNormal, 0.0));
+	vec3 tangent = normalMatrix * vertexTangent; // vec3(model * vec4(aTangent, 0.0));
 	normal = normalize(normal);
 	tangent = normalize(tangent);
 	// Gram-schmidt precess / re-orthogonalize the TBN
 	tangent = normalize(tangent - dot(tangent, normal) * normal);
-	vec3 bitangent = cross(normal, tangent);
+	vec3 bitangent = cross(normal, tangent) * aTangent.w;
 
 	varyings.TBN = mat3(tangent, bitangent, normal);
 	varyings.Normal = normal;
-	varyings.WSPosition = vec3(model * vec4(aPos, 1.0));
+	varyings.WSPosition = vec3(modelMatrix * vec4(position, 1.0));
 	varyings.TexCoords = aUV;
 
 	gl_Position = projection * view * vec4(varyings.WSPosition, 1.0);
@@ -3,24 +3,11 @@
 in vec3 DirCoords;
 out vec4 FragColor;
 
-const vec2 mapTo01 = vec2(0.159154943092, 0.318309886184);
-
-vec2 sampleSphericalMap(vec3 v) {
-	vec2 uv = vec2(atan(v.z, v.x), asin(v.y));
-	return (uv * mapTo01) + .5;
-}
+#include "common.glsl"
 
 // https://64.github.io/tonemapping/
 // Addaptive tone mapping
 // https://dl.acm.org/doi/abs/10.1145/1399504.1360667?casa_token=yXqJ3scAvVEAAAAA:b8ugNskQF_F59rsDmPpZNpnIvM84qEipa69vK8dGD1SGBsUCVMv0yHa2z_fCfcGa9-ivFwlP0Lpvmg
-vec3 gamma(vec3 color, float g) {
-	return pow(color, vec3(g));
-}
-
-vec3 toneMapping(vec3 v) {
-	return v / max(v, 1.0);
-}
-
 vec3 reinghard(vec3 v) {
 	return v / (v + 1.0);
 }
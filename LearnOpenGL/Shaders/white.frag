@@ -1,8 +1,16 @@
-#version 330 core
+#version 430 core
 
 out vec4 FragColor;
 
+#if defined(INSTANCED)
+flat in vec3 color;
+#endif
+
 void main()
 {
+#if defined(INSTANCED)
+    FragColor = vec4(color, 1.0);
+#else
     FragColor = vec4(1.0); // set all 4 vector values to 1.0
-}
\ No newline at end of file
+#endif
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 layout (location = 0) in vec3 aPos;
 
@@ -6,7 +6,20 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#if defined(INSTANCED)
+#include "instancing.glsl"
+
+flat out vec3 color;
+#endif
+
 void main()
 {
+#if defined(INSTANCED)
+	Instance instance = getInstance();
+	// Light colors are HDR, keep the hue and clamp the brightness.
+	color = instance.parameters.rgb / max(max(instance.parameters.r, instance.parameters.g), max(instance.parameters.b, 1.0));
+	gl_Position = projection * view * instance.model * vec4(aPos, 1.0);
+#else
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,255 @@
+#include "benchmark.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace Simp
+{
+	namespace
+	{
+		double percentile(const std::vector<double>& sorted, double p)
+		{
+			if (sorted.empty())
+				return 0.0;
+			const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+			return sorted[std::min(index, sorted.size() - 1)];
+		}
+
+		// Reads the "metrics" object of a file written by writeJson, not a general JSON parser.
+		bool readBaseline(const std::string& text, std::unordered_map<std::string, Benchmark::Percentiles>& baseline)
+		{
+			size_t cursor = text.find("\"metrics\"");
+			if (cursor == std::string::npos)
+				return false;
+			cursor = text.find('{', cursor);
+			while (cursor != std::string::npos)
+			{
+				const size_t nameStart = text.find('"', cursor + 1);
+				const size_t objectEnd = text.find('}', cursor + 1);
+				if (nameStart == std::string::npos || objectEnd == std::string::npos || objectEnd < nameStart)
+					break;
+				const size_t nameEnd = text.find('"', nameStart + 1);
+				const size_t valuesStart = text.find('{', nameEnd);
+				const size_t valuesEnd = text.find('}', valuesStart);
+				if (nameEnd == std::string::npos || valuesStart == std::string::npos || valuesEnd == std::string::npos)
+					return false;
+
+				Benchmark::Percentiles values = {};
+				const std::string object = text.substr(valuesStart, valuesEnd - valuesStart);
+				const char* keys[] = { "\"p50\"", "\"p95\"", "\"p99\"", "\"max\"" };
+				double* fields[] = { &values.p50, &values.p95, &values.p99, &values.max };
+				for (int i = 0; i < 4; i++)
+				{
+					const size_t key = object.find(keys[i]);
+					const size_t colon = key == std::string::npos ? key : object.find(':', key);
+					if (colon != std::string::npos)
+						*fields[i] = std::strtod(object.c_str() + colon + 1, nullptr);
+				}
+				baseline[text.substr(nameStart + 1, nameEnd - nameStart - 1)] = values;
+				cursor = valuesEnd;
+			}
+			return true;
+		}
+	}
+
+	CameraPath CameraPath::orbit(const glm::vec3& center, float radius, float height, float period)
+	{
+		// Enough keyframes that the chords stay close to the circle.
+		const unsigned int STEPS = 64;
+		CameraPath path;
+		for (unsigned int i = 0; i <= STEPS; i++)
+		{
+			const float angle = 2.0f * glm::pi<float>() * i / STEPS;
+			const glm::vec3 offset(radius * std::cos(angle), height, radius * std::sin(angle));
+			path.add(period * i / STEPS, center + offset, center);
+		}
+		return path;
+	}
+
+	bool CameraPath::load(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::cerr << "ERROR::CAMERA_PATH::FILE_NOT_FOUND " << path << std::endl;
+			return false;
+		}
+
+		keyframes.clear();
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#')
+				continue;
+			std::istringstream stream(line);
+			Keyframe keyframe;
+			if (stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+				>> keyframe.target.x >> keyframe.target.y >> keyframe.target.z)
+				add(keyframe.time, keyframe.position, keyframe.target);
+		}
+		if (keyframes.empty())
+			std::cerr << "ERROR::CAMERA_PATH::NO_KEYFRAMES " << path << std::endl;
+		return !keyframes.empty();
+	}
+
+	bool CameraPath::save(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (!file)
+		{
+			std::cerr << "ERROR::CAMERA_PATH::FILE_NOT_WRITTEN " << path << std::endl;
+			return false;
+		}
+
+		file << "# time position.xyz target.xyz\n";
+		for (const Keyframe& keyframe : keyframes)
+		{
+			file << keyframe.time << ' ' << keyframe.position.x << ' ' << keyframe.position.y << ' ' << keyframe.position.z
+				<< ' ' << keyframe.target.x << ' ' << keyframe.target.y << ' ' << keyframe.target.z << '\n';
+		}
+		return true;
+	}
+
+	void CameraPath::add(float time, const glm::vec3& position, const glm::vec3& target)
+	{
+		if (!keyframes.empty() && time <= keyframes.back().time)
+			return;
+		keyframes.push_back({ time, position, target });
+	}
+
+	void CameraPath::apply(Camera& camera, float time) const
+	{
+		if (keyframes.empty())
+			return;
+
+		const float duration = getDuration();
+		if (duration > 0.0f)
+			time = std::fmod(time, duration);
+		auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+			[](float t, const Keyframe& keyframe) { return t < keyframe.time; });
+		if (next == keyframes.begin() || next == keyframes.end())
+		{
+			const Keyframe& keyframe = next == keyframes.end() ? keyframes.back() : keyframes.front();
+			camera.lookAt(keyframe.position, keyframe.target);
+			return;
+		}
+
+		const Keyframe& a = *(next - 1);
+		const Keyframe& b = *next;
+		const float t = (time - a.time) / (b.time - a.time);
+		camera.lookAt(glm::mix(a.position, b.position, t), glm::mix(a.target, b.target, t));
+	}
+
+	void Benchmark::add(const std::string& metric, double value)
+	{
+		auto found = metricIndex.find(metric);
+		if (found == metricIndex.end())
+		{
+			found = metricIndex.emplace(metric, metrics.size()).first;
+			metrics.push_back({ metric, {} });
+		}
+		metrics[found->second].samples.push_back(value);
+	}
+
+	Benchmark::Percentiles Benchmark::getPercentiles(size_t metric) const
+	{
+		std::vector<double> sorted = metrics[metric].samples;
+		std::sort(sorted.begin(), sorted.end());
+		Percentiles result;
+		result.p50 = percentile(sorted, 0.50);
+		result.p95 = percentile(sorted, 0.95);
+		result.p99 = percentile(sorted, 0.99);
+		result.max = sorted.empty() ? 0.0 : sorted.back();
+		return result;
+	}
+
+	bool Benchmark::writeJson(const std::string& path, unsigned int frames, unsigned int warmup) const
+	{
+		std::ofstream file;
+		if (!path.empty())
+		{
+			file.open(path);
+			if (!file)
+			{
+				std::cerr << "ERROR::BENCHMARK::FILE_NOT_WRITTEN " << path << std::endl;
+				return false;
+			}
+		}
+		std::ostream& out = path.empty() ? std::cout : file;
+
+		out << "{\n  \"frames\": " << frames << ",\n  \"warmup\": " << warmup << ",\n  \"metrics\": {";
+		for (size_t i = 0; i < metrics.size(); i++)
+		{
+			const Percentiles values = getPercentiles(i);
+			out << (i == 0 ? "\n" : ",\n") << "    \"" << metrics[i].name << "\": { \"p50\": " << values.p50
+				<< ", \"p95\": " << values.p95 << ", \"p99\": " << values.p99 << ", \"max\": " << values.max << " }";
+		}
+		out << "\n  }\n}" << std::endl;
+		return true;
+	}
+
+	bool Benchmark::isTiming(const std::string& metric)
+	{
+		return metric.size() > 3 && metric.compare(metric.size() - 3, 3, "_ms") == 0;
+	}
+
+	int Benchmark::compare(const std::string& baselinePath, double tolerance, bool timings) const
+	{
+		std::ifstream file(baselinePath);
+		std::unordered_map<std::string, Percentiles> baseline;
+		if (!file)
+		{
+			std::cerr << "ERROR::BENCHMARK::BASELINE_NOT_FOUND " << baselinePath << std::endl;
+			return -1;
+		}
+		std::stringstream text;
+		text << file.rdbuf();
+		if (!readBaseline(text.str(), baseline))
+		{
+			std::cerr << "ERROR::BENCHMARK::BASELINE_NOT_READ " << baselinePath << std::endl;
+			return -1;
+		}
+
+		int regressions = 0;
+		int compared = 0;
+		for (size_t i = 0; i < metrics.size(); i++)
+		{
+			if (!timings && isTiming(metrics[i].name))
+				continue;
+			auto found = baseline.find(metrics[i].name);
+			if (found == baseline.end())
+				continue;
+			compared++;
+			const Percentiles current = getPercentiles(i);
+			const double currents[] = { current.p50, current.p95, current.p99 };
+			const double baselines[] = { found->second.p50, found->second.p95, found->second.p99 };
+			const char* names[] = { "p50", "p95", "p99" };
+			for (int j = 0; j < 3; j++)
+			{
+				// The small absolute slack keeps counters and near zero timings from flagging noise.
+				if (currents[j] > baselines[j] * (1.0 + tolerance) + 1e-3)
+				{
+					std::cerr << "ERROR::BENCHMARK::REGRESSION " << metrics[i].name << ' ' << names[j] << ' '
+						<< currents[j] << " against " << baselines[j] << std::endl;
+					regressions++;
+				}
+			}
+		}
+		// A baseline without any of the metrics would pass every run.
+		if (compared == 0)
+		{
+			std::cerr << "ERROR::BENCHMARK::NO_METRICS_COMPARED " << baselinePath << std::endl;
+			return -1;
+		}
+		std::cout << "INFO::BENCHMARK " << regressions << " regressions in " << compared << " metrics against "
+			<< baselinePath << " with " << tolerance * 100.0 << " % tolerance" << (timings ? "" : ", timings skipped")
+			<< std::endl;
+		return regressions;
+	}
+}
@@ -0,0 +1,539 @@
+#include "bvh.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Simp
+{
+	namespace
+	{
+		const int BIN_COUNT = 16;
+		const uint32_t MAX_LEAF_SIZE = 4;
+		const float TRAVERSAL_COST = 1.0f;
+		// Nodes with more instances than this accumulate their bins on several threads.
+		const uint32_t PARALLEL_BINNING_SIZE = 1u << 16;
+		const size_t BINNING_GRAIN = 1u << 14;
+
+		struct Bin
+		{
+			Aabb bounds;
+			uint32_t count = 0;
+		};
+
+		struct Bins
+		{
+			Bin bins[BIN_COUNT];
+
+			void merge(const Bins& other)
+			{
+				for (int b = 0; b < BIN_COUNT; b++)
+				{
+					bins[b].bounds.grow(other.bins[b].bounds);
+					bins[b].count += other.bins[b].count;
+				}
+			}
+		};
+
+		int binIndex(float centroid, float minimum, float scale)
+		{
+			return std::min(static_cast<int>((centroid - minimum) * scale), BIN_COUNT - 1);
+		}
+
+		// 0 outside, 1 intersecting, 2 fully inside.
+		int classify(const Frustum& frustum, const Aabb& box)
+		{
+			const glm::vec3 center = box.center();
+			const glm::vec3 extent = (box.max - box.min) * 0.5f;
+			int result = 2;
+			for (int i = 0; i < 6; i++)
+			{
+				const glm::vec3 normal(frustum.planes[i]);
+				const float distance = glm::dot(normal, center) + frustum.planes[i].w;
+				const float radius = glm::dot(glm::abs(normal), extent);
+				if (distance < -radius)
+					return 0;
+				if (distance < radius)
+					result = 1;
+			}
+			return result;
+		}
+
+		bool intersectBox(const Aabb& box, const glm::vec3& origin, const glm::vec3& inverseDirection,
+						  float tMax, float& tEntry)
+		{
+			const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+			const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+			const glm::vec3 tNear = glm::min(t0, t1);
+			const glm::vec3 tFar = glm::max(t0, t1);
+			tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+			const float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+			return tEntry <= tExit;
+		}
+
+		float distanceSquared(const Aabb& box, const glm::vec3& point)
+		{
+			const glm::vec3 d = glm::max(glm::max(box.min - point, point - box.max), glm::vec3(0.0f));
+			return glm::dot(d, d);
+		}
+	}
+
+	void Bvh::build(const std::vector<Aabb>& bounds, unsigned int threadCount)
+	{
+		const uint32_t count = static_cast<uint32_t>(bounds.size());
+		nodes.clear();
+		parents.clear();
+		if (count == 0)
+			return;
+
+		if (threadCount == 0)
+			threadCount = JobSystem::get().getThreadCount();
+
+		boxes = bounds;
+		nodes.resize(2 * size_t(count) - 1);
+		parents.resize(nodes.size());
+		indices.resize(count);
+		leaves.resize(count);
+		references.resize(count);
+		parallelFor(0, count, [&](size_t i)
+		{
+			references[i].bounds = bounds[i];
+			references[i].centroid = bounds[i].center();
+			references[i].instance = static_cast<uint32_t>(i);
+		}, BINNING_GRAIN, threadCount);
+
+		parents[0] = 0;
+		nodeCount = 1;
+
+		// Split breadth first until there are enough subtrees to keep every thread busy.
+		std::vector<Task> tasks(1, Task{ 0, 0, count });
+		std::vector<Task> subtrees;
+		const size_t targetSubtrees = size_t(threadCount) * 4;
+		while (!tasks.empty() && tasks.size() + subtrees.size() < targetSubtrees)
+		{
+			std::vector<Task> next;
+			for (const auto& task : tasks)
+			{
+				Task left;
+				Task right;
+				if (split(task, left, right, threadCount))
+				{
+					next.push_back(left);
+					next.push_back(right);
+				}
+			}
+			tasks.swap(next);
+		}
+		subtrees.insert(subtrees.end(), tasks.begin(), tasks.end());
+
+		parallelFor(0, subtrees.size(), [&](size_t i)
+		{
+			buildSubtree(subtrees[i]);
+		}, 1, threadCount);
+
+		nodes.resize(nodeCount);
+		parents.resize(nodeCount);
+		std::vector<Reference>().swap(references);
+	}
+
+	bool Bvh::split(const Task& task, Task& left, Task& right, unsigned int threadCount)
+	{
+		Node& node = nodes[task.node];
+		const uint32_t count = task.end - task.begin;
+
+		Aabb nodeBounds;
+		Aabb centroidBounds;
+		for (uint32_t i = task.begin; i < task.end; i++)
+		{
+			nodeBounds.grow(references[i].bounds);
+			centroidBounds.grow(references[i].centroid);
+		}
+		node.bounds = nodeBounds;
+
+		if (count <= MAX_LEAF_SIZE)
+		{
+			makeLeaf(task);
+			return false;
+		}
+
+		// Bin along the longest axis of the centroids only, a third of the work for a slightly worse split.
+		const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		int axis = 0;
+		if (extent.y > extent[axis])
+			axis = 1;
+		if (extent.z > extent[axis])
+			axis = 2;
+		const float minimum = centroidBounds.min[axis];
+		const float scale = extent[axis] > 0.0f ? BIN_COUNT / extent[axis] : 0.0f;
+
+		Bins bins;
+		auto accumulate = [&](uint32_t begin, uint32_t end, Bins& target)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const Reference& reference = references[i];
+				Bin& bin = target.bins[binIndex(reference.centroid[axis], minimum, scale)];
+				bin.bounds.grow(reference.bounds);
+				bin.count++;
+			}
+		};
+		if (scale > 0.0f && count >= PARALLEL_BINNING_SIZE && threadCount > 1)
+		{
+			const size_t chunks = (count + BINNING_GRAIN - 1) / BINNING_GRAIN;
+			std::vector<Bins> partial(chunks);
+			parallelFor(0, chunks, [&](size_t c)
+			{
+				const uint32_t begin = task.begin + static_cast<uint32_t>(c * BINNING_GRAIN);
+				accumulate(begin, std::min<uint32_t>(begin + static_cast<uint32_t>(BINNING_GRAIN), task.end), partial[c]);
+			}, 1, threadCount);
+			for (const auto& chunk : partial)
+				bins.merge(chunk);
+		}
+		else if (scale > 0.0f)
+		{
+			accumulate(task.begin, task.end, bins);
+		}
+
+		// Sweep the planes between bins for the cheapest SAH split.
+		int bestSplit = -1;
+		float bestCost = static_cast<float>(count);
+		if (scale > 0.0f)
+		{
+			const float inverseArea = 1.0f / std::max(nodeBounds.surfaceArea(), 1e-20f);
+			float rightArea[BIN_COUNT];
+			uint32_t rightCount[BIN_COUNT];
+			Aabb accumulated;
+			uint32_t accumulatedCount = 0;
+			for (int b = BIN_COUNT - 1; b > 0; b--)
+			{
+				accumulated.grow(bins.bins[b].bounds);
+				accumulatedCount += bins.bins[b].count;
+				rightArea[b] = accumulated.surfaceArea();
+				rightCount[b] = accumulatedCount;
+			}
+
+			accumulated = Aabb();
+			accumulatedCount = 0;
+			for (int b = 0; b < BIN_COUNT - 1; b++)
+			{
+				accumulated.grow(bins.bins[b].bounds);
+				accumulatedCount += bins.bins[b].count;
+				if (accumulatedCount == 0 || rightCount[b + 1] == 0)
+					continue;
+
+				const float cost = TRAVERSAL_COST + (accumulated.surfaceArea() * accumulatedCount +
+					rightArea[b + 1] * rightCount[b + 1]) * inverseArea;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = b;
+				}
+			}
+		}
+
+		uint32_t middle;
+		if (bestSplit >= 0)
+		{
+			middle = static_cast<uint32_t>(std::partition(references.begin() + task.begin, references.begin() + task.end,
+				[&](const Reference& reference)
+				{
+					return binIndex(reference.centroid[axis], minimum, scale) <= bestSplit;
+				}) - references.begin());
+		}
+		else if (count > MAX_LEAF_SIZE * 4)
+		{
+			// No split beats a leaf but the leaf would be huge, happens with coincident centroids.
+			middle = task.begin + count / 2;
+		}
+		else
+		{
+			makeLeaf(task);
+			return false;
+		}
+
+		const uint32_t children = nodeCount.fetch_add(2);
+		node.first = children;
+		node.count = 0;
+		parents[children] = task.node;
+		parents[children + 1] = task.node;
+		left = Task{ children, task.begin, middle };
+		right = Task{ children + 1, middle, task.end };
+		return true;
+	}
+
+	void Bvh::buildSubtree(const Task& task)
+	{
+		std::vector<Task> stack(1, task);
+		while (!stack.empty())
+		{
+			Task current = stack.back();
+			stack.pop_back();
+
+			Task left;
+			Task right;
+			if (split(current, left, right, 1))
+			{
+				stack.push_back(right);
+				stack.push_back(left);
+			}
+		}
+	}
+
+	void Bvh::makeLeaf(const Task& task)
+	{
+		Node& node = nodes[task.node];
+		node.first = task.begin;
+		node.count = task.end - task.begin;
+		for (uint32_t i = task.begin; i < task.end; i++)
+		{
+			indices[i] = references[i].instance;
+			leaves[indices[i]] = task.node;
+		}
+	}
+
+	void Bvh::refit(const std::vector<Aabb>& bounds)
+	{
+		boxes = bounds;
+		// Children are always allocated after their parent.
+		for (size_t n = nodes.size(); n-- > 0;)
+		{
+			Node& node = nodes[n];
+			Aabb box;
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; i++)
+					box.grow(bounds[indices[i]]);
+			}
+			else
+			{
+				box = nodes[node.first].bounds;
+				box.grow(nodes[node.first + 1].bounds);
+			}
+			node.bounds = box;
+		}
+	}
+
+	void Bvh::refit(const std::vector<Aabb>& bounds, const std::vector<uint32_t>& moved)
+	{
+		for (auto instance : moved)
+			boxes[instance] = bounds[instance];
+
+		for (auto instance : moved)
+		{
+			uint32_t n = leaves[instance];
+			for (;;)
+			{
+				Node& node = nodes[n];
+				Aabb box;
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.first; i < node.first + node.count; i++)
+						box.grow(bounds[indices[i]]);
+				}
+				else
+				{
+					box = nodes[node.first].bounds;
+					box.grow(nodes[node.first + 1].bounds);
+				}
+
+				// Ancestors of an unchanged node are up to date as well.
+				const bool changed = box.min != node.bounds.min || box.max != node.bounds.max;
+				node.bounds = box;
+				if (!changed || n == 0)
+					break;
+				n = parents[n];
+			}
+		}
+	}
+
+	void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& instances) const
+	{
+		if (nodes.empty())
+			return;
+
+		struct Entry
+		{
+			uint32_t node;
+			bool inside;
+		};
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		stack.push_back(Entry{ 0, false });
+		while (!stack.empty())
+		{
+			const Entry entry = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[entry.node];
+
+			bool inside = entry.inside;
+			if (!inside)
+			{
+				const int result = classify(frustum, node.bounds);
+				if (result == 0)
+					continue;
+				inside = result == 2;
+			}
+
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; i++)
+				{
+					if (inside || classify(frustum, boxes[indices[i]]) != 0)
+						instances.push_back(indices[i]);
+				}
+			}
+			else
+			{
+				stack.push_back(Entry{ node.first + 1, inside });
+				stack.push_back(Entry{ node.first, inside });
+			}
+		}
+	}
+
+	bool Bvh::raycast(const Ray& ray, RayHit& hit, const RayRefine& refine) const
+	{
+		hit.instance = INVALID_INSTANCE;
+		hit.t = ray.tMax;
+		if (nodes.empty())
+			return false;
+
+		const glm::vec3 inverseDirection = glm::vec3(1.0f) / ray.direction;
+		float tEntry;
+		if (!intersectBox(nodes[0].bounds, ray.origin, inverseDirection, hit.t, tEntry))
+			return false;
+
+		std::vector<uint32_t> stack;
+		stack.reserve(64);
+		stack.push_back(0);
+		while (!stack.empty())
+		{
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (!intersectBox(node.bounds, ray.origin, inverseDirection, hit.t, tEntry))
+				continue;
+
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; i++)
+				{
+					const uint32_t instance = indices[i];
+					float t;
+					if (!intersectBox(boxes[instance], ray.origin, inverseDirection, hit.t, t))
+						continue;
+					if (refine)
+					{
+						Ray local = ray;
+						local.tMax = hit.t;
+						if (!refine(instance, local, t) || t >= hit.t)
+							continue;
+					}
+					hit.t = t;
+					hit.instance = instance;
+				}
+				continue;
+			}
+
+			// Visit the nearer child first so the far one is likely culled by the closer hit.
+			float tLeft;
+			float tRight;
+			const bool hitLeft = intersectBox(nodes[node.first].bounds, ray.origin, inverseDirection, hit.t, tLeft);
+			const bool hitRight = intersectBox(nodes[node.first + 1].bounds, ray.origin, inverseDirection, hit.t, tRight);
+			if (hitLeft && hitRight)
+			{
+				const bool leftFirst = tLeft <= tRight;
+				stack.push_back(leftFirst ? node.first + 1 : node.first);
+				stack.push_back(leftFirst ? node.first : node.first + 1);
+			}
+			else if (hitLeft)
+				stack.push_back(node.first);
+			else if (hitRight)
+				stack.push_back(node.first + 1);
+		}
+		return hit.instance != INVALID_INSTANCE;
+	}
+
+	bool Bvh::nearest(const glm::vec3& point, uint32_t& instance, float& distance, float maxDistance) const
+	{
+		instance = INVALID_INSTANCE;
+		float best = maxDistance < std::numeric_limits<float>::max() ? maxDistance * maxDistance : maxDistance;
+		if (nodes.empty())
+			return false;
+
+		struct Entry
+		{
+			uint32_t node;
+			float distance;
+		};
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		stack.push_back(Entry{ 0, distanceSquared(nodes[0].bounds, point) });
+		while (!stack.empty())
+		{
+			const Entry entry = stack.back();
+			stack.pop_back();
+			if (entry.distance >= best)
+				continue;
+
+			const Node& node = nodes[entry.node];
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; i++)
+				{
+					const float d = distanceSquared(boxes[indices[i]], point);
+					if (d < best)
+					{
+						best = d;
+						instance = indices[i];
+					}
+				}
+				continue;
+			}
+
+			const float dLeft = distanceSquared(nodes[node.first].bounds, point);
+			const float dRight = distanceSquared(nodes[node.first + 1].bounds, point);
+			const bool leftFirst = dLeft <= dRight;
+			stack.push_back(Entry{ leftFirst ? node.first + 1 : node.first, leftFirst ? dRight : dLeft });
+			stack.push_back(Entry{ leftFirst ? node.first : node.first + 1, leftFirst ? dLeft : dRight });
+		}
+
+		if (instance == INVALID_INSTANCE)
+			return false;
+		distance = std::sqrt(best);
+		return true;
+	}
+
+	bool intersectTriangles(const Ray& ray, const Vertex* vertices, const GLuint* indices, size_t indexCount, float& t)
+	{
+		const float epsilon = 1e-8f;
+		bool hit = false;
+		t = ray.tMax;
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const glm::vec3& a = vertices[indices[i]].position;
+			const glm::vec3 edge1 = vertices[indices[i + 1]].position - a;
+			const glm::vec3 edge2 = vertices[indices[i + 2]].position - a;
+			const glm::vec3 p = glm::cross(ray.direction, edge2);
+			const float determinant = glm::dot(edge1, p);
+			if (std::abs(determinant) < epsilon)
+				continue;
+
+			const float inverse = 1.0f / determinant;
+			const glm::vec3 s = ray.origin - a;
+			const float u = glm::dot(s, p) * inverse;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+			const glm::vec3 q = glm::cross(s, edge1);
+			const float v = glm::dot(ray.direction, q) * inverse;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			const float distance = glm::dot(edge2, q) * inverse;
+			if (distance >= 0.0f && distance < t)
+			{
+				t = distance;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+}
@@ -1,5 +1,7 @@
 #include "camera.hpp"
 
+#include <cmath>
+
 namespace Simp
 {
 	Camera::Camera(glm::vec3 position, glm::vec3 yup, int width, int height) : yaw(Camera::YAW), pitch(Camera::PITCH),
@@ -21,6 +23,11 @@ namespace Simp
 		return glm::perspective(glm::radians(verticalFov), aspectratio, zNear, zFar);
 	}
 
+	Frustum Camera::getFrustum() const
+	{
+		return Frustum::fromMatrix(getProjectionMatrix() * getViewMatrix());
+	}
+
 	void Camera::resize(int _width, int _height)
 	{
 		width = _width;
@@ -28,6 +35,18 @@ namespace Simp
 		aspectratio = static_cast<float>(width) / static_cast<float>(height);
 	}
 
+	void Camera::lookAt(const glm::vec3& _position, const glm::vec3& target)
+	{
+		position = _position;
+		const glm::vec3 forward = target - position;
+		if (glm::length(forward) < 1e-6f)
+			return;
+		const glm::vec3 direction = glm::normalize(forward);
+		yaw = glm::degrees(std::atan2(direction.z, direction.x));
+		pitch = glm::clamp(glm::degrees(std::asin(direction.y)), -89.0f, 89.0f);
+		updateLocalVectors();
+	}
+
 	void Camera::processKeyboard(const glm::vec3& dir, float deltaTime)
 	{
 		glm::mat3 invRot = glm::transpose(glm::mat3(getViewMatrix()));
@@ -0,0 +1,321 @@
+#include "culling.hpp"
+
+#include <bitset>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+	#define SIMP_CULL_AVX2 1
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SIMP_CULL_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+namespace Simp
+{
+	namespace
+	{
+		size_t countVisible(const uint8_t* visibility, size_t count)
+		{
+			size_t visible = 0;
+			for (size_t i = 0; i < getVisibilityMaskSize(count); i++)
+				visible += std::bitset<8>(visibility[i]).count();
+			return visible;
+		}
+
+		void cullSpheresScalar(const Frustum& frustum, const CullingBounds& bounds, size_t begin, uint8_t* visibility)
+		{
+			for (size_t i = begin; i < bounds.size(); i++)
+			{
+				bool visible = true;
+				for (int p = 0; p < 6 && visible; p++)
+				{
+					const glm::vec4& plane = frustum.planes[p];
+					visible = plane.x * bounds.sphereX[i] + plane.y * bounds.sphereY[i] + plane.z * bounds.sphereZ[i] +
+						plane.w + bounds.radius[i] >= 0.0f;
+				}
+				if (visible)
+					visibility[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+			}
+		}
+
+		void cullBoxesScalar(const Frustum& frustum, const CullingBounds& bounds, size_t begin, uint8_t* visibility)
+		{
+			for (size_t i = begin; i < bounds.size(); i++)
+			{
+				bool visible = true;
+				for (int p = 0; p < 6 && visible; p++)
+				{
+					const glm::vec4& plane = frustum.planes[p];
+					const float distance = plane.x * bounds.boxX[i] + plane.y * bounds.boxY[i] + plane.z * bounds.boxZ[i] + plane.w;
+					const float radius = std::abs(plane.x) * bounds.extentX[i] + std::abs(plane.y) * bounds.extentY[i] +
+						std::abs(plane.z) * bounds.extentZ[i];
+					visible = distance + radius >= 0.0f;
+				}
+				if (visible)
+					visibility[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+			}
+		}
+	}
+
+	size_t CullingBounds::add(const glm::vec3& sphereCenter, float sphereRadius,
+							  const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		const size_t index = size();
+		sphereX.push_back(0.0f);
+		sphereY.push_back(0.0f);
+		sphereZ.push_back(0.0f);
+		radius.push_back(0.0f);
+		boxX.push_back(0.0f);
+		boxY.push_back(0.0f);
+		boxZ.push_back(0.0f);
+		extentX.push_back(0.0f);
+		extentY.push_back(0.0f);
+		extentZ.push_back(0.0f);
+		set(index, sphereCenter, sphereRadius, boxMin, boxMax);
+		return index;
+	}
+
+	void CullingBounds::set(size_t index, const glm::vec3& sphereCenter, float sphereRadius,
+							const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		sphereX[index] = sphereCenter.x;
+		sphereY[index] = sphereCenter.y;
+		sphereZ[index] = sphereCenter.z;
+		radius[index] = sphereRadius;
+		boxX[index] = (boxMin.x + boxMax.x) * 0.5f;
+		boxY[index] = (boxMin.y + boxMax.y) * 0.5f;
+		boxZ[index] = (boxMin.z + boxMax.z) * 0.5f;
+		extentX[index] = (boxMax.x - boxMin.x) * 0.5f;
+		extentY[index] = (boxMax.y - boxMin.y) * 0.5f;
+		extentZ[index] = (boxMax.z - boxMin.z) * 0.5f;
+	}
+
+	void CullingBounds::reserve(size_t count)
+	{
+		for (auto array : { &sphereX, &sphereY, &sphereZ, &radius, &boxX, &boxY, &boxZ, &extentX, &extentY, &extentZ })
+			array->reserve(count);
+	}
+
+	void CullingBounds::clear()
+	{
+		for (auto array : { &sphereX, &sphereY, &sphereZ, &radius, &boxX, &boxY, &boxZ, &extentX, &extentY, &extentZ })
+			array->clear();
+	}
+
+	size_t cullSpheresScalar(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		std::memset(visibility, 0, getVisibilityMaskSize(bounds.size()));
+		cullSpheresScalar(frustum, bounds, 0, visibility);
+		return countVisible(visibility, bounds.size());
+	}
+
+	size_t cullBoxesScalar(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		std::memset(visibility, 0, getVisibilityMaskSize(bounds.size()));
+		cullBoxesScalar(frustum, bounds, 0, visibility);
+		return countVisible(visibility, bounds.size());
+	}
+
+#if SIMP_CULL_AVX2
+	size_t cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		const size_t count = bounds.size();
+		const size_t blocks = count / 8;
+		std::memset(visibility, 0, getVisibilityMaskSize(count));
+
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		for (size_t block = 0; block < blocks; block++)
+		{
+			const size_t i = block * 8;
+			const __m256 x = _mm256_loadu_ps(&bounds.sphereX[i]);
+			const __m256 y = _mm256_loadu_ps(&bounds.sphereY[i]);
+			const __m256 z = _mm256_loadu_ps(&bounds.sphereZ[i]);
+			const __m256 r = _mm256_loadu_ps(&bounds.radius[i]);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][1], y));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], z));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+			}
+			visibility[block] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+		}
+
+		cullSpheresScalar(frustum, bounds, blocks * 8, visibility);
+		return countVisible(visibility, count);
+	}
+
+	size_t cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		const size_t count = bounds.size();
+		const size_t blocks = count / 8;
+		std::memset(visibility, 0, getVisibilityMaskSize(count));
+
+		__m256 planes[6][4];
+		__m256 absolute[6][3];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+			for (int c = 0; c < 3; c++)
+				absolute[p][c] = _mm256_set1_ps(std::abs(frustum.planes[p][c]));
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		for (size_t block = 0; block < blocks; block++)
+		{
+			const size_t i = block * 8;
+			const __m256 x = _mm256_loadu_ps(&bounds.boxX[i]);
+			const __m256 y = _mm256_loadu_ps(&bounds.boxY[i]);
+			const __m256 z = _mm256_loadu_ps(&bounds.boxZ[i]);
+			const __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+			const __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+			const __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][1], y));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], z));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(absolute[p][0], ex));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(absolute[p][1], ey));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(absolute[p][2], ez));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+			}
+			visibility[block] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+		}
+
+		cullBoxesScalar(frustum, bounds, blocks * 8, visibility);
+		return countVisible(visibility, count);
+	}
+
+	const char* getCullingInstructionSet()
+	{
+		return "AVX2";
+	}
+#elif SIMP_CULL_SSE2
+	size_t cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		const size_t count = bounds.size();
+		const size_t blocks = count / 8;
+		std::memset(visibility, 0, getVisibilityMaskSize(count));
+
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		for (size_t block = 0; block < blocks; block++)
+		{
+			int mask = 0;
+			for (int half = 0; half < 2; half++)
+			{
+				const size_t i = block * 8 + half * 4;
+				const __m128 x = _mm_loadu_ps(&bounds.sphereX[i]);
+				const __m128 y = _mm_loadu_ps(&bounds.sphereY[i]);
+				const __m128 z = _mm_loadu_ps(&bounds.sphereZ[i]);
+				const __m128 r = _mm_loadu_ps(&bounds.radius[i]);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int p = 0; p < 6; p++)
+				{
+					__m128 distance = _mm_add_ps(_mm_mul_ps(planes[p][0], x), planes[p][3]);
+					distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][1], y));
+					distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][2], z));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+				}
+				mask |= _mm_movemask_ps(inside) << (half * 4);
+			}
+			visibility[block] = static_cast<uint8_t>(mask);
+		}
+
+		cullSpheresScalar(frustum, bounds, blocks * 8, visibility);
+		return countVisible(visibility, count);
+	}
+
+	size_t cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		const size_t count = bounds.size();
+		const size_t blocks = count / 8;
+		std::memset(visibility, 0, getVisibilityMaskSize(count));
+
+		__m128 planes[6][4];
+		__m128 absolute[6][3];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+			for (int c = 0; c < 3; c++)
+				absolute[p][c] = _mm_set1_ps(std::abs(frustum.planes[p][c]));
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		for (size_t block = 0; block < blocks; block++)
+		{
+			int mask = 0;
+			for (int half = 0; half < 2; half++)
+			{
+				const size_t i = block * 8 + half * 4;
+				const __m128 x = _mm_loadu_ps(&bounds.boxX[i]);
+				const __m128 y = _mm_loadu_ps(&bounds.boxY[i]);
+				const __m128 z = _mm_loadu_ps(&bounds.boxZ[i]);
+				const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+				const __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+				const __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (int p = 0; p < 6; p++)
+				{
+					__m128 distance = _mm_add_ps(_mm_mul_ps(planes[p][0], x), planes[p][3]);
+					distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][1], y));
+					distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][2], z));
+					distance = _mm_add_ps(distance, _mm_mul_ps(absolute[p][0], ex));
+					distance = _mm_add_ps(distance, _mm_mul_ps(absolute[p][1], ey));
+					distance = _mm_add_ps(distance, _mm_mul_ps(absolute[p][2], ez));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+				}
+				mask |= _mm_movemask_ps(inside) << (half * 4);
+			}
+			visibility[block] = static_cast<uint8_t>(mask);
+		}
+
+		cullBoxesScalar(frustum, bounds, blocks * 8, visibility);
+		return countVisible(visibility, count);
+	}
+
+	const char* getCullingInstructionSet()
+	{
+		return "SSE2";
+	}
+#else
+	size_t cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		return cullSpheresScalar(frustum, bounds, visibility);
+	}
+
+	size_t cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint8_t* visibility)
+	{
+		return cullBoxesScalar(frustum, bounds, visibility);
+	}
+
+	const char* getCullingInstructionSet()
+	{
+		return "scalar";
+	}
+#endif
+}
@@ -0,0 +1,127 @@
+#include "fileCache.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <direct.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace Simp
+{
+	uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	uint64_t hashString(const std::string& str, uint64_t seed)
+	{
+		return hashBytes(str.data(), str.size(), seed);
+	}
+
+	std::string toHex(uint64_t value)
+	{
+		char buffer[17];
+		std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+		return buffer;
+	}
+
+	std::string cachePath(const std::string& name)
+	{
+		const std::string directory = SIMP_CACHE_DIR;
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+		return directory + '/' + name;
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (fileMapping == NULL)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		data = static_cast<const unsigned char*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0));
+		if (data == nullptr)
+		{
+			CloseHandle(fileMapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		size = static_cast<size_t>(fileSize.QuadPart);
+		handle = file;
+		mapping = fileMapping;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+			return false;
+
+		data = static_cast<const unsigned char*>(view);
+		size = static_cast<size_t>(info.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (data == nullptr)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(static_cast<HANDLE>(mapping));
+		CloseHandle(static_cast<HANDLE>(handle));
+#else
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+		data = nullptr;
+		size = 0;
+		handle = nullptr;
+		mapping = nullptr;
+	}
+}
@@ -0,0 +1,122 @@
+#include "framePacer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Simp
+{
+	namespace
+	{
+		double milliseconds(std::chrono::steady_clock::duration duration)
+		{
+			return std::chrono::duration<double, std::milli>(duration).count();
+		}
+	}
+
+	FramePacer::FramePacer(unsigned int _framesInFlight, double _latencyBound) : framesInFlight(0),
+		latencyBound(_latencyBound), pending(), first(0), count(0), started(false), totals(), retired(0)
+	{
+		setFramesInFlight(_framesInFlight);
+	}
+
+	FramePacer::~FramePacer()
+	{
+		for (; count > 0; count--)
+		{
+			glDeleteSync(pending[first].fence);
+			first = (first + 1) % MAX_FRAMES_IN_FLIGHT;
+		}
+	}
+
+	void FramePacer::setFramesInFlight(unsigned int _framesInFlight)
+	{
+		framesInFlight = std::min(_framesInFlight, MAX_FRAMES_IN_FLIGHT);
+	}
+
+	bool FramePacer::retire(GLuint64 timeout)
+	{
+		Pending& frame = pending[first];
+		// Blocking waits have to flush, or the fence may never reach the GPU.
+		const GLenum result = glClientWaitSync(frame.fence, timeout > 0 ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+		if (result == GL_TIMEOUT_EXPIRED)
+			return false;
+		if (result == GL_WAIT_FAILED)
+			std::cerr << "ERROR::FRAME_PACER::WAIT_FAILED" << std::endl;
+
+		totals.latency += milliseconds(Clock::now() - frame.submitted);
+		retired++;
+		glDeleteSync(frame.fence);
+		frame.fence = nullptr;
+		first = (first + 1) % MAX_FRAMES_IN_FLIGHT;
+		count--;
+		return true;
+	}
+
+	void FramePacer::beginFrame()
+	{
+		const Clock::time_point start = Clock::now();
+		if (started)
+		{
+			totals.frames++;
+			totals.frameTime += milliseconds(start - lastBegin);
+		}
+		lastBegin = start;
+		started = true;
+
+		// Frames the GPU already finished cost nothing to retire.
+		while (count > 0 && retire(0))
+			;
+		totals.queuedFrames += count;
+
+		while (count > 0 && count >= framesInFlight)
+		{
+			while (!retire(1000000))
+				;
+		}
+		if (latencyBound > 0.0 && count > 0 && milliseconds(Clock::now() - pending[first].submitted) > latencyBound)
+		{
+			// The GPU is the bottleneck, input sampled now would only be shown after the whole queue.
+			totals.latencyWaits++;
+			while (count > 0 && milliseconds(Clock::now() - pending[first].submitted) > latencyBound)
+			{
+				while (!retire(1000000))
+					;
+			}
+		}
+		totals.waitTime += milliseconds(Clock::now() - start);
+	}
+
+	void FramePacer::endFrame()
+	{
+		if (framesInFlight == 0)
+		{
+			glFinish();
+			return;
+		}
+
+		if (count == MAX_FRAMES_IN_FLIGHT)
+		{
+			// Only after setFramesInFlight lowered the count without a beginFrame in between.
+			while (!retire(1000000))
+				;
+		}
+		Pending& frame = pending[(first + count) % MAX_FRAMES_IN_FLIGHT];
+		frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame.submitted = Clock::now();
+		count++;
+	}
+
+	FramePacer::Stats FramePacer::getStats() const
+	{
+		Stats average = totals;
+		if (totals.frames > 0)
+		{
+			average.frameTime /= totals.frames;
+			average.waitTime /= totals.frames;
+			average.queuedFrames /= totals.frames;
+		}
+		if (retired > 0)
+			average.latency /= retired;
+		return average;
+	}
+}
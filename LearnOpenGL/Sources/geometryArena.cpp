@@ -0,0 +1,335 @@
+#include "geometryArena.hpp"
+#include "glState.hpp"
+#include "mesh.hpp"
+#include "vertexCompression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Simp
+{
+	VertexFormat VertexFormat::standard()
+	{
+		VertexFormat format;
+		format.stride = sizeof(Vertex);
+		format.attributes = {
+			{ 0, 3, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(Vertex, position)) },
+			{ 1, 3, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(Vertex, normal)) },
+			{ 2, 2, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(Vertex, uv)) },
+			{ 3, 4, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(Vertex, tangent)) }
+		};
+		format.quantized = false;
+		return format;
+	}
+
+	VertexFormat VertexFormat::compact()
+	{
+		VertexFormat format;
+		format.stride = sizeof(CompactVertex);
+		format.attributes = {
+			{ 0, 4, GL_UNSIGNED_SHORT, GL_TRUE, static_cast<GLuint>(offsetof(CompactVertex, position)) },
+			{ 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, static_cast<GLuint>(offsetof(CompactVertex, normal)) },
+			{ 2, 2, GL_HALF_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(CompactVertex, uv)) },
+			{ 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, static_cast<GLuint>(offsetof(CompactVertex, tangent)) }
+		};
+		format.quantized = true;
+		return format;
+	}
+
+	void RangeAllocator::reset(size_t _capacity, size_t used)
+	{
+		capacity = _capacity;
+		freeSize = capacity - used;
+		freeBlocks.clear();
+		if (freeSize > 0)
+			freeBlocks[used] = freeSize;
+	}
+
+	void RangeAllocator::grow(size_t _capacity)
+	{
+		if (_capacity <= capacity)
+			return;
+
+		size_t oldCapacity = capacity;
+		capacity = _capacity;
+		free(oldCapacity, capacity - oldCapacity);
+	}
+
+	size_t RangeAllocator::allocate(size_t size)
+	{
+		for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+		{
+			if (it->second < size)
+				continue;
+
+			size_t offset = it->first;
+			size_t remaining = it->second - size;
+			freeBlocks.erase(it);
+			if (remaining > 0)
+				freeBlocks[offset + size] = remaining;
+			freeSize -= size;
+			return offset;
+		}
+		return INVALID;
+	}
+
+	void RangeAllocator::free(size_t offset, size_t size)
+	{
+		if (size == 0)
+			return;
+
+		freeSize += size;
+		auto next = freeBlocks.lower_bound(offset);
+		if (next != freeBlocks.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				size += previous->second;
+				freeBlocks.erase(previous);
+			}
+		}
+		if (next != freeBlocks.end() && offset + size == next->first)
+		{
+			size += next->second;
+			freeBlocks.erase(next);
+		}
+		freeBlocks[offset] = size;
+	}
+
+	size_t RangeAllocator::getLargestFree() const
+	{
+		size_t largest = 0;
+		for (const auto& block : freeBlocks)
+		{
+			largest = std::max(largest, block.second);
+		}
+		return largest;
+	}
+
+	GeometryArena::GeometryArena(const VertexFormat& _format, size_t vertexCapacity, size_t indexCapacity)
+		: format(_format), generation(0)
+	{
+		glGenVertexArrays(1, &vao);
+		createBuffers(vertexCapacity, indexCapacity * sizeof(GLuint), vbo, ebo);
+		vertices.reset(vertexCapacity);
+		indices.reset(indexCapacity * sizeof(GLuint));
+		setupVertexArray();
+	}
+
+	GeometryArena::~GeometryArena()
+	{
+		GLState::get().deleteVertexArray(vao);
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ebo);
+	}
+
+	void GeometryArena::createBuffers(size_t vertexCapacity, size_t indexBytes, GLuint& newVbo, GLuint& newEbo) const
+	{
+		glGenBuffers(1, &newVbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * format.stride, NULL, GL_STATIC_DRAW);
+
+		glGenBuffers(1, &newEbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newEbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, indexBytes, NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void GeometryArena::setupVertexArray()
+	{
+		GLState::get().bindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		for (const auto& attribute : format.attributes)
+		{
+			glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+				format.stride, reinterpret_cast<void*>(static_cast<uintptr_t>(attribute.offset)));
+			glEnableVertexAttribArray(attribute.location);
+		}
+		GLState::get().bindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void GeometryArena::reserve(size_t vertexCount, size_t indexBytes)
+	{
+		size_t vertexCapacity = vertices.getCapacity();
+		size_t indexCapacity = indices.getCapacity();
+		if (vertices.getLargestFree() < vertexCount)
+			vertexCapacity = std::max(vertexCapacity * 2, vertexCapacity + vertexCount);
+		if (indices.getLargestFree() < indexBytes)
+			indexCapacity = std::max(indexCapacity * 2, indexCapacity + indexBytes);
+		if (vertexCapacity == vertices.getCapacity() && indexCapacity == indices.getCapacity())
+			return;
+
+		// Grow by copying into larger buffers on the GPU, offsets stay the same.
+		GLuint newVbo;
+		GLuint newEbo;
+		createBuffers(vertexCapacity, indexCapacity, newVbo, newEbo);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertices.getCapacity() * format.stride);
+		glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, newEbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, indices.getCapacity());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ebo);
+		vbo = newVbo;
+		ebo = newEbo;
+		vertices.grow(vertexCapacity);
+		indices.grow(indexCapacity);
+		setupVertexArray();
+	}
+
+	GeometryArena::Handle GeometryArena::allocate(const void* vertexData, GLsizei vertexCount,
+												  const GLuint* indexData, GLsizei indexCount)
+	{
+		// Ranges stay 4 byte aligned so 16 and 32 bit index ranges can share the buffer.
+		const size_t indexSize = vertexCount <= 65536 ? sizeof(GLushort) : sizeof(GLuint);
+		const size_t indexBytes = (indexCount * indexSize + 3) & ~static_cast<size_t>(3);
+		reserve(vertexCount, indexBytes);
+
+		Allocation allocation;
+		allocation.vertexOffset = vertices.allocate(vertexCount);
+		allocation.vertexCount = vertexCount;
+		allocation.indexOffset = indices.allocate(indexBytes);
+		allocation.indexCount = indexCount;
+		allocation.indexSize = indexSize;
+		allocation.live = true;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.vertexOffset * format.stride,
+			vertexCount * format.stride, vertexData);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+		if (indexSize == sizeof(GLushort))
+		{
+			std::vector<GLushort> shortIndices(indexData, indexData + indexCount);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, indexCount * indexSize, shortIndices.data());
+		}
+		else
+		{
+			glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, indexCount * indexSize, indexData);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		if (!freeHandles.empty())
+		{
+			Handle handle = freeHandles.back();
+			freeHandles.pop_back();
+			allocations[handle] = allocation;
+			return handle;
+		}
+		allocations.push_back(allocation);
+		return static_cast<Handle>(allocations.size() - 1);
+	}
+
+	void GeometryArena::free(Handle handle)
+	{
+		Allocation& allocation = allocations[handle];
+		if (!allocation.live)
+			return;
+
+		vertices.free(allocation.vertexOffset, allocation.vertexCount);
+		indices.free(allocation.indexOffset, getIndexBytes(allocation));
+		allocation.live = false;
+		freeHandles.push_back(handle);
+	}
+
+	GeometryArena::DrawRange GeometryArena::getDrawRange(Handle handle) const
+	{
+		return getDrawRange(handle, 0, static_cast<GLsizei>(allocations[handle].indexCount));
+	}
+
+	GeometryArena::DrawRange GeometryArena::getDrawRange(Handle handle, GLuint firstIndex, GLsizei indexCount) const
+	{
+		const Allocation& allocation = allocations[handle];
+		DrawRange range;
+		range.baseVertex = static_cast<GLint>(allocation.vertexOffset);
+		range.firstIndex = static_cast<GLuint>(allocation.indexOffset / allocation.indexSize) + firstIndex;
+		range.indexCount = indexCount;
+		range.indexType = getIndexType(allocation);
+		return range;
+	}
+
+	void GeometryArena::bind() const
+	{
+		GLState::get().bindVertexArray(vao);
+	}
+
+	void GeometryArena::draw(Handle handle) const
+	{
+		draw(handle, 0, static_cast<GLsizei>(allocations[handle].indexCount));
+	}
+
+	void GeometryArena::draw(Handle handle, GLuint firstIndex, GLsizei indexCount) const
+	{
+		const Allocation& allocation = allocations[handle];
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, getIndexType(allocation),
+			reinterpret_cast<void*>(allocation.indexOffset + firstIndex * allocation.indexSize),
+			static_cast<GLint>(allocation.vertexOffset));
+	}
+
+	float GeometryArena::getFragmentation() const
+	{
+		float vertexFragmentation = vertices.getFreeSize() == 0 ? 0.0f :
+			1.0f - static_cast<float>(vertices.getLargestFree()) / vertices.getFreeSize();
+		float indexFragmentation = indices.getFreeSize() == 0 ? 0.0f :
+			1.0f - static_cast<float>(indices.getLargestFree()) / indices.getFreeSize();
+		return std::max(vertexFragmentation, indexFragmentation);
+	}
+
+	void GeometryArena::defragment()
+	{
+		GLuint newVbo;
+		GLuint newEbo;
+		createBuffers(vertices.getCapacity(), indices.getCapacity(), newVbo, newEbo);
+
+		// Indices are relative to the base vertex, so moving ranges needs no index rewrite.
+		size_t vertexCursor = 0;
+		size_t indexCursor = 0;
+		for (auto& allocation : allocations)
+		{
+			if (!allocation.live)
+				continue;
+
+			glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, newVbo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.vertexOffset * format.stride,
+				vertexCursor * format.stride, allocation.vertexCount * format.stride);
+			glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, newEbo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.indexOffset,
+				indexCursor, getIndexBytes(allocation));
+
+			allocation.vertexOffset = vertexCursor;
+			allocation.indexOffset = indexCursor;
+			vertexCursor += allocation.vertexCount;
+			indexCursor += getIndexBytes(allocation);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ebo);
+		vbo = newVbo;
+		ebo = newEbo;
+		vertices.reset(vertices.getCapacity(), vertexCursor);
+		indices.reset(indices.getCapacity(), indexCursor);
+		setupVertexArray();
+		generation++;
+	}
+
+	bool GeometryArena::maybeDefragment(float threshold)
+	{
+		if (getFragmentation() < threshold)
+			return false;
+
+		defragment();
+		return true;
+	}
+}
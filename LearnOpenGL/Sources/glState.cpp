@@ -0,0 +1,251 @@
+#include "glState.hpp"
+
+namespace Simp
+{
+	namespace
+	{
+		int getCapability(GLenum cap)
+		{
+			switch (cap)
+			{
+			case GL_BLEND: return 0;
+			case GL_CULL_FACE: return 1;
+			case GL_DEPTH_TEST: return 2;
+			case GL_STENCIL_TEST: return 3;
+			case GL_SCISSOR_TEST: return 4;
+			default: return -1;
+			}
+		}
+
+		int getTextureTarget(GLenum target)
+		{
+			switch (target)
+			{
+			case GL_TEXTURE_2D: return 0;
+			case GL_TEXTURE_CUBE_MAP: return 1;
+			default: return -1;
+			}
+		}
+	}
+
+	GLState& GLState::get()
+	{
+		static GLState state;
+		return state;
+	}
+
+	GLState::GLState() : stats()
+	{
+		invalidate();
+	}
+
+	bool GLState::issue(unsigned int& counter)
+	{
+		stats.issued++;
+		counter++;
+		return true;
+	}
+
+	bool GLState::filter()
+	{
+		stats.filtered++;
+		return false;
+	}
+
+	bool GLState::useProgram(GLuint _program)
+	{
+		if (program == _program)
+			return filter();
+		program = _program;
+		glUseProgram(program);
+		return issue(stats.programIssued);
+	}
+
+	bool GLState::bindVertexArray(GLuint _vertexArray)
+	{
+		if (vertexArray == _vertexArray)
+			return filter();
+		vertexArray = _vertexArray;
+		glBindVertexArray(vertexArray);
+		return issue(stats.vertexArrayIssued);
+	}
+
+	bool GLState::activeTexture(unsigned int unit)
+	{
+		if (activeUnit == unit)
+			return filter();
+		activeUnit = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		return issue(stats.textureIssued);
+	}
+
+	bool GLState::bindTexture(unsigned int unit, GLenum target, GLuint texture)
+	{
+		const int index = getTextureTarget(target);
+		if (index >= 0 && unit < MAX_TEXTURE_UNITS && textures[unit][index] == texture)
+			return filter();
+		activeTexture(unit);
+		return bindTexture(target, texture);
+	}
+
+	bool GLState::bindTexture(GLenum target, GLuint texture)
+	{
+		const int index = getTextureTarget(target);
+		const bool cached = index >= 0 && activeUnit < MAX_TEXTURE_UNITS;
+		if (cached && textures[activeUnit][index] == texture)
+			return filter();
+		if (cached)
+			textures[activeUnit][index] = texture;
+		glBindTexture(target, texture);
+		return issue(stats.textureIssued);
+	}
+
+	bool GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		const bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+		const bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+		if ((!draw || drawFramebuffer == framebuffer) && (!read || readFramebuffer == framebuffer))
+			return filter();
+		if (draw)
+			drawFramebuffer = framebuffer;
+		if (read)
+			readFramebuffer = framebuffer;
+		glBindFramebuffer(target, framebuffer);
+		return issue(stats.framebufferIssued);
+	}
+
+	bool GLState::setEnabled(GLenum cap, bool enabled)
+	{
+		const int index = getCapability(cap);
+		if (index >= 0)
+		{
+			if (capabilities[index] == (enabled ? 1 : 0))
+				return filter();
+			capabilities[index] = enabled ? 1 : 0;
+		}
+		if (enabled)
+			glEnable(cap);
+		else
+			glDisable(cap);
+		return issue(stats.capabilityIssued);
+	}
+
+	bool GLState::blendFunc(GLenum source, GLenum destination)
+	{
+		if (blendSource == source && blendDestination == destination)
+			return filter();
+		blendSource = source;
+		blendDestination = destination;
+		glBlendFunc(source, destination);
+		return issue(stats.capabilityIssued);
+	}
+
+	bool GLState::depthFunc(GLenum func)
+	{
+		if (depthFunction == func)
+			return filter();
+		depthFunction = func;
+		glDepthFunc(func);
+		return issue(stats.capabilityIssued);
+	}
+
+	bool GLState::depthMask(bool write)
+	{
+		if (depthWrite == (write ? 1 : 0))
+			return filter();
+		depthWrite = write ? 1 : 0;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+		return issue(stats.capabilityIssued);
+	}
+
+	bool GLState::cullFace(GLenum mode)
+	{
+		if (cullMode == mode)
+			return filter();
+		cullMode = mode;
+		glCullFace(mode);
+		return issue(stats.capabilityIssued);
+	}
+
+	bool GLState::frontFace(GLenum mode)
+	{
+		if (frontMode == mode)
+			return filter();
+		frontMode = mode;
+		glFrontFace(mode);
+		return issue(stats.capabilityIssued);
+	}
+
+	bool GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height)
+			return filter();
+		viewportRect[0] = x;
+		viewportRect[1] = y;
+		viewportRect[2] = width;
+		viewportRect[3] = height;
+		glViewport(x, y, width, height);
+		return issue(stats.framebufferIssued);
+	}
+
+	void GLState::deleteProgram(GLuint _program)
+	{
+		// A deleted program stays in use until another one is, but its name may be reused.
+		if (program == _program)
+			program = UNKNOWN;
+		glDeleteProgram(_program);
+	}
+
+	void GLState::deleteVertexArray(GLuint _vertexArray)
+	{
+		if (vertexArray == _vertexArray)
+			vertexArray = 0;
+		glDeleteVertexArrays(1, &_vertexArray);
+	}
+
+	void GLState::deleteTexture(GLuint texture)
+	{
+		for (auto& unit : textures)
+		{
+			for (GLuint& bound : unit)
+			{
+				if (bound == texture)
+					bound = 0;
+			}
+		}
+		glDeleteTextures(1, &texture);
+	}
+
+	void GLState::deleteFramebuffer(GLuint framebuffer)
+	{
+		if (drawFramebuffer == framebuffer)
+			drawFramebuffer = 0;
+		if (readFramebuffer == framebuffer)
+			readFramebuffer = 0;
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+	void GLState::invalidate()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (auto& unit : textures)
+		{
+			for (GLuint& bound : unit)
+				bound = UNKNOWN;
+		}
+		drawFramebuffer = UNKNOWN;
+		readFramebuffer = UNKNOWN;
+		for (int& capability : capabilities)
+			capability = -1;
+		blendSource = UNKNOWN;
+		blendDestination = UNKNOWN;
+		depthFunction = UNKNOWN;
+		depthWrite = -1;
+		cullMode = UNKNOWN;
+		frontMode = UNKNOWN;
+		viewportRect[0] = viewportRect[1] = 0;
+		viewportRect[2] = viewportRect[3] = -1;
+	}
+}
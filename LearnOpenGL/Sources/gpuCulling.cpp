@@ -0,0 +1,176 @@
+#include "gpuCulling.hpp"
+#include "glState.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+namespace Simp
+{
+	namespace
+	{
+		const GLuint GROUP_SIZE = 64;
+
+		GLuint createBuffer(GLsizeiptr size, const void* data)
+		{
+			GLuint buffer;
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<GLsizeiptr>(size, 4), data, GL_STATIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			return buffer;
+		}
+	}
+
+	GpuCulling::GpuCulling(const Model& _model, const GeometryArena& _arena, const std::vector<InstanceData>& instances)
+		: model(_model), arena(_arena), arenaGeneration(_arena.getGeneration()), instanceCount(instances.size()),
+		commandCount(0)
+	{
+		cullShader.attach("cull.comp").link();
+		compactShader.attach("cull.comp").define("COMPACT").link();
+		for (int i = 0; i < 6; i++)
+		{
+			const std::string name = "planes[" + std::to_string(i) + "]";
+			planes[i] = cullShader.getUniform(UniformName(name.c_str()));
+		}
+
+		const auto& meshes = model.getMeshes();
+		std::vector<MeshRecord> records(meshes.size());
+		const std::vector<Command> commands = makeCommands();
+		uint32_t firstCommand = 0;
+		draws.resize(meshes.size());
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const Mesh& mesh = *meshes[i];
+			MeshRecord& record = records[i];
+			record.boxCenter = glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 0.0f);
+			record.boxExtent = glm::vec4((mesh.boundsMax - mesh.boundsMin) * 0.5f, 0.0f);
+			record.sphere = glm::vec4(mesh.boundsCenter, mesh.boundsRadius);
+			record.firstCommand = firstCommand;
+			record.lodCount = static_cast<uint32_t>(std::min<size_t>(std::max<size_t>(mesh.lods.size(), 1), MAX_LODS));
+			record.padding[0] = record.padding[1] = 0;
+			for (uint32_t lod = 0; lod < MAX_LODS; lod++)
+				record.errors[lod] = lod < mesh.lods.size() ? mesh.lods[lod].error : 0.0f;
+			firstCommand += record.lodCount;
+
+			IndirectDraw& draw = draws[i];
+			draw.commandOffset = (meshes.size() + record.firstCommand * 5) * sizeof(GLuint);
+			draw.maxDrawCount = static_cast<GLsizei>(record.lodCount);
+			draw.countOffset = i * sizeof(GLuint);
+		}
+		commandCount = commands.size();
+
+		instanceBuffer = createBuffer(instanceCount * sizeof(InstanceData), instances.data());
+		meshBuffer = createBuffer(records.size() * sizeof(MeshRecord), records.data());
+		commandBuffer = createBuffer(commandCount * sizeof(Command), commands.data());
+		visibleBuffer = createBuffer(commandCount * instanceCount * sizeof(GLuint), nullptr);
+		drawBuffer = createBuffer(meshes.size() * sizeof(GLuint) + commandCount * sizeof(Command), nullptr);
+		for (IndirectDraw& draw : draws)
+		{
+			draw.commandBuffer = drawBuffer;
+			draw.countBuffer = drawBuffer;
+		}
+
+		// The visible list doubles as an instanced attribute, the baseInstance of a command offsets into it.
+		GLState::get().bindVertexArray(arena.getVertexArray());
+		glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+		glVertexAttribIPointer(INSTANCE_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+		glVertexAttribDivisor(INSTANCE_ATTRIBUTE, 1);
+		glEnableVertexAttribArray(INSTANCE_ATTRIBUTE);
+		GLState::get().bindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		std::cout << "INFO::GPU_CULLING " << instanceCount << " instances, " << meshes.size() << " meshes, "
+			<< commandCount << " commands, " << (RenderQueue::hasDrawIndirectCount() ? "indirect count" : "fixed count")
+			<< std::endl;
+	}
+
+	GpuCulling::~GpuCulling()
+	{
+		const GLuint buffers[] = { instanceBuffer, meshBuffer, commandBuffer, visibleBuffer, drawBuffer };
+		glDeleteBuffers(5, buffers);
+	}
+
+	std::vector<GpuCulling::Command> GpuCulling::makeCommands() const
+	{
+		// One command per mesh level, every command owns instanceCount slots of the visible list.
+		std::vector<Command> commands;
+		for (const auto& mesh : model.getMeshes())
+		{
+			const size_t lodCount = std::min<size_t>(std::max<size_t>(mesh->lods.size(), 1), MAX_LODS);
+			for (uint32_t lod = 0; lod < lodCount; lod++)
+			{
+				const GeometryArena::DrawRange range = mesh->getDrawRange(lod);
+				Command command;
+				command.count = static_cast<GLuint>(range.indexCount);
+				command.instanceCount = 0;
+				command.firstIndex = range.firstIndex;
+				command.baseVertex = range.baseVertex;
+				command.baseInstance = static_cast<GLuint>(commands.size() * instanceCount);
+				commands.push_back(command);
+			}
+		}
+		return commands;
+	}
+
+	void GpuCulling::cull(const Camera& camera, const LodSelector& selector)
+	{
+		if (instanceCount == 0)
+			return;
+
+		// Same commands in the same order, only the ranges moved.
+		if (arena.getGeneration() != arenaGeneration)
+		{
+			const std::vector<Command> commands = makeCommands();
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			arenaGeneration = arena.getGeneration();
+		}
+
+		const Frustum frustum = camera.getFrustum();
+		for (int i = 0; i < 6; i++)
+			cullShader.bind(planes[i], frustum.planes[i]);
+		cullShader.bind(SIMP_UNIFORM("cameraPosition"), camera.getPosition());
+		cullShader.bind(SIMP_UNIFORM("pixelsPerUnit"), selector.getPixelsPerUnit());
+		cullShader.bind(SIMP_UNIFORM("threshold"), selector.getPixelError());
+		cullShader.bind(SIMP_UNIFORM("instanceCount"), static_cast<GLuint>(instanceCount));
+		cullShader.bind(SIMP_UNIFORM("meshCount"), static_cast<GLuint>(draws.size()));
+		compactShader.bind(SIMP_UNIFORM("meshCount"), static_cast<GLuint>(draws.size()));
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCES_BINDING, instanceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESHES_BINDING, meshBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, commandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OUTPUT_BINDING, visibleBuffer);
+		cullShader.use();
+		glDispatchCompute(static_cast<GLuint>((instanceCount + GROUP_SIZE - 1) / GROUP_SIZE), 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OUTPUT_BINDING, drawBuffer);
+		compactShader.use();
+		glDispatchCompute(static_cast<GLuint>((draws.size() + GROUP_SIZE - 1) / GROUP_SIZE), 1, 1);
+		// The draws read the commands and counts as indirect parameters and the visible list as an attribute.
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	void GpuCulling::submit(RenderQueue& queue, ShaderVariants& variants)
+	{
+		DrawObject object;
+		object.invModel = glm::mat3(1.0f);
+		object.flags = DrawObject::NORMAL_MATRIX;
+		if (model.isQuantized())
+			object.flags |= DrawObject::COMPACT;
+
+		const auto& meshes = model.getMeshes();
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const Mesh& mesh = *meshes[i];
+			object.positionScale = mesh.positionScale;
+			object.positionOffset = mesh.positionOffset;
+			DrawPacket packet = mesh.makePacket(variants.get(mesh.material.maps | INSTANCED | INDIRECT),
+				queue.addObject(object), 0, 0.0f);
+			packet.indirect = &draws[i];
+			queue.submit(packet);
+		}
+	}
+}
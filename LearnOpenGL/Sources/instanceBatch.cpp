@@ -0,0 +1,112 @@
+#include "instanceBatch.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace Simp
+{
+	InstanceData InstanceData::make(const glm::mat4& model, const glm::vec4& parameters)
+	{
+		const glm::mat3 normal = glm::inverseTranspose(glm::mat3(model));
+		InstanceData instance;
+		instance.model = model;
+		for (int i = 0; i < 3; i++)
+			instance.normalMatrix[i] = glm::vec4(normal[i], 0.0f);
+		instance.parameters = parameters;
+		return instance;
+	}
+
+	InstanceBatch::InstanceBatch(size_t capacity) : lastDraw(0),
+		buffer(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(InstanceData)), stats()
+	{
+	}
+
+	uint64_t InstanceBatch::hashPacket(const DrawPacket& packet)
+	{
+		// FNV-1a over the fields that identify the draw, the object and key are not part of it.
+		const uint64_t fields[] = {
+			reinterpret_cast<uintptr_t>(packet.shader), reinterpret_cast<uintptr_t>(packet.material),
+			packet.vertexArray, packet.state, packet.mode, packet.indexType,
+			static_cast<uint32_t>(packet.baseVertex), packet.first, static_cast<uint32_t>(packet.count)
+		};
+		uint64_t hash = 14695981039346656037ull;
+		for (uint64_t field : fields)
+		{
+			hash ^= field;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool InstanceBatch::isSameDraw(const DrawPacket& a, const DrawPacket& b)
+	{
+		return a.shader == b.shader && a.material == b.material && a.vertexArray == b.vertexArray &&
+			a.state == b.state && a.mode == b.mode && a.indexType == b.indexType &&
+			a.baseVertex == b.baseVertex && a.first == b.first && a.count == b.count;
+	}
+
+	void InstanceBatch::add(const DrawPacket& packet, const InstanceData& instance)
+	{
+		// Instances of the same draw usually come in runs.
+		if (lastDraw >= draws.size() || !isSameDraw(draws[lastDraw].packet, packet))
+		{
+			const uint64_t hash = hashPacket(packet);
+			auto range = lookup.equal_range(hash);
+			auto found = range.first;
+			while (found != range.second && !isSameDraw(draws[found->second].packet, packet))
+				++found;
+			if (found != range.second)
+			{
+				lastDraw = found->second;
+			}
+			else
+			{
+				lastDraw = draws.size();
+				lookup.emplace(hash, lastDraw);
+				draws.push_back(Draw());
+			}
+		}
+
+		Draw& draw = draws[lastDraw];
+		// The first instance of the frame decides the key and object.
+		if (draw.instances.empty())
+			draw.packet = packet;
+		draw.instances.push_back(instance);
+	}
+
+	void InstanceBatch::submit(RenderQueue& queue)
+	{
+		stats = Stats();
+		for (const Draw& draw : draws)
+			stats.instances += draw.instances.size();
+		if (stats.instances == 0)
+			return;
+
+		stats.bytes = stats.instances * sizeof(InstanceData);
+		buffer.advance();
+		buffer.reserve(stats.bytes);
+
+		GLuint offset = 0;
+		for (const Draw& draw : draws)
+		{
+			if (draw.instances.empty())
+				continue;
+
+			buffer.write(offset * sizeof(InstanceData), draw.instances.data(), draw.instances.size() * sizeof(InstanceData));
+			DrawPacket packet = draw.packet;
+			packet.instanceCount = static_cast<GLsizei>(draw.instances.size());
+			packet.baseInstance = offset;
+			queue.submit(packet);
+			offset += packet.instanceCount;
+			stats.draws++;
+		}
+		buffer.bind(INSTANCES_BINDING, stats.bytes);
+	}
+
+	void InstanceBatch::clear()
+	{
+		// Draws stay registered, the same props come back next frame.
+		for (Draw& draw : draws)
+			draw.instances.clear();
+		lastDraw = 0;
+	}
+}
@@ -0,0 +1,297 @@
+#include "jobSystem.hpp"
+
+#include <cstdlib>
+
+namespace Simp
+{
+	struct Job
+	{
+		std::function<void()> function;
+		JobLane lane;
+		// Unfinished dependencies, plus one held while the job is being scheduled.
+		std::atomic<size_t> blockers;
+		std::atomic<bool> done;
+		std::mutex mutex;
+		// Jobs depending on this one, released once it is done. Guarded by mutex.
+		std::vector<std::shared_ptr<Job>> continuations;
+	};
+
+	namespace
+	{
+		const unsigned int NO_QUEUE = 0xFFFFFFFFu;
+		// Failed searches before an idle worker goes to sleep.
+		const unsigned int IDLE_SPINS = 64;
+
+		// Deque of the calling thread.
+		thread_local unsigned int threadQueue = NO_QUEUE;
+	}
+
+	bool JobHandle::isDone() const
+	{
+		return !job || job->done.load(std::memory_order_acquire);
+	}
+
+	unsigned int JobSystem::defaultWorkerCount()
+	{
+		if (const char* value = std::getenv("SIMP_JOB_THREADS"))
+			return static_cast<unsigned int>(std::atoi(value));
+
+		unsigned int hardware = std::thread::hardware_concurrency();
+		return hardware > 1 ? hardware - 1 : 1;
+	}
+
+	JobSystem& JobSystem::get()
+	{
+		static JobSystem system;
+		return system;
+	}
+
+	JobSystem::JobSystem() : workerCount(defaultWorkerCount()), mainThread(std::this_thread::get_id()), queued(0),
+		sleeping(0), nextQueue(0), stopping(false)
+	{
+		threadQueue = 0;
+		for (unsigned int i = 0; i <= workerCount; i++)
+		{
+			queues.emplace_back(new Queue());
+			queues.back()->size = 0;
+			queues.back()->executed = 0;
+			queues.back()->stolen = 0;
+		}
+		for (unsigned int i = 1; i <= workerCount; i++)
+		{
+			workers.emplace_back(&JobSystem::work, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	JobHandle JobSystem::schedule(std::function<void()> function, JobLane lane)
+	{
+		return create(function, nullptr, 0, lane);
+	}
+
+	JobHandle JobSystem::schedule(std::function<void()> function, std::initializer_list<JobHandle> dependencies,
+		JobLane lane)
+	{
+		return create(function, dependencies.begin(), dependencies.size(), lane);
+	}
+
+	JobHandle JobSystem::schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies,
+		JobLane lane)
+	{
+		return create(function, dependencies.data(), dependencies.size(), lane);
+	}
+
+	JobHandle JobSystem::create(std::function<void()>& function, const JobHandle* dependencies, size_t count,
+		JobLane lane)
+	{
+		auto job = std::make_shared<Job>();
+		job->function = std::move(function);
+		job->lane = lane;
+		job->blockers.store(count + 1, std::memory_order_relaxed);
+		job->done.store(false, std::memory_order_relaxed);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const std::shared_ptr<Job>& dependency = dependencies[i].job;
+			if (dependency)
+			{
+				std::lock_guard<std::mutex> lock(dependency->mutex);
+				if (!dependency->done.load(std::memory_order_relaxed))
+				{
+					dependency->continuations.push_back(job);
+					continue;
+				}
+			}
+			job->blockers.fetch_sub(1, std::memory_order_relaxed);
+		}
+		release(job);
+		return JobHandle(job);
+	}
+
+	void JobSystem::release(const std::shared_ptr<Job>& job)
+	{
+		if (job->blockers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			push(job);
+	}
+
+	void JobSystem::push(const std::shared_ptr<Job>& job)
+	{
+		if (job->lane == JobLane::Main)
+		{
+			std::lock_guard<std::mutex> lock(mainMutex);
+			mainJobs.push_back(job);
+			return;
+		}
+
+		// Threads outside the system hand their jobs to the workers in turn.
+		unsigned int index = threadQueue;
+		if (index == NO_QUEUE)
+			index = workerCount == 0 ? 0 : 1 + nextQueue.fetch_add(1, std::memory_order_relaxed) % workerCount;
+
+		// Counted before it is visible, so a worker never sleeps on a queued job.
+		queued.fetch_add(1);
+		Queue& queue = *queues[index];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+			queue.size.store(queue.jobs.size(), std::memory_order_relaxed);
+		}
+		if (sleeping.load() > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(wakeMutex);
+			}
+			wake.notify_one();
+		}
+	}
+
+	std::shared_ptr<Job> JobSystem::findJob(unsigned int index)
+	{
+		if (queued.load(std::memory_order_relaxed) == 0)
+			return nullptr;
+
+		std::shared_ptr<Job> job;
+		if (index != NO_QUEUE)
+		{
+			// Newest first, its data is most likely still in cache.
+			Queue& queue = *queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				queue.size.store(queue.jobs.size(), std::memory_order_relaxed);
+			}
+		}
+
+		// Oldest first from the others, the biggest pieces of recursively split work.
+		const unsigned int count = static_cast<unsigned int>(queues.size());
+		const unsigned int start = index == NO_QUEUE ? 0 : index + 1;
+		for (unsigned int i = 0; i < count && !job; i++)
+		{
+			const unsigned int victim = (start + i) % count;
+			Queue& queue = *queues[victim];
+			if (victim == index || queue.size.load(std::memory_order_relaxed) == 0)
+				continue;
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				queue.size.store(queue.jobs.size(), std::memory_order_relaxed);
+				if (index != NO_QUEUE)
+					queues[index]->stolen.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		if (job)
+			queued.fetch_sub(1);
+		return job;
+	}
+
+	void JobSystem::execute(const std::shared_ptr<Job>& job, unsigned int index)
+	{
+		job->function();
+		// Frees the captures now, handles may keep the job alive for much longer.
+		job->function = nullptr;
+		if (index != NO_QUEUE)
+			queues[index]->executed.fetch_add(1, std::memory_order_relaxed);
+
+		std::vector<std::shared_ptr<Job>> continuations;
+		{
+			std::lock_guard<std::mutex> lock(job->mutex);
+			job->done.store(true, std::memory_order_release);
+			continuations.swap(job->continuations);
+		}
+		for (const auto& continuation : continuations)
+		{
+			release(continuation);
+		}
+	}
+
+	void JobSystem::wait(const JobHandle& job)
+	{
+		const unsigned int index = threadQueue;
+		while (!job.isDone())
+		{
+			if (index == 0 && runMainThreadJobs() > 0)
+				continue;
+			if (std::shared_ptr<Job> other = findJob(index))
+			{
+				execute(other, index);
+				continue;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	size_t JobSystem::runMainThreadJobs()
+	{
+		if (!isMainThread())
+			return 0;
+
+		// Jobs queued while these run wait for the next call.
+		std::deque<std::shared_ptr<Job>> jobs;
+		{
+			std::lock_guard<std::mutex> lock(mainMutex);
+			jobs.swap(mainJobs);
+		}
+		for (const auto& job : jobs)
+		{
+			execute(job, 0);
+		}
+		return jobs.size();
+	}
+
+	JobSystem::Stats JobSystem::getStats() const
+	{
+		Stats stats = {};
+		for (const auto& queue : queues)
+		{
+			stats.executed += queue->executed.load(std::memory_order_relaxed);
+			stats.stolen += queue->stolen.load(std::memory_order_relaxed);
+		}
+		return stats;
+	}
+
+	void JobSystem::work(unsigned int index)
+	{
+		threadQueue = index;
+		unsigned int idle = 0;
+		for (;;)
+		{
+			if (std::shared_ptr<Job> job = findJob(index))
+			{
+				execute(job, index);
+				idle = 0;
+				continue;
+			}
+			if (++idle < IDLE_SPINS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			idle = 0;
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			sleeping++;
+			wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+			sleeping--;
+			if (stopping)
+				return;
+		}
+	}
+}
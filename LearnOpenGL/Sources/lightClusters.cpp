@@ -0,0 +1,307 @@
+#include "lightClusters.hpp"
+#include "parallel.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace Simp
+{
+	namespace
+	{
+		unsigned int countBits(uint64_t bits)
+		{
+#ifdef _MSC_VER
+			return static_cast<unsigned int>(__popcnt64(bits));
+#else
+			return static_cast<unsigned int>(__builtin_popcountll(bits));
+#endif
+		}
+
+		unsigned int lowestBit(uint64_t bits)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return static_cast<unsigned int>(index);
+#else
+			return static_cast<unsigned int>(__builtin_ctzll(bits));
+#endif
+		}
+
+		int clampInt(int value, int minimum, int maximum)
+		{
+			return std::min(std::max(value, minimum), maximum);
+		}
+	}
+
+	LightClusters::LightClusters(unsigned int _threadCount) : threadCount(_threadCount), parameters(0.0f),
+		projection(0.0f), viewport(0), clusterMin(CLUSTER_COUNT), clusterMax(CLUSTER_COUNT),
+		clusterSpheres(CLUSTER_COUNT), maskWords(0),
+		grid(CLUSTER_COUNT), stats(), gridBuffer(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * sizeof(glm::uvec2)),
+		indexBuffer(GL_SHADER_STORAGE_BUFFER, 1 << 16)
+	{
+	}
+
+	LightClusters::~LightClusters()
+	{
+	}
+
+	void LightClusters::updateClusterBounds(const Camera& camera)
+	{
+		const glm::vec4 current(camera.getVerticalFov(), camera.getAspectRatio(), camera.getNear(), camera.getFar());
+		const glm::ivec2 size(std::max(camera.getWidth(), 1), std::max(camera.getHeight(), 1));
+		if (current == projection && size == viewport)
+			return;
+		projection = current;
+		viewport = size;
+
+		const float nearPlane = camera.getNear();
+		const float farPlane = camera.getFar();
+		const float tanY = std::tan(glm::radians(camera.getVerticalFov()) * 0.5f);
+		const float tanX = tanY * camera.getAspectRatio();
+		tangents[0] = tanX;
+		tangents[1] = tanY;
+		const float tileWidth = static_cast<float>((size.x + TILES_X - 1) / TILES_X);
+		const float tileHeight = static_cast<float>((size.y + TILES_Y - 1) / TILES_Y);
+		const float sliceScale = SLICES / std::log(farPlane / nearPlane);
+		parameters = glm::vec4(tileWidth, tileHeight, sliceScale, -std::log(nearPlane) * sliceScale);
+
+		for (unsigned int slice = 0; slice <= SLICES; slice++)
+			sliceDepths[slice] = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / SLICES);
+
+		for (unsigned int slice = 0; slice < SLICES; slice++)
+		{
+			const float* depths = &sliceDepths[slice];
+			for (unsigned int y = 0; y < TILES_Y; y++)
+			{
+				const float ndcY[2] = {
+					std::min(y * tileHeight / size.y, 1.0f) * 2.0f - 1.0f,
+					std::min((y + 1) * tileHeight / size.y, 1.0f) * 2.0f - 1.0f
+				};
+				for (unsigned int x = 0; x < TILES_X; x++)
+				{
+					const float ndcX[2] = {
+						std::min(x * tileWidth / size.x, 1.0f) * 2.0f - 1.0f,
+						std::min((x + 1) * tileWidth / size.x, 1.0f) * 2.0f - 1.0f
+					};
+
+					// The froxel is a frustum piece, bound its eight corners. The camera looks down -z.
+					glm::vec3 minimum(std::numeric_limits<float>::max());
+					glm::vec3 maximum(-std::numeric_limits<float>::max());
+					for (int corner = 0; corner < 8; corner++)
+					{
+						const float depth = depths[corner >> 2];
+						const glm::vec3 point(ndcX[corner & 1] * tanX * depth, ndcY[(corner >> 1) & 1] * tanY * depth, -depth);
+						minimum = glm::min(minimum, point);
+						maximum = glm::max(maximum, point);
+					}
+
+					const unsigned int cluster = (slice * TILES_Y + y) * TILES_X + x;
+					clusterMin[cluster] = minimum;
+					clusterMax[cluster] = maximum;
+					const glm::vec3 center = (minimum + maximum) * 0.5f;
+					clusterSpheres[cluster] = glm::vec4(center, glm::length(maximum - center));
+				}
+			}
+		}
+	}
+
+	bool LightClusters::getTileRange(const ViewLight& light, float depthMin, float depthMax,
+									 int tileMin[2], int tileMax[2]) const
+	{
+		const int tileCount[2] = { TILES_X, TILES_Y };
+		for (int axis = 0; axis < 2; axis++)
+		{
+			// x / depth is monotonic in depth, so the extremes of the projected sphere box are at its corners.
+			float ndcMin = std::numeric_limits<float>::max();
+			float ndcMax = -std::numeric_limits<float>::max();
+			for (int corner = 0; corner < 4; corner++)
+			{
+				const float coordinate = light.center[axis] + ((corner & 1) ? light.radius : -light.radius);
+				const float depth = (corner & 2) ? depthMax : depthMin;
+				const float ndc = coordinate / (depth * tangents[axis]);
+				ndcMin = std::min(ndcMin, ndc);
+				ndcMax = std::max(ndcMax, ndc);
+			}
+			if (ndcMin > 1.0f || ndcMax < -1.0f)
+				return false;
+
+			const float scale = 0.5f * viewport[axis] / parameters[axis];
+			tileMin[axis] = clampInt(static_cast<int>((std::max(ndcMin, -1.0f) + 1.0f) * scale), 0, tileCount[axis] - 1);
+			tileMax[axis] = clampInt(static_cast<int>((std::min(ndcMax, 1.0f) + 1.0f) * scale), 0, tileCount[axis] - 1);
+		}
+		return true;
+	}
+
+	bool LightClusters::intersects(const ViewLight& light, unsigned int cluster) const
+	{
+		const glm::vec3& minimum = clusterMin[cluster];
+		const glm::vec3& maximum = clusterMax[cluster];
+		float distanceSquared = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float offset = std::max(std::max(minimum[axis] - light.center[axis], light.center[axis] - maximum[axis]), 0.0f);
+			distanceSquared += offset * offset;
+		}
+		if (distanceSquared > light.radius * light.radius)
+			return false;
+		if (light.cosOuter <= 0.0f)
+			return true;
+
+		// Cone against the bounding sphere of the cluster.
+		const glm::vec4& sphere = clusterSpheres[cluster];
+		const float clusterRadius = sphere.w;
+		float centerSquared = 0.0f;
+		float alongAxis = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float offset = sphere[axis] - light.center[axis];
+			centerSquared += offset * offset;
+			alongAxis += offset * light.dir[axis];
+		}
+		const float closestDistance = light.cosOuter * std::sqrt(std::max(centerSquared - alongAxis * alongAxis, 0.0f)) -
+			alongAxis * light.sinOuter;
+		return closestDistance <= clusterRadius && alongAxis >= -clusterRadius &&
+			alongAxis <= light.radius + clusterRadius;
+	}
+
+	void LightClusters::build(const Camera& camera, const std::vector<std::unique_ptr<OtherLight>>& lights)
+	{
+		auto start = std::chrono::steady_clock::now();
+		updateClusterBounds(camera);
+
+		const glm::mat4 view = camera.getViewMatrix();
+		const float nearPlane = camera.getNear();
+		const float farPlane = camera.getFar();
+
+		// Light indices are kept so the index list addresses the World light buffer directly.
+		viewLights.resize(lights.size());
+		for (size_t i = 0; i < lights.size(); i++)
+		{
+			const OtherLight& source = *lights[i];
+			ViewLight& light = viewLights[i];
+			light.center = glm::vec3(view * glm::vec4(glm::vec3(source.pos), 1.0f));
+			// pos.w holds the inverse range of the windowed falloff.
+			light.radius = source.pos.w > 0.0f ? 1.0f / source.pos.w : farPlane;
+			light.dir = glm::normalize(glm::mat3(view) * source.dir);
+			light.cosOuter = -source.angles.y / source.angles.x;
+			light.sinOuter = std::sqrt(std::max(1.0f - light.cosOuter * light.cosOuter, 0.0f));
+			light.depthMin = std::max(-light.center.z - light.radius, nearPlane);
+			light.depthMax = std::min(-light.center.z + light.radius, farPlane);
+
+			int tileMin[2];
+			int tileMax[2];
+			if (light.depthMin > light.depthMax || !getTileRange(light, light.depthMin, light.depthMax, tileMin, tileMax))
+			{
+				light.sliceMin = 1;
+				light.sliceMax = 0;
+				continue;
+			}
+			light.sliceMin = clampInt(static_cast<int>(std::floor(std::log(light.depthMin) * parameters.z + parameters.w)), 0, SLICES - 1);
+			light.sliceMax = clampInt(static_cast<int>(std::floor(std::log(light.depthMax) * parameters.z + parameters.w)), 0, SLICES - 1);
+		}
+
+		maskWords = (lights.size() + 63) / 64;
+		masks.assign(CLUSTER_COUNT * maskWords, 0);
+
+		// Every slice owns its clusters, so slices are binned without synchronization.
+		parallelFor(0, SLICES, [&](size_t slice)
+		{
+			for (size_t i = 0; i < viewLights.size(); i++)
+			{
+				const ViewLight& light = viewLights[i];
+				if (static_cast<int>(slice) < light.sliceMin || static_cast<int>(slice) > light.sliceMax)
+					continue;
+
+				// The part of the light inside this slice covers fewer tiles than the whole light.
+				int tileMin[2];
+				int tileMax[2];
+				if (!getTileRange(light, std::max(light.depthMin, sliceDepths[slice]),
+					std::min(light.depthMax, sliceDepths[slice + 1]), tileMin, tileMax))
+					continue;
+
+				for (int y = tileMin[1]; y <= tileMax[1]; y++)
+				{
+					for (int x = tileMin[0]; x <= tileMax[0]; x++)
+					{
+						const unsigned int cluster = (static_cast<unsigned int>(slice) * TILES_Y + y) * TILES_X + x;
+						if (intersects(light, cluster))
+							masks[cluster * maskWords + i / 64] |= uint64_t(1) << (i % 64);
+					}
+				}
+			}
+
+			for (unsigned int tile = 0; tile < TILES_X * TILES_Y; tile++)
+			{
+				const size_t cluster = slice * TILES_X * TILES_Y + tile;
+				unsigned int count = 0;
+				for (size_t word = 0; word < maskWords; word++)
+					count += countBits(masks[cluster * maskWords + word]);
+				grid[cluster].y = count;
+			}
+		}, 1, threadCount);
+
+		uint32_t offset = 0;
+		unsigned int maxCount = 0;
+		unsigned int occupied = 0;
+		for (auto& cluster : grid)
+		{
+			cluster.x = offset;
+			offset += cluster.y;
+			maxCount = std::max(maxCount, cluster.y);
+			occupied += cluster.y > 0 ? 1 : 0;
+		}
+		indices.resize(offset);
+
+		parallelFor(0, CLUSTER_COUNT, [&](size_t cluster)
+		{
+			uint32_t* output = indices.data() + grid[cluster].x;
+			for (size_t word = 0; word < maskWords; word++)
+			{
+				uint64_t bits = masks[cluster * maskWords + word];
+				while (bits != 0)
+				{
+					*output++ = static_cast<uint32_t>(word * 64 + lowestBit(bits));
+					bits &= bits - 1;
+				}
+			}
+		}, TILES_X * TILES_Y, threadCount);
+
+		stats.lightCount = lights.size();
+		stats.indexCount = indices.size();
+		stats.maxLightsPerCluster = maxCount;
+		stats.averageLightsPerCluster = occupied > 0 ? static_cast<float>(offset) / occupied : 0.0f;
+		stats.buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void LightClusters::upload()
+	{
+		gridBuffer.advance();
+		gridBuffer.write(0, grid.data(), CLUSTER_COUNT * sizeof(glm::uvec2));
+		gridBuffer.bind(GRID_BINDING, CLUSTER_COUNT * sizeof(glm::uvec2));
+
+		// The index list is rewritten every frame, so losing the contents on growth does not matter.
+		indexBuffer.advance();
+		indexBuffer.reserve(indices.size() * sizeof(uint32_t));
+		indexBuffer.write(0, indices.data(), indices.size() * sizeof(uint32_t));
+		indexBuffer.bind(INDICES_BINDING, indices.size() * sizeof(uint32_t));
+	}
+
+	StreamBuffer::Stats LightClusters::getUploadStats()
+	{
+		StreamBuffer::Stats result = gridBuffer.getStats();
+		result.bytes += indexBuffer.getStats().bytes;
+		result.calls += indexBuffer.getStats().calls;
+		gridBuffer.resetStats();
+		indexBuffer.resetStats();
+		return result;
+	}
+}
@@ -0,0 +1,57 @@
+#include "lodSelector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Simp
+{
+	namespace
+	{
+		const float BUDGET_STEP = 1.25f;
+		const float MAX_PIXEL_ERROR = 64.0f;
+	}
+
+	LodSelector::LodSelector(float _pixelError, float _hysteresis, size_t _triangleBudget)
+		: cameraPosition(0.0f), pixelsPerUnit(1.0f), pixelError(_pixelError), threshold(_pixelError),
+		  hysteresis(_hysteresis), triangleBudget(_triangleBudget), triangles(0)
+	{
+	}
+
+	void LodSelector::update(const Camera& camera)
+	{
+		cameraPosition = camera.getPosition();
+		pixelsPerUnit = camera.getHeight() / (2.0f * std::tan(glm::radians(camera.getVerticalFov()) * 0.5f));
+
+		// Coarsen everything while the last frame was over budget, refine again once well below it.
+		if (triangleBudget > 0)
+		{
+			if (triangles > triangleBudget)
+				threshold = std::min(threshold * BUDGET_STEP, MAX_PIXEL_ERROR);
+			else if (triangles * BUDGET_STEP < triangleBudget)
+				threshold = std::max(threshold / BUDGET_STEP, pixelError);
+		}
+		triangles = 0;
+	}
+
+	unsigned int LodSelector::select(const std::vector<LodLevel>& lods, const glm::vec3& center, float radius,
+									 float errorScale, unsigned int current)
+	{
+		if (lods.empty())
+			return 0;
+
+		const float distance = std::max(glm::length(center - cameraPosition) - radius, 1e-4f);
+		const float scale = errorScale * pixelsPerUnit / distance;
+
+		unsigned int level = 0;
+		for (unsigned int i = 1; i < lods.size(); i++)
+		{
+			if (lods[i].error * scale <= threshold)
+				level = i;
+		}
+		while (level > current && lods[level].error * scale > threshold * (1.0f - hysteresis))
+			level--;
+
+		triangles += lods[level].indexCount / 3;
+		return level;
+	}
+}
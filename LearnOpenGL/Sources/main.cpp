@@ -1,15 +1,32 @@
 #include "learnOpenGL.hpp"
 
+#include <cmath>
+#include <cstdlib>
 #include <iostream> // vs cstdio/stdio.h
+#include <random>
+#include <string>
 
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
 #include "texture.hpp"
+#include "textureCache.hpp"
+#include "jobSystem.hpp"
+#include "textureLoader.hpp"
+#include "benchmark.hpp"
 #include "camera.hpp"
+#include "framePacer.hpp"
+#include "geometryArena.hpp"
+#include "glState.hpp"
+#include "gpuCulling.hpp"
+#include "instanceBatch.hpp"
+#include "lodSelector.hpp"
 #include "model.hpp"
 #include "models.hpp"
+#include "profiler.hpp"
 #include "shader.hpp"
+#include "shaderVariants.hpp"
+#include "shaderWatcher.hpp"
 #include "world.hpp"
 #include "debug.hpp"
 
@@ -31,12 +48,12 @@ GLuint* initializeFrameBuffer()
 	glGenTextures(1, &tbo);
 	glGenRenderbuffers(1, &rbo);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo); // GL_READ_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER
-	glBindTexture(GL_TEXTURE_2D, tbo);
+	Simp::GLState::get().bindFramebuffer(GL_FRAMEBUFFER, fbo); // GL_READ_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER
+	Simp::GLState::get().bindTexture(GL_TEXTURE_2D, tbo);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, cWindowWidth, cWindowHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	Simp::GLState::get().bindTexture(GL_TEXTURE_2D, 0);
 
 	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32, cWindowWidth, cWindowHeight);
@@ -49,7 +66,7 @@ GLuint* initializeFrameBuffer()
 		std::cerr << "ERROR:: framebuffer not complete!" << std::endl;
 		exit(EXIT_FAILURE);
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	Simp::GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	static GLuint arr[3]{ fbo, tbo, rbo };
 	return arr;
@@ -57,20 +74,114 @@ GLuint* initializeFrameBuffer()
 
 void deleteFrameBuffer(GLuint* bh)
 {
-	glDeleteTextures(1, &bh[0]);
-	glDeleteRenderbuffers(1, &bh[1]);
-	glDeleteFramebuffers(1, (bh + 2));
+	Simp::GLState::get().deleteFramebuffer(bh[0]);
+	Simp::GLState::get().deleteTexture(bh[1]);
+	glDeleteRenderbuffers(1, &bh[2]);
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// --lights N adds N random point lights to stress the clustered shading.
+	// --cold-shaders ignores cached program binaries to measure a cold start.
+	// --uber-shader draws with the runtime branching phong shader instead of the specialized variants.
+	// --stress N adds a grid of N instanced backpacks.
+	// --gpu-cull culls and submits the stress grid on the GPU with multi draw indirect.
+	// --profile prints CPU and GPU percentiles of the frame stages every second.
+	// --trace FILE profiles and writes a Chrome trace of the whole run to FILE on exit.
+	// --frames-in-flight N lets the CPU run up to N frames ahead of the GPU, 0 finishes every frame.
+	// --max-latency MS waits for queued frames older than MS before sampling input.
+	// --benchmark N renders N frames with a fixed timestep along a camera path and writes percentiles as JSON.
+	// --warmup N frames rendered before the benchmark measures, 60 by default.
+	// --headless renders offscreen without a window through EGL surfaceless or OSMesa, implies --benchmark 600.
+	// --camera-path FILE flies the benchmark along a recorded path instead of the orbit around the backpack.
+	// --record-path FILE records the camera of an interactive run as a path.
+	// --json FILE where the benchmark results go, benchmark.json by default.
+	// --baseline FILE compares the results with an earlier JSON and fails on regressions beyond --tolerance, 0.1 by default.
+	// --timings compares the _ms timings with the baseline too, by default only the counts that match on every machine.
+	unsigned int extraLights = 0;
+	bool uberShader = false;
+	unsigned int stressCount = 0;
+	bool gpuCull = false;
+	bool profile = false;
+	std::string tracePath;
+	unsigned int framesInFlight = 2;
+	double maxLatency = 0.0;
+	bool headless = false;
+	unsigned int benchmarkFrames = 0;
+	unsigned int warmupFrames = 60;
+	std::string cameraPathFile;
+	std::string recordPathFile;
+	std::string jsonPath = "benchmark.json";
+	std::string baselinePath;
+	double tolerance = 0.1;
+	bool compareTimings = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--lights" && i + 1 < argc)
+			extraLights = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (arg == "--cold-shaders")
+			Simp::Shader::setBinaryCache(false);
+		else if (arg == "--uber-shader")
+			uberShader = true;
+		else if (arg == "--stress" && i + 1 < argc)
+			stressCount = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (arg == "--gpu-cull")
+			gpuCull = true;
+		else if (arg == "--profile")
+			profile = true;
+		else if (arg == "--trace" && i + 1 < argc)
+			tracePath = argv[++i];
+		else if (arg == "--frames-in-flight" && i + 1 < argc)
+			framesInFlight = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (arg == "--max-latency" && i + 1 < argc)
+			maxLatency = std::atof(argv[++i]);
+		else if (arg == "--benchmark" && i + 1 < argc)
+			benchmarkFrames = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (arg == "--warmup" && i + 1 < argc)
+			warmupFrames = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else if (arg == "--headless")
+			headless = true;
+		else if (arg == "--camera-path" && i + 1 < argc)
+			cameraPathFile = argv[++i];
+		else if (arg == "--record-path" && i + 1 < argc)
+			recordPathFile = argv[++i];
+		else if (arg == "--json" && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (arg == "--baseline" && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (arg == "--tolerance" && i + 1 < argc)
+			tolerance = std::atof(argv[++i]);
+		else if (arg == "--timings")
+			compareTimings = true;
+	}
+	if (headless && benchmarkFrames == 0)
+		benchmarkFrames = 600;
+	const bool benchmarking = benchmarkFrames > 0;
+
+	// The null platform has no display, its windows are only a context, surfaceless with EGL or in memory with OSMesa.
+	// Both run on Mesa llvmpipe without a GPU.
+	if (headless)
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
 	glfwInit();
+	// Shader storage buffers for the light clusters need 4.3.
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 	glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
+	if (headless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
 	auto window = glfwCreateWindow(cWindowWidth, cWindowHeight, "LearnOpenGL", NULL, NULL);
+	if (window == NULL && headless)
+	{
+		std::cout << "INFO::HEADLESS::NO_EGL falling back to OSMesa" << std::endl;
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+		window = glfwCreateWindow(cWindowWidth, cWindowHeight, "LearnOpenGL", NULL, NULL);
+	}
 	if (window == NULL)
 	{
 		std::cerr << "Failed to create GLFW window" << std::endl;
@@ -78,10 +189,13 @@ int main()
 	}
 
 	glfwMakeContextCurrent(window);
-	glfwSetCursorPosCallback(window, MouseCallback);
-	glfwSetScrollCallback(window, ScrollCallback);
-	// glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (!benchmarking)
+	{
+		glfwSetCursorPosCallback(window, MouseCallback);
+		glfwSetScrollCallback(window, ScrollCallback);
+		// glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
@@ -89,6 +203,25 @@ int main()
 		return -1;
 	}
 	Simp::debug();
+	// Let the driver use as many threads as it wants for shader reloads (KHR_parallel_shader_compile).
+	typedef void (APIENTRY* MaxShaderCompilerThreads)(GLuint);
+	auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreads>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+	if (maxShaderCompilerThreads != nullptr)
+		maxShaderCompilerThreads(0xFFFFFFFF);
+	// Persistently mapped stream buffers (ARB_buffer_storage, core in 4.4), loaded before the first one is created.
+	GLint glMajor = 0;
+	GLint glMinor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &glMajor);
+	glGetIntegerv(GL_MINOR_VERSION, &glMinor);
+	if (glMajor > 4 || (glMajor == 4 && glMinor >= 4) || glfwExtensionSupported("GL_ARB_buffer_storage"))
+		Simp::StreamBuffer::setBufferStorage(reinterpret_cast<Simp::StreamBuffer::BufferStorage>(
+			glfwGetProcAddress("glBufferStorage")));
+	if (!Simp::StreamBuffer::hasBufferStorage())
+		std::cout << "INFO::STREAM_BUFFER::NO_BUFFER_STORAGE falling back to glBufferSubData" << std::endl;
+	// GPU written draw counts (ARB_indirect_parameters, core in 4.6).
+	if (glfwExtensionSupported("GL_ARB_indirect_parameters"))
+		Simp::RenderQueue::setDrawIndirectCount(reinterpret_cast<Simp::RenderQueue::DrawIndirectCount>(
+			glfwGetProcAddress("glMultiDrawElementsIndirectCountARB")));
 	lastMousePos.x = cWindowWidth * .5;
 	lastMousePos.y = cWindowHeight * .5;
 
@@ -101,26 +234,79 @@ int main()
 	// auto spotLight{ std::make_unique<Simp::OtherLight>(glm::vec4(0.0f, 0.5f, 5.0f, 1.0f / 50.0f), glm::vec3(50.0f),
 	// 	glm::normalize(glm::vec3(0.0f, 0.0f, -1.0f)), 30.0f, 25.0f) };
 	// world.attachLight(spotLight);
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	extraLights = std::min(extraLights, Simp::World::MAX_OTHER_LIGHTS - static_cast<unsigned int>(world.getOtherLights().size()));
+	for (unsigned int i = 0; i < extraLights; i++)
+	{
+		glm::vec4 position(unit(random) * 20.0f - 10.0f, unit(random) * 3.0f - 0.5f, unit(random) * 20.0f - 10.0f,
+			1.0f / (1.0f + unit(random) * 2.0f));
+		auto light{ std::make_unique<Simp::OtherLight>(position, glm::vec3(unit(random), unit(random), unit(random)) * 2.0f) };
+		world.attachLight(light);
+	}
 
 	// Shaders
 
-	Simp::Shader phongShader;
-	phongShader.attach("phong.vert").attach("phong.frag").link();
-	world.bindBuffer(phongShader);
+	auto shaderStart = glfwGetTime();
+	// Phong is specialized per combination of maps, the bits match DIFFUSE, SPECULAR, NORMAL, INSTANCED and INDIRECT.
+	Simp::ShaderVariants phongShaders({ "phong.vert", "phong.frag" },
+		{ "HAS_DIFFUSE_MAP", "HAS_SPECULAR_MAP", "HAS_NORMAL_MAP", "INSTANCED", "INDIRECT" }, Simp::INSTANCED | Simp::INDIRECT);
+	phongShaders.setSpecialized(!uberShader);
+	phongShaders.get(Simp::DIFFUSE | Simp::NORMAL);
 	Simp::Shader whiteShader;
-	whiteShader.attach("white.vert").attach("white.frag").link();
+	// Only draws the light cubes, which are always instanced.
+	whiteShader.attach("white.vert").attach("white.frag").define("INSTANCED").link();
 	Simp::Shader screenShader;
 	screenShader.attach("screen.vert").attach("screen.frag").link();
 	Simp::Shader skyboxShader;
 	skyboxShader.attach("sky/sky.vert").attach("sky/sky.frag").link();
+	{
+		const auto& stats = Simp::Shader::getCacheStats();
+		std::cout << "INFO::SHADERS::LOADED in " << (glfwGetTime() - shaderStart) * 1000.0 << " ms ("
+			<< stats.linkTime << " ms linking, " << stats.hits << " cached, " << stats.misses << " compiled, "
+			<< stats.rejected << " rejected)" << std::endl;
+	}
+	// Edits to the shader files are picked up while running.
+	Simp::ShaderWatcher shaderWatcher;
+	shaderWatcher.watch(phongShaders);
+	shaderWatcher.watch(whiteShader);
+	shaderWatcher.watch(screenShader);
+	shaderWatcher.watch(skyboxShader);
 
 	// Models & Textures
 
-	Simp::Model backpack(PROJECT_SOURCE_DIR "/Resources/meshes/backpack/backpack.obj");
+	// Created here so the GL thread becomes its main thread.
+	Simp::JobSystem& jobSystem = Simp::JobSystem::get();
+	auto loadStart = glfwGetTime();
+	Simp::LodSelector lodSelector;
+	Simp::TextureLoader textureLoader;
+	Simp::GeometryArena geometry(cCompactVertices ? Simp::VertexFormat::compact() : Simp::VertexFormat::standard());
+	Simp::Model backpack(PROJECT_SOURCE_DIR "/Resources/meshes/backpack/backpack.obj", geometry, textureLoader);
 	GLuint vaoPlane = Simp::createPlane();
 	GLuint vaoCube = Simp::createCube();
-	GLuint textureDiffuseWood = Simp::loadTexture(PROJECT_SOURCE_DIR "/Resources/Textures/wood/diffuse.jpg");
-	GLuint textureNormalWood = Simp::loadTexture(PROJECT_SOURCE_DIR "/Resources/Textures/wood/normals.png");
+	auto& textureCache = Simp::TextureCache::get();
+	GLuint textureDiffuseWood = textureCache.acquire(PROJECT_SOURCE_DIR "/Resources/Textures/wood/diffuse.jpg", true, textureLoader);
+	GLuint textureNormalWood = textureCache.acquire(PROJECT_SOURCE_DIR "/Resources/Textures/wood/normals.png", true, textureLoader);
+	textureLoader.flush();
+	std::cout << "INFO::ASSETS::LOADED in " << (glfwGetTime() - loadStart) * 1000.0 << " ms with "
+		<< jobSystem.getThreadCount() << " job threads" << std::endl;
+	textureCache.printStats();
+	std::cout << "INFO::GEOMETRY::ARENA " << geometry.getVertexBytes() / 1024 << " KiB vertices ("
+		<< geometry.getFormat().stride << " B each), " << geometry.getIndexBytes() / 1024 << " KiB indices" << std::endl;
+	// Stress scene, a square grid of backpacks behind the plane.
+	std::vector<Simp::InstanceData> stressInstances;
+	const unsigned int stressSide = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(stressCount))));
+	for (unsigned int i = 0; i < stressCount; i++)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f),
+			glm::vec3((static_cast<float>(i % stressSide) - 0.5f * stressSide) * 3.0f, 1.0f, -8.0f - (i / stressSide) * 3.0f));
+		stressInstances.push_back(Simp::InstanceData::make(glm::scale(model, glm::vec3(0.5f))));
+	}
+	Simp::InstanceBatch instanceBatch;
+	std::unique_ptr<Simp::GpuCulling> gpuCulling;
+	if (gpuCull && !stressInstances.empty())
+		gpuCulling.reset(new Simp::GpuCulling(backpack, geometry, stressInstances));
+
 	GLuint textureHDR = Simp::loadHDR(PROJECT_SOURCE_DIR "/Resources/Textures/meadow2.hdr");
 
 	std::vector<std::string> cubeFaces{
@@ -133,56 +319,181 @@ int main()
 	};
 	GLuint textureCubeMap = Simp::loadCubemap(cubeFaces, false);
 
+	Simp::RenderQueue renderQueue;
+	Simp::Material planeMaterial;
+	planeMaterial.addTexture(textureDiffuseWood, SIMP_UNIFORM("material.texture_diffuse0"));
+	planeMaterial.addTexture(textureNormalWood, SIMP_UNIFORM("material.texture_normal0"));
+	planeMaterial.maps = Simp::DIFFUSE | Simp::NORMAL;
+	planeMaterial.shininess = 64.0f;
+	Simp::Material skyMaterial;
+	// skyMaterial.addTexture(textureCubeMap, SIMP_UNIFORM("skybox"));
+	skyMaterial.addTexture(textureHDR, SIMP_UNIFORM("skybox"));
+
 	// Frame buffer / Texture buffer / Render buffer
 
 	GLuint* bufferHandels = initializeFrameBuffer();
+	// Without a surface the default framebuffer is incomplete, the screen pass draws into a renderbuffer instead.
+	GLuint presentFramebuffer = 0;
+	GLuint presentRenderbuffer = 0;
+	if (headless)
+	{
+		glGenFramebuffers(1, &presentFramebuffer);
+		glGenRenderbuffers(1, &presentRenderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, presentRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, cWindowWidth, cWindowHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		Simp::GLState::get().bindFramebuffer(GL_FRAMEBUFFER, presentFramebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, presentRenderbuffer);
+		Simp::GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
 	
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-	glFrontFace(GL_CCW);
+	Simp::GLState::get().enable(GL_CULL_FACE);
+	Simp::GLState::get().cullFace(GL_BACK);
+	Simp::GLState::get().frontFace(GL_CCW);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	Simp::GLState::get().enable(GL_BLEND);
+	Simp::GLState::get().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	float current = 0.0f;
 	float previous = 0.0f;
 	float time = 0.0f;
 	float deltaTime;
-
-	while (!glfwWindowShouldClose(window))
+	float statsTime = 0.0f;
+	unsigned int statsFrames = 0;
+
+	// GPU time of the scene pass, compares the specialized phong variants with the uber shader.
+	const unsigned int SCENE_QUERIES = 4;
+	GLuint sceneQueries[SCENE_QUERIES];
+	glGenQueries(SCENE_QUERIES, sceneQueries);
+	unsigned int frame = 0;
+	double sceneTime = 0.0;
+	unsigned int sceneSamples = 0;
+	Simp::GLState::Stats glStats = {};
+
+	Simp::Profiler& profiler = Simp::Profiler::get();
+	profiler.setEnabled(profile || !tracePath.empty());
+	profiler.setTracing(!tracePath.empty());
+	renderQueue.setPassName(0, "opaque");
+	renderQueue.setPassName(1, "skybox");
+
+	Simp::FramePacer pacer(framesInFlight, maxLatency);
+
+	// Benchmarks run at a fixed timestep along the path, the frames are the same on every machine.
+	const float BENCHMARK_TIMESTEP = 1.0f / 60.0f;
+	Simp::CameraPath cameraPath;
+	if (!cameraPathFile.empty())
+		cameraPath.load(cameraPathFile);
+	if (benchmarking && cameraPath.isEmpty())
+		cameraPath = Simp::CameraPath::orbit(glm::vec3(0.0f, 0.5f, 0.0f), 6.0f, 1.5f, 10.0f);
+	Simp::CameraPath recordedPath;
+	Simp::Benchmark benchmark;
+	unsigned int benchmarkFrame = 0;
+	// Stage times come from the profiler scopes.
+	if (benchmarking)
+		profiler.setEnabled(true);
+
+	while (!glfwWindowShouldClose(window) && (!benchmarking || benchmarkFrame < warmupFrames + benchmarkFrames))
 	{
+		const double frameStart = glfwGetTime();
+		profiler.beginFrame();
+		{
+			SIMP_PROFILE_CPU("frame pacing");
+			pacer.beginFrame();
+		}
+		{
+			SIMP_PROFILE_CPU("input");
+			if (benchmarking)
+			{
+				deltaTime = BENCHMARK_TIMESTEP;
+				time += deltaTime;
+				cameraPath.apply(camera, time);
+			}
+			else
+			{
+				current = static_cast<float>(glfwGetTime());
+				deltaTime = current - previous;
+				time += deltaTime;
+				previous = current;
+				ProcessInput(window, deltaTime);
+				shaderWatcher.update();
+				if (!recordPathFile.empty())
+					recordedPath.add(time, camera.getPosition(), camera.getPosition() + camera.getForward());
+			}
+		}
+		{
+			SIMP_PROFILE_CPU("main thread jobs");
+			jobSystem.runMainThreadJobs();
+		}
+
+		statsFrames++;
+		if (time - statsTime >= 1.0f)
 		{
-			current = static_cast<float>(glfwGetTime());
-			deltaTime = current - previous;
-			time += deltaTime;
-			previous = current;
-			ProcessInput(window, deltaTime);
+			const auto& stats = world.getClusters().getStats();
+			const auto& upload = world.getUploadStats();
+			std::cout << "INFO::CLUSTERS " << stats.lightCount << " lights, " << stats.averageLightsPerCluster
+				<< " average / " << stats.maxLightsPerCluster << " max lights per cluster, " << stats.buildTime
+				<< " ms binning, " << (time - statsTime) * 1000.0f / statsFrames << " ms frame" << std::endl;
+			std::cout << "INFO::LIGHTS::UPLOAD " << upload.bytes << " bytes in " << upload.calls << " GL calls" << std::endl;
+			if (sceneSamples > 0)
+				std::cout << "INFO::SCENE::GPU " << sceneTime / sceneSamples << " ms per frame with "
+					<< (phongShaders.isSpecialized() ? std::to_string(phongShaders.getCount()) + " variants" : std::string("the uber shader")) << std::endl;
+			sceneTime = 0.0;
+			sceneSamples = 0;
+			const auto& queue = renderQueue.getStats();
+			std::cout << "INFO::RENDER_QUEUE " << queue.draws << " draws (" << queue.indirectDraws << " indirect), "
+				<< queue.programChanges << " programs, "
+				<< queue.vertexArrayChanges << " vertex arrays, " << queue.materialChanges << " materials, "
+				<< queue.textureBinds << " texture binds, sort " << queue.sortTime << " ms, submit " << queue.submitTime << " ms" << std::endl;
+			const auto& instances = instanceBatch.getStats();
+			std::cout << "INFO::INSTANCES " << instances.instances << " instances in " << instances.draws << " draws, "
+				<< instances.bytes / 1024 << " KiB" << std::endl;
+			std::cout << "INFO::GL_STATE " << glStats.issued << " calls issued, " << glStats.filtered << " filtered per frame ("
+				<< glStats.programIssued << " program, " << glStats.vertexArrayIssued << " vertex array, " << glStats.textureIssued
+				<< " texture, " << glStats.capabilityIssued << " fixed function, " << glStats.framebufferIssued << " framebuffer)" << std::endl;
+			const auto pacing = pacer.getStats();
+			std::cout << "INFO::FRAME_PACER " << pacer.getFramesInFlight() << " frames in flight, " << pacing.frameTime
+				<< " ms frame, " << pacing.waitTime << " ms waiting, " << pacing.queuedFrames << " frames queued on the GPU, "
+				<< pacing.latency << " ms latency, " << pacing.latencyWaits << " latency waits" << std::endl;
+			pacer.resetStats();
+			if (profile)
+				profiler.print();
+			statsTime = time;
+			statsFrames = 0;
 		}
 
 		// Update objects
 
-		auto& point { *world.getOtherLights()[0].get() };
-		point.pos.x = 2.0f * glm::cos(.25f * glm::pi<float>() * time);
-		point.pos.z = 2.0f * glm::sin(.25f * glm::pi<float>() * time);
+		{
+			SIMP_PROFILE_CPU("light update");
+			auto& point { *world.getOtherLights()[0].get() };
+			point.pos.x = 2.0f * glm::cos(.25f * glm::pi<float>() * time);
+			point.pos.z = 2.0f * glm::sin(.25f * glm::pi<float>() * time);
+		}
 
 		// Pass 1
 
 		int width, height;
 		glfwGetFramebufferSize(window, &width, &height);
-		glViewport(0, 0, width, height);
+		Simp::GLState::get().viewport(0, 0, width, height);
 		camera.resize(width, height);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, bufferHandels[0]);
+		Simp::GLState::get().bindFramebuffer(GL_FRAMEBUFFER, bufferHandels[0]);
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LEQUAL);
+		Simp::GLState::get().enable(GL_DEPTH_TEST);
+		Simp::GLState::get().depthFunc(GL_LEQUAL);
 
-		world.bindLights();
-		world.drawPointLights(camera, whiteShader, vaoCube, 36);
+		{
+			SIMP_PROFILE_GPU("bindLights");
+			world.bindLights(camera);
+		}
+
+		// Every draw of the pass goes through the queue, sorted by pass, program, material, mesh and depth.
+		renderQueue.clear();
+		const Simp::Frustum frustum = camera.getFrustum();
+		const glm::mat4 view = camera.getViewMatrix();
+		const glm::mat4 projection = camera.getProjectionMatrix();
 
-		phongShader.use();
-		phongShader.bind("cameraPos", camera.getPosition());
 		glm::mat4 modelBackpack(1.0f);
 		// glActiveTexture(GL_TEXTURE5);
 		// glBindTexture(GL_TEXTURE_CUBE_MAP, textureCubeMap);
@@ -190,67 +501,147 @@ int main()
 		// phongShader.bind("skybox", 6);
 		modelBackpack = glm::translate(modelBackpack, glm::vec3(0.0f, 1.0f, 0.0f));
 		modelBackpack = glm::scale(modelBackpack, glm::vec3(0.5f, 0.5f, 0.5f));
-		phongShader.bind("model", modelBackpack);
-		phongShader.bind("view", camera.getViewMatrix());
-		phongShader.bind("projection", camera.getProjectionMatrix());
-		phongShader.bind("invModel", glm::mat3(glm::inverseTranspose(modelBackpack)));
-		phongShader.bind("material.shininess", 32.0f);
-		phongShader.bind("material.maps", Simp::DIFFUSE | Simp::SPECULAR | Simp::NORMAL);
 		// phongShader.bind("exposure", 1.0f);
-		backpack.draw(phongShader);
-
-		glm::mat4 model3(1.0f);
-		model3 = glm::translate(model3, glm::vec3(0.0f, -1.0f, 0.0f));
-		model3 = glm::scale(model3, glm::vec3(10.0f, 0.0f, 10.0f));
-		phongShader.bind("model", model3);
-		phongShader.bind("material.texture_diffuse0", 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textureDiffuseWood);
-		phongShader.bind("material.texture_normal0", 1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, textureNormalWood);
-		phongShader.bind("material.maps", Simp::DIFFUSE | Simp::NORMAL);
-		phongShader.bind("material.specular", glm::vec3(1.0f));
-		phongShader.bind("material.shininess", 64.0f);
-
-		glBindVertexArray(vaoPlane);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-		// Draw sky box last
-
-		glDisable(GL_CULL_FACE);
-		skyboxShader.use();
-		skyboxShader.bind("skybox", 0);
-		glActiveTexture(GL_TEXTURE0);
-		// glBindTexture(GL_TEXTURE_CUBE_MAP, textureCubeMap);
-		glBindTexture(GL_TEXTURE_2D, textureHDR);
-		skyboxShader.bind("view", glm::mat4(glm::mat3(camera.getViewMatrix())));
-		skyboxShader.bind("projection", camera.getProjectionMatrix());
-		glBindVertexArray(vaoCube);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glEnable(GL_CULL_FACE);
+		lodSelector.update(camera);
+		backpack.submit(renderQueue, phongShaders, lodSelector, modelBackpack, frustum, camera);
+
+		// Repeated draws are merged into instanced packets by the batch.
+		instanceBatch.clear();
+		world.submitPointLights(camera, instanceBatch, whiteShader, vaoCube, 36);
+		if (gpuCulling)
+		{
+			gpuCulling->cull(camera, lodSelector);
+			gpuCulling->submit(renderQueue, phongShaders);
+		}
+		else if (!stressInstances.empty())
+		{
+			backpack.submit(instanceBatch, renderQueue, phongShaders, lodSelector, stressInstances, frustum);
+		}
+		instanceBatch.submit(renderQueue);
+
+		// The plane spans [-0.5, 0.5] on x and z before the model transform.
+		if (frustum.intersectsBox(glm::vec3(-5.0f, -1.0f, -5.0f), glm::vec3(5.0f, -1.0f, 5.0f)))
+		{
+			glm::mat4 model3(1.0f);
+			model3 = glm::translate(model3, glm::vec3(0.0f, -1.0f, 0.0f));
+			model3 = glm::scale(model3, glm::vec3(10.0f, 0.0f, 10.0f));
+			Simp::DrawObject planeObject;
+			planeObject.model = model3;
+			planeObject.invModel = glm::mat3(glm::inverseTranspose(model3));
+			planeObject.flags = Simp::DrawObject::MODEL | Simp::DrawObject::NORMAL_MATRIX;
+
+			Simp::Shader& planeShader = phongShaders.get(planeMaterial.maps);
+			Simp::DrawPacket packet = { Simp::RenderQueue::makeKey(0, false, planeShader.getSerial(), planeMaterial.id, vaoPlane,
+				-(view * glm::vec4(0.0f, -1.0f, 0.0f, 1.0f)).z / camera.getFar()),
+				&planeShader, &planeMaterial, vaoPlane, renderQueue.addObject(planeObject), 0, GL_TRIANGLES, 0, 0, 0, 6, 0, 0, nullptr };
+			renderQueue.submit(packet);
+		}
+
+		// Sky box last, it is drawn at the far plane behind everything else.
+		{
+			Simp::DrawPacket packet = { Simp::RenderQueue::makeKey(1, false, skyboxShader.getSerial(), skyMaterial.id, vaoCube, 1.0f),
+				&skyboxShader, &skyMaterial, vaoCube, Simp::RenderQueue::NO_OBJECT, Simp::DrawPacket::NO_CULL, GL_TRIANGLES, 0, 0, 0, 36, 0, 0, nullptr };
+			renderQueue.submit(packet);
+		}
+
+		// Per frame uniforms, the queue binds the per draw ones.
+		whiteShader.bind(SIMP_UNIFORM("view"), view);
+		whiteShader.bind(SIMP_UNIFORM("projection"), projection);
+		phongShaders.bind(SIMP_UNIFORM("cameraPos"), camera.getPosition());
+		phongShaders.bind(SIMP_UNIFORM("view"), view);
+		phongShaders.bind(SIMP_UNIFORM("projection"), projection);
+		skyboxShader.bind(SIMP_UNIFORM("view"), glm::mat4(glm::mat3(view)));
+		skyboxShader.bind(SIMP_UNIFORM("projection"), projection);
+
+		{
+			SIMP_PROFILE_GPU("scene");
+			glBeginQuery(GL_TIME_ELAPSED, sceneQueries[frame % SCENE_QUERIES]);
+			renderQueue.sort();
+			renderQueue.execute();
+			glEndQuery(GL_TIME_ELAPSED);
+		}
+
+		// Read the query of the oldest frame in the ring, its result is normally available without a stall.
+		frame++;
+		if (frame >= SCENE_QUERIES)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(sceneQueries[frame % SCENE_QUERIES], GL_QUERY_RESULT, &elapsed);
+			sceneTime += elapsed * 1e-6;
+			sceneSamples++;
+		}
 
 		// Pass 2
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
-		glDisable(GL_DEPTH_TEST);
-		screenShader.use();
-		glBindTexture(GL_TEXTURE_2D, bufferHandels[1]);
-		screenShader.bind("screenTexture", 0);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
-
-		glfwSwapBuffers(window);
-		glfwPollEvents();
-		glFinish();
+		{
+			SIMP_PROFILE_GPU("screen pass");
+			Simp::GLState::get().bindFramebuffer(GL_FRAMEBUFFER, presentFramebuffer);
+			glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			Simp::GLState::get().disable(GL_DEPTH_TEST);
+			Simp::GLState::get().enable(GL_CULL_FACE);
+			Simp::GLState::get().bindVertexArray(0);
+			screenShader.use();
+			Simp::GLState::get().bindTexture(0, GL_TEXTURE_2D, bufferHandels[1]);
+			screenShader.bind(SIMP_UNIFORM("screenTexture"), 0);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+
+		// Counters of the frame, printed with the other stats.
+		glStats = Simp::GLState::get().getStats();
+		Simp::GLState::get().resetStats();
+
+		{
+			SIMP_PROFILE_CPU("swap");
+			if (!headless)
+				glfwSwapBuffers(window);
+			glfwPollEvents();
+			pacer.endFrame();
+		}
+		profiler.endFrame();
+
+		if (benchmarking && benchmarkFrame++ >= warmupFrames)
+		{
+			benchmark.add("frame_ms", (glfwGetTime() - frameStart) * 1000.0);
+			for (const auto& sample : profiler.getFrameSamples())
+				benchmark.add((sample.gpu ? "gpu." : "cpu.") + *sample.name + "_ms", sample.time);
+			const auto& queue = renderQueue.getStats();
+			benchmark.add("draws", queue.draws);
+			benchmark.add("program_changes", queue.programChanges);
+			benchmark.add("material_changes", queue.materialChanges);
+			benchmark.add("texture_binds", queue.textureBinds);
+			benchmark.add("instances", static_cast<double>(queue.instances));
+			benchmark.add("gl_calls_issued", glStats.issued);
+			benchmark.add("gl_calls_filtered", glStats.filtered);
+		}
+	}
+
+	int exitCode = EXIT_SUCCESS;
+	if (benchmarking)
+	{
+		benchmark.writeJson(jsonPath, benchmarkFrames, warmupFrames);
+		std::cout << "INFO::BENCHMARK " << benchmarkFrames << " frames written to " << jsonPath << std::endl;
+		if (!baselinePath.empty() && benchmark.compare(baselinePath, tolerance, compareTimings) != 0)
+			exitCode = EXIT_FAILURE;
 	}
+	if (!recordPathFile.empty())
+		recordedPath.save(recordPathFile);
+	if (!tracePath.empty())
+		profiler.writeTrace(tracePath);
 
-	GLuint arr[3]{ vaoPlane, vaoCube };
-	glDeleteVertexArrays(3, arr);
+	Simp::GLState::get().deleteVertexArray(vaoPlane);
+	Simp::GLState::get().deleteVertexArray(vaoCube);
 	deleteFrameBuffer(bufferHandels);
+	if (headless)
+	{
+		Simp::GLState::get().deleteFramebuffer(presentFramebuffer);
+		glDeleteRenderbuffers(1, &presentRenderbuffer);
+	}
+	glDeleteQueries(SCENE_QUERIES, sceneQueries);
+	textureCache.release(textureDiffuseWood);
+	textureCache.release(textureNormalWood);
 	glfwTerminate();
-	return EXIT_SUCCESS;
+	return exitCode;
 }
 
 // void FramebufferSizeCallback(GLFWwindow*, int width, int height)
@@ -1,61 +1,117 @@
 #include "mesh.hpp"
+#include "vertexCompression.hpp"
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <iostream>
+
 namespace Simp
 {
-	Mesh::Mesh(const std::vector<Vertex>& _vertices,
+	namespace
+	{
+		const unsigned int MAX_TEXTURES_PER_TYPE = 4;
+		constexpr UniformName TEXTURE_UNIFORMS[3][MAX_TEXTURES_PER_TYPE] = {
+			{ "material.texture_diffuse0", "material.texture_diffuse1", "material.texture_diffuse2", "material.texture_diffuse3" },
+			{ "material.texture_specular0", "material.texture_specular1", "material.texture_specular2", "material.texture_specular3" },
+			{ "material.texture_normal0", "material.texture_normal1", "material.texture_normal2", "material.texture_normal3" }
+		};
+	}
+
+	Mesh::Mesh(GeometryArena& _arena,
+			const std::vector<Vertex>& _vertices,
 			const std::vector<GLuint>& _indices,
-			const std::vector<Texture>& _textures)
-		: vertices(_vertices), indices(_indices), textures(_textures)
+			const std::vector<Texture>& _textures,
+			const std::vector<LodLevel>& _lods)
+		: Mesh(_arena, _vertices.data(), static_cast<GLsizei>(_vertices.size()),
+			   _indices.data(), static_cast<GLsizei>(_indices.size()), _textures, _lods)
 	{
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
-
-		glGenBuffers(1, &vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glGenBuffers(1, &ebo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
-
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
-		glEnableVertexAttribArray(3);
-
-		glBindVertexArray(0);
-		glDeleteBuffers(1, &vbo);
-		glDeleteBuffers(1, &ebo);
 	}
 
-	void Mesh::draw(Shader& shader)
+	Mesh::Mesh(GeometryArena& _arena,
+			const Vertex* _vertices, GLsizei vertexCount,
+			const GLuint* _indices, GLsizei _indexCount,
+			const std::vector<Texture>& _textures,
+			const std::vector<LodLevel>& _lods)
+		: arena(_arena), indexCount(_indexCount), positionScale(1.0f), positionOffset(0.0f),
+		  boundsCenter(0.0f), boundsRadius(0.0f), boundsMin(0.0f), boundsMax(0.0f), textures(_textures), lods(_lods), currentLod(0)
 	{
+		if (lods.empty())
+			lods.push_back(LodLevel{ 0, static_cast<GLuint>(indexCount), 0.0f });
+
+		// Sampler names are resolved here once instead of being built on every draw.
 		GLuint num[3] = { 0, 0, 0 };
-		for (int i = 0; i < textures.size(); i++)
+		for (const auto& texture : textures)
 		{
-			std::string uniform = "material.";
-			if (textures[i].type == TextureType::Diffuse)
-				uniform += "texture_diffuse" + std::to_string(num[0]++);
-			else if (textures[i].type == TextureType::Specular)
-				uniform += "texture_specular" + std::to_string(num[1]++);
-			else if (textures[i].type == TextureType::Normal)
-				uniform += "texture_normal" + std::to_string(num[2]++);
-
-			auto location = glGetUniformLocation(shader.getHandle(), uniform.c_str());
-			shader.bind(location, i);
-			glActiveTexture(GL_TEXTURE0 + i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			const GLuint index = num[texture.type]++;
+			material.maps |= 1u << texture.type;
+			if (index < MAX_TEXTURES_PER_TYPE)
+				material.addTexture(texture.id, TEXTURE_UNIFORMS[texture.type][index]);
+			else
+				std::cerr << "WARNING::MESH::TOO_MANY_TEXTURES " << texture.path << std::endl;
 		}
 
-		glBindVertexArray(vao);
-		glDrawElements(GL_TRIANGLES, static_cast<GLuint>(indices.size()), GL_UNSIGNED_INT, 0);
+		if (vertexCount > 0)
+		{
+			glm::vec3 minimum = _vertices[0].position;
+			glm::vec3 maximum = _vertices[0].position;
+			for (GLsizei i = 1; i < vertexCount; i++)
+			{
+				minimum = glm::min(minimum, _vertices[i].position);
+				maximum = glm::max(maximum, _vertices[i].position);
+			}
+			boundsMin = minimum;
+			boundsMax = maximum;
+			boundsCenter = (minimum + maximum) * 0.5f;
+			for (GLsizei i = 0; i < vertexCount; i++)
+				boundsRadius = std::max(boundsRadius, glm::length(_vertices[i].position - boundsCenter));
+		}
 
-		glActiveTexture(GL_TEXTURE0);
+		if (arena.getFormat().quantized)
+		{
+			std::vector<CompactVertex> compact(vertexCount);
+			Dequantization dequantization = quantizeVertices(_vertices, vertexCount, compact.data());
+			positionScale = dequantization.scale;
+			positionOffset = dequantization.offset;
+			allocation = arena.allocate(compact.data(), vertexCount, _indices, indexCount);
+		}
+		else
+		{
+			allocation = arena.allocate(_vertices, vertexCount, _indices, indexCount);
+		}
+	}
+
+	GeometryArena::DrawRange Mesh::getDrawRange(unsigned int lod) const
+	{
+		const LodLevel& level = lods[std::min<size_t>(lod, lods.size() - 1)];
+		return arena.getDrawRange(allocation, level.indexOffset, level.indexCount);
+	}
+
+	DrawPacket Mesh::makePacket(Shader& shader, uint32_t object, unsigned int lod, float depth) const
+	{
+		const GeometryArena::DrawRange range = getDrawRange(lod);
+		const GLuint vertexArray = arena.getVertexArray();
+
+		DrawPacket packet;
+		packet.key = RenderQueue::makeKey(0, false, shader.getSerial(), material.id, vertexArray, depth);
+		packet.shader = &shader;
+		packet.material = &material;
+		packet.vertexArray = vertexArray;
+		packet.object = object;
+		packet.state = 0;
+		packet.mode = GL_TRIANGLES;
+		packet.indexType = range.indexType;
+		packet.baseVertex = range.baseVertex;
+		packet.first = range.firstIndex;
+		packet.count = range.indexCount;
+		packet.instanceCount = 0;
+		packet.baseInstance = 0;
+		packet.indirect = nullptr;
+		return packet;
+	}
+
+	void Mesh::submit(RenderQueue& queue, Shader& shader, uint32_t object, unsigned int lod, float depth) const
+	{
+		queue.submit(makePacket(shader, object, lod, depth));
 	}
-}
\ No newline at end of file
+}
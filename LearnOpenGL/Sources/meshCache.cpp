@@ -0,0 +1,213 @@
+#include "meshCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Simp
+{
+	namespace
+	{
+		const size_t BLOB_ALIGNMENT = 16;
+
+		template<typename T>
+		void append(std::vector<char>& buffer, const T& value)
+		{
+			auto bytes = reinterpret_cast<const char*>(&value);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+		}
+
+		void align(std::vector<char>& buffer)
+		{
+			buffer.resize((buffer.size() + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1), 0);
+		}
+	}
+
+	uint64_t MeshCache::key(const MappedFile& source, unsigned int importFlags)
+	{
+		uint64_t hash = hashBytes(source.getData(), source.getSize());
+		hash = hashBytes(&importFlags, sizeof(importFlags), hash);
+		// A copy, taking the address of the in class constant needs a definition at namespace scope.
+		const uint32_t version = VERSION;
+		return hashBytes(&version, sizeof(version), hash);
+	}
+
+	bool MeshCache::write(const std::string& path, uint64_t key, const std::vector<MeshData>& meshes)
+	{
+		std::vector<char> buffer;
+
+		Header header;
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.key = key;
+		header.meshCount = static_cast<uint32_t>(meshes.size());
+		header.vertexSize = sizeof(Vertex);
+		header.fileSize = 0;
+		append(buffer, header);
+
+		std::vector<size_t> recordOffsets;
+		for (const auto& mesh : meshes)
+		{
+			recordOffsets.push_back(buffer.size());
+
+			Record record;
+			record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+			record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+			record.vertexOffset = 0;
+			record.indexOffset = 0;
+			record.textureCount = static_cast<uint32_t>(mesh.textures.size());
+			record.lodCount = static_cast<uint32_t>(mesh.lods.size());
+			append(buffer, record);
+
+			for (const auto& texture : mesh.textures)
+			{
+				TextureEntry entry;
+				entry.type = static_cast<uint32_t>(texture.type);
+				entry.pathLength = static_cast<uint32_t>(texture.path.size());
+				append(buffer, entry);
+				buffer.insert(buffer.end(), texture.path.begin(), texture.path.end());
+			}
+
+			for (const auto& lod : mesh.lods)
+			{
+				LodEntry entry;
+				entry.indexOffset = lod.indexOffset;
+				entry.indexCount = lod.indexCount;
+				entry.error = lod.error;
+				append(buffer, entry);
+			}
+		}
+
+		// Blobs are patched in after the records so the reader can hand them to GL as is.
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const size_t vertexBytes = meshes[i].vertices.size() * sizeof(Vertex);
+			const size_t indexBytes = meshes[i].indices.size() * sizeof(GLuint);
+
+			align(buffer);
+			const uint64_t vertexOffset = buffer.size();
+			auto vertices = reinterpret_cast<const char*>(meshes[i].vertices.data());
+			buffer.insert(buffer.end(), vertices, vertices + vertexBytes);
+
+			align(buffer);
+			const uint64_t indexOffset = buffer.size();
+			auto indices = reinterpret_cast<const char*>(meshes[i].indices.data());
+			buffer.insert(buffer.end(), indices, indices + indexBytes);
+
+			Record* record = reinterpret_cast<Record*>(&buffer[recordOffsets[i]]);
+			record->vertexOffset = vertexOffset;
+			record->indexOffset = indexOffset;
+		}
+		reinterpret_cast<Header*>(&buffer[0])->fileSize = buffer.size();
+
+		// Write to a temporary file first so a crash never leaves a truncated cache behind.
+		const std::string temporary = path + ".tmp";
+		{
+			std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+			if (!stream.write(buffer.data(), buffer.size()))
+			{
+				std::cerr << "WARNING::MESH_CACHE::WRITE_FAILED " << temporary << std::endl;
+				return false;
+			}
+		}
+		std::remove(path.c_str());
+		if (std::rename(temporary.c_str(), path.c_str()) != 0)
+		{
+			std::remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool MeshCache::open(const std::string& path, uint64_t key)
+	{
+		meshes.clear();
+		if (!file.open(path))
+			return false;
+
+		const unsigned char* data = file.getData();
+		const size_t size = file.getSize();
+		if (size < sizeof(Header))
+		{
+			file.close();
+			return false;
+		}
+
+		Header header;
+		std::memcpy(&header, data, sizeof(Header));
+		if (header.magic != MAGIC || header.version != VERSION || header.key != key ||
+			header.vertexSize != sizeof(Vertex) || header.fileSize != size)
+		{
+			file.close();
+			return false;
+		}
+
+		size_t cursor = sizeof(Header);
+		meshes.reserve(header.meshCount);
+		for (uint32_t i = 0; i < header.meshCount; i++)
+		{
+			Record record;
+			if (cursor + sizeof(Record) > size)
+				break;
+			std::memcpy(&record, data + cursor, sizeof(Record));
+			cursor += sizeof(Record);
+
+			if (record.vertexOffset + uint64_t(record.vertexCount) * sizeof(Vertex) > size ||
+				record.indexOffset + uint64_t(record.indexCount) * sizeof(GLuint) > size)
+				break;
+
+			MeshView view;
+			view.vertices = reinterpret_cast<const Vertex*>(data + record.vertexOffset);
+			view.vertexCount = static_cast<GLsizei>(record.vertexCount);
+			view.indices = reinterpret_cast<const GLuint*>(data + record.indexOffset);
+			view.indexCount = static_cast<GLsizei>(record.indexCount);
+
+			for (uint32_t j = 0; j < record.textureCount; j++)
+			{
+				TextureEntry entry;
+				if (cursor + sizeof(TextureEntry) > size)
+					break;
+				std::memcpy(&entry, data + cursor, sizeof(TextureEntry));
+				cursor += sizeof(TextureEntry);
+				if (cursor + entry.pathLength > size)
+					break;
+
+				Texture texture;
+				texture.id = 0;
+				texture.type = static_cast<TextureType>(entry.type);
+				texture.path.assign(reinterpret_cast<const char*>(data + cursor), entry.pathLength);
+				cursor += entry.pathLength;
+				view.textures.push_back(texture);
+			}
+
+			if (view.textures.size() != record.textureCount)
+				break;
+
+			for (uint32_t j = 0; j < record.lodCount; j++)
+			{
+				LodEntry entry;
+				if (cursor + sizeof(LodEntry) > size)
+					break;
+				std::memcpy(&entry, data + cursor, sizeof(LodEntry));
+				cursor += sizeof(LodEntry);
+				if (uint64_t(entry.indexOffset) + entry.indexCount > record.indexCount)
+					break;
+				view.lods.push_back(LodLevel{ entry.indexOffset, entry.indexCount, entry.error });
+			}
+
+			if (view.lods.size() != record.lodCount)
+				break;
+			meshes.push_back(view);
+		}
+
+		if (meshes.size() != header.meshCount)
+		{
+			std::cerr << "WARNING::MESH_CACHE::CORRUPT " << path << std::endl;
+			meshes.clear();
+			file.close();
+			return false;
+		}
+		return true;
+	}
+}
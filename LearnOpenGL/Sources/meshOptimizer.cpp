@@ -0,0 +1,271 @@
+#include "meshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace Simp
+{
+	namespace
+	{
+		// FIFO cache simulated with insertion timestamps, a vertex is cached while
+		// fewer than cacheSize vertices have been inserted after it.
+		class FifoCache
+		{
+		public:
+			FifoCache(size_t vertexCount, unsigned int _cacheSize)
+				: timestamps(vertexCount, 0), time(_cacheSize + 1), cacheSize(_cacheSize)
+			{
+			}
+
+			void reset() { time += cacheSize + 1; }
+
+			bool access(GLuint vertex)
+			{
+				if (time - timestamps[vertex] <= cacheSize)
+					return false;
+				timestamps[vertex] = time++;
+				return true;
+			}
+
+		private:
+			std::vector<size_t> timestamps;
+			size_t time;
+			unsigned int cacheSize;
+		};
+
+		struct Cluster
+		{
+			size_t begin;
+			size_t end;
+			float sortKey;
+		};
+	}
+
+	VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount, unsigned int cacheSize)
+	{
+		FifoCache cache(vertexCount, cacheSize);
+		std::vector<bool> referenced(vertexCount, false);
+		size_t misses = 0;
+		size_t unique = 0;
+		for (auto index : indices)
+		{
+			misses += cache.access(index) ? 1 : 0;
+			if (!referenced[index])
+			{
+				referenced[index] = true;
+				unique++;
+			}
+		}
+
+		VertexCacheStats stats;
+		stats.acmr = indices.empty() ? 0.0f : static_cast<float>(misses) / (indices.size() / 3);
+		stats.atvr = unique == 0 ? 0.0f : static_cast<float>(misses) / unique;
+		return stats;
+	}
+
+	void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount, unsigned int cacheSize,
+							 std::vector<size_t>* clusters)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Vertex to triangle adjacency in compressed rows.
+		std::vector<unsigned int> liveTriangles(vertexCount, 0);
+		for (auto index : indices)
+			liveTriangles[index]++;
+		std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+		std::vector<size_t> adjacency(indices.size());
+		{
+			std::vector<size_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				adjacency[cursor[indices[i]]++] = i / 3;
+		}
+
+		std::vector<size_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<GLuint> deadEnds;
+		std::vector<GLuint> candidates;
+		std::vector<GLuint> output;
+		output.reserve(indices.size());
+
+		size_t time = cacheSize + 1;
+		size_t scanCursor = 0;
+		int64_t fanning = -1;
+		for (size_t v = 0; v < vertexCount && fanning < 0; v++)
+		{
+			if (liveTriangles[v] > 0)
+				fanning = static_cast<int64_t>(v);
+		}
+
+		bool deadEnd = false;
+		while (fanning >= 0)
+		{
+			if (deadEnd && clusters != nullptr)
+				clusters->push_back(output.size() / 3);
+
+			candidates.clear();
+			for (size_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+			{
+				const size_t triangle = adjacency[a];
+				if (emitted[triangle])
+					continue;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const GLuint vertex = indices[triangle * 3 + corner];
+					output.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (time - cacheTime[vertex] > cacheSize)
+						cacheTime[vertex] = time++;
+				}
+				emitted[triangle] = true;
+			}
+
+			// Prefer the candidate that stays in the cache longest while its remaining triangles are emitted.
+			fanning = -1;
+			size_t bestPriority = 0;
+			for (auto vertex : candidates)
+			{
+				if (liveTriangles[vertex] == 0)
+					continue;
+
+				size_t priority = 0;
+				if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+					priority = time - cacheTime[vertex];
+				if (fanning < 0 || priority > bestPriority)
+				{
+					bestPriority = priority;
+					fanning = vertex;
+				}
+			}
+
+			deadEnd = fanning < 0;
+			if (deadEnd)
+			{
+				while (!deadEnds.empty() && fanning < 0)
+				{
+					const GLuint vertex = deadEnds.back();
+					deadEnds.pop_back();
+					if (liveTriangles[vertex] > 0)
+						fanning = vertex;
+				}
+				for (; scanCursor < vertexCount && fanning < 0; scanCursor++)
+				{
+					if (liveTriangles[scanCursor] > 0)
+						fanning = static_cast<int64_t>(scanCursor);
+				}
+			}
+		}
+
+		indices.swap(output);
+	}
+
+	void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices,
+						  const std::vector<size_t>& clusters, float threshold, unsigned int cacheSize)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		const float meshAcmr = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+
+		// Hard boundaries come from the cache optimizer, soft ones are added wherever the
+		// cluster so far, simulated from a cold cache, is already within the ACMR budget.
+		std::vector<Cluster> ranges;
+		FifoCache cache(vertices.size(), cacheSize);
+		size_t nextHard = 0;
+		size_t begin = 0;
+		size_t misses = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			while (nextHard < clusters.size() && clusters[nextHard] < t)
+				nextHard++;
+			const bool hard = nextHard < clusters.size() && clusters[nextHard] == t;
+			const bool soft = t > begin && static_cast<float>(misses) / (t - begin) <= threshold * meshAcmr;
+			if (t > begin && (hard || soft))
+			{
+				ranges.push_back(Cluster{ begin, t, 0.0f });
+				begin = t;
+				misses = 0;
+				cache.reset();
+			}
+			for (int corner = 0; corner < 3; corner++)
+				misses += cache.access(indices[t * 3 + corner]) ? 1 : 0;
+		}
+		ranges.push_back(Cluster{ begin, triangleCount, 0.0f });
+
+		glm::vec3 meshCenter(0.0f);
+		for (const auto& vertex : vertices)
+			meshCenter += vertex.position;
+		meshCenter /= static_cast<float>(std::max<size_t>(vertices.size(), 1));
+
+		// Clusters facing away from the center are likely in front of the rest of the mesh.
+		for (auto& range : ranges)
+		{
+			glm::vec3 center(0.0f);
+			glm::vec3 normal(0.0f);
+			float area = 0.0f;
+			for (size_t t = range.begin; t < range.end; t++)
+			{
+				const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+				const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+				const glm::vec3 faceNormal = glm::cross(b - a, c - a);
+				const float faceArea = glm::length(faceNormal);
+				center += (a + b + c) * (faceArea / 3.0f);
+				normal += faceNormal;
+				area += faceArea;
+			}
+			const float normalLength = glm::length(normal);
+			if (area > 0.0f && normalLength > 0.0f)
+				range.sortKey = glm::dot(center / area - meshCenter, normal / normalLength);
+		}
+
+		std::stable_sort(ranges.begin(), ranges.end(),
+			[](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<GLuint> output;
+		output.reserve(indices.size());
+		for (const auto& range : ranges)
+			output.insert(output.end(), indices.begin() + range.begin * 3, indices.begin() + range.end * 3);
+		indices.swap(output);
+	}
+
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+	{
+		const GLuint unused = static_cast<GLuint>(-1);
+		std::vector<GLuint> remap(vertices.size(), unused);
+		std::vector<Vertex> output;
+		output.reserve(vertices.size());
+		for (auto& index : indices)
+		{
+			if (remap[index] == unused)
+			{
+				remap[index] = static_cast<GLuint>(output.size());
+				output.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices.swap(output);
+	}
+
+	MeshOptimizationStats optimizeMesh(MeshData& mesh)
+	{
+		MeshOptimizationStats stats;
+		stats.before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		std::vector<size_t> clusters;
+		optimizeVertexCache(mesh.indices, mesh.vertices.size(), VERTEX_CACHE_SIZE, &clusters);
+		optimizeOverdraw(mesh.indices, mesh.vertices, clusters);
+		optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+		stats.after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+		return stats;
+	}
+}
@@ -0,0 +1,311 @@
+#include "meshSimplifier.hpp"
+#include "meshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace Simp
+{
+	namespace
+	{
+		const int MAX_PASSES = 64;
+		// Levels that cannot drop at least this share of the previous level end the chain.
+		const float MIN_REDUCTION = 0.2f;
+		// Co-located vertices closer than this in every attribute count as the same vertex, not as a seam.
+		const float NORMAL_EPSILON = 1e-3f;
+		const float UV_EPSILON = 1e-4f;
+
+		// Symmetric 4x4 matrix of the summed squared plane distances.
+		struct Quadric
+		{
+			double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+			Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+			Quadric(double a, double b, double c, double d)
+				: a2(a * a), ab(a * b), ac(a * c), ad(a * d), b2(b * b), bc(b * c), bd(b * d), c2(c * c), cd(c * d), d2(d * d)
+			{
+			}
+
+			Quadric& operator+=(const Quadric& q)
+			{
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+				bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+				return *this;
+			}
+
+			double evaluate(const glm::vec3& p) const
+			{
+				const double x = p.x;
+				const double y = p.y;
+				const double z = p.z;
+				return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+					b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+					c2 * z * z + 2 * cd * z + d2;
+			}
+		};
+
+		struct Collapse
+		{
+			GLuint from;
+			GLuint to;
+			double cost;
+		};
+
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				uint32_t bits[3];
+				std::memcpy(bits, &p.x, sizeof(float));
+				std::memcpy(bits + 1, &p.y, sizeof(float));
+				std::memcpy(bits + 2, &p.z, sizeof(float));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		struct PositionEqual
+		{
+			bool operator()(const glm::vec3& a, const glm::vec3& b) const
+			{
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}
+		};
+
+		uint64_t edgeKey(GLuint a, GLuint b)
+		{
+			return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+		}
+
+		glm::vec3 faceNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+		{
+			return glm::cross(b - a, c - a);
+		}
+
+		bool sameAttributes(const Vertex& a, const Vertex& b)
+		{
+			const glm::vec3 normal = glm::abs(a.normal - b.normal);
+			const glm::vec2 uv = glm::abs(a.uv - b.uv);
+			const glm::vec4 tangent = glm::abs(a.tangent - b.tangent);
+			return std::max(std::max(normal.x, normal.y), normal.z) <= NORMAL_EPSILON &&
+				std::max(uv.x, uv.y) <= UV_EPSILON &&
+				std::max(std::max(tangent.x, tangent.y), std::max(tangent.z, tangent.w)) <= NORMAL_EPSILON;
+		}
+	}
+
+	std::vector<GLuint> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+									 size_t targetIndexCount, float* error)
+	{
+		const size_t vertexCount = vertices.size();
+
+		// Vertices sharing a position but not the other attributes form seams. Copies whose attributes match
+		// too are the same vertex, they are welded so a collapse moves all of their triangles.
+		std::vector<GLuint> canonical(vertexCount);
+		std::vector<bool> seam(vertexCount, false);
+		{
+			std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual> positions;
+			positions.reserve(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++)
+			{
+				auto result = positions.insert(std::make_pair(vertices[i].position, static_cast<GLuint>(i)));
+				canonical[i] = result.first->second;
+				if (!sameAttributes(vertices[i], vertices[canonical[i]]))
+					seam[canonical[i]] = true;
+			}
+		}
+
+		// Edges with a single triangle are open borders, more than two are non manifold.
+		std::vector<bool> locked(vertexCount, false);
+		{
+			std::unordered_map<uint64_t, unsigned int> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; e++)
+					edges[edgeKey(canonical[indices[i + e]], canonical[indices[i + (e + 1) % 3]])]++;
+			}
+			for (const auto& edge : edges)
+			{
+				if (edge.second != 2)
+				{
+					locked[edge.first >> 32] = true;
+					locked[edge.first & 0xffffffffu] = true;
+				}
+			}
+			for (size_t i = 0; i < vertexCount; i++)
+				locked[i] = locked[canonical[i]] || seam[canonical[i]];
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const glm::vec3& a = vertices[indices[i]].position;
+			glm::vec3 normal = faceNormal(a, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+			const float length = glm::length(normal);
+			if (length <= 0.0f)
+				continue;
+			normal /= length;
+
+			Quadric plane(normal.x, normal.y, normal.z, -glm::dot(normal, a));
+			for (int corner = 0; corner < 3; corner++)
+				quadrics[canonical[indices[i + corner]]] += plane;
+		}
+
+		std::vector<GLuint> result(indices);
+		for (auto& index : result)
+		{
+			if (!seam[canonical[index]])
+				index = canonical[index];
+		}
+		std::vector<GLuint> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<size_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<size_t> adjacency;
+		std::vector<Collapse> collapses;
+		double maxCost = 0.0;
+
+		for (int pass = 0; pass < MAX_PASSES && result.size() > targetIndexCount; pass++)
+		{
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (auto index : result)
+				adjacencyOffsets[index + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			adjacency.resize(result.size());
+			{
+				std::vector<size_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); i++)
+					adjacency[cursor[result[i]]++] = i / 3;
+			}
+
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					const GLuint from = result[i + e];
+					const GLuint to = result[i + (e + 1) % 3];
+					for (int direction = 0; direction < 2; direction++)
+					{
+						const GLuint a = direction == 0 ? from : to;
+						const GLuint b = direction == 0 ? to : from;
+						if (locked[a])
+							continue;
+
+						Quadric quadric = quadrics[canonical[a]];
+						quadric += quadrics[canonical[b]];
+						collapses.push_back(Collapse{ a, b, std::max(quadric.evaluate(vertices[b].position), 0.0) });
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			for (size_t v = 0; v < vertexCount; v++)
+				remap[v] = static_cast<GLuint>(v);
+			std::fill(touched.begin(), touched.end(), false);
+
+			const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+			size_t removed = 0;
+			size_t collapsed = 0;
+			for (const auto& collapse : collapses)
+			{
+				if (removed >= trianglesToRemove)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				// Reject collapses that fold a remaining triangle over.
+				const glm::vec3& target = vertices[collapse.to].position;
+				bool flips = false;
+				size_t degenerate = 0;
+				for (size_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++)
+				{
+					const GLuint* triangle = &result[adjacency[a] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					{
+						degenerate++;
+						continue;
+					}
+
+					glm::vec3 corners[3];
+					for (int c = 0; c < 3; c++)
+						corners[c] = vertices[triangle[c]].position;
+					const glm::vec3 before = faceNormal(corners[0], corners[1], corners[2]);
+					for (int c = 0; c < 3; c++)
+					{
+						if (triangle[c] == collapse.from)
+							corners[c] = target;
+					}
+					const glm::vec3 after = faceNormal(corners[0], corners[1], corners[2]);
+					flips = glm::dot(before, after) <= 0.0f;
+				}
+				if (flips)
+					continue;
+
+				// Neighbors of the collapsed vertex wait for the next pass, their triangles just changed.
+				for (size_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+				{
+					for (int c = 0; c < 3; c++)
+						touched[result[adjacency[a] * 3 + c]] = true;
+				}
+				remap[collapse.from] = collapse.to;
+				quadrics[canonical[collapse.to]] += quadrics[canonical[collapse.from]];
+				maxCost = std::max(maxCost, collapse.cost);
+				removed += degenerate;
+				collapsed++;
+			}
+			if (collapsed == 0)
+				break;
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				const GLuint a = remap[result[i]];
+				const GLuint b = remap[result[i + 1]];
+				const GLuint c = remap[result[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		if (error != nullptr)
+			*error = static_cast<float>(std::sqrt(maxCost));
+		return result;
+	}
+
+	void generateLods(MeshData& mesh, unsigned int maxLevels)
+	{
+		mesh.lods.clear();
+		mesh.lods.push_back(LodLevel{ 0, static_cast<GLuint>(mesh.indices.size()), 0.0f });
+
+		std::vector<GLuint> previous(mesh.indices);
+		float previousError = 0.0f;
+		for (unsigned int level = 1; level < maxLevels; level++)
+		{
+			const size_t target = previous.size() / 6 * 3;
+			if (target / 3 < MIN_LOD_TRIANGLES)
+				break;
+
+			// Errors are measured against the previous level, so they add up along the chain.
+			float error = 0.0f;
+			std::vector<GLuint> lod = simplifyMesh(mesh.vertices, previous, target, &error);
+			if (lod.size() > previous.size() * (1.0f - MIN_REDUCTION))
+				break;
+			optimizeVertexCache(lod, mesh.vertices.size());
+
+			previousError += error;
+			mesh.lods.push_back(LodLevel{ static_cast<GLuint>(mesh.indices.size()),
+				static_cast<GLuint>(lod.size()), previousError });
+			mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+			previous.swap(lod);
+		}
+	}
+}
@@ -1,8 +1,29 @@
 #include "model.hpp"
+#include "meshCache.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+#include "parallel.hpp"
+#include "textureCache.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <chrono>
 
 namespace Simp
 {
-	Model::Model(const std::string& path)
+	namespace
+	{
+		// Largest axis scale, the level errors and bounding radii grow with it.
+		float getScale(const glm::mat4& transform)
+		{
+			return std::max(glm::length(glm::vec3(transform[0])),
+				std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+		}
+	}
+
+	Model::Model(const std::string& path, GeometryArena& _arena, TextureLoader& loader, bool useCache)
+		: arena(_arena), visibleMeshes(0), loadTime(0.0), loadedFromCache(false)
 	{
 #if DEBUG_ASSIMP
 		Assimp::DefaultLogger::create("", Assimp::Logger::VERBOSE);
@@ -10,130 +31,273 @@ namespace Simp
 		Assimp::DefaultLogger::get()->attachStream(stderrStream, Assimp::Logger::NORMAL |
 			Assimp::Logger::DEBUGGING | Assimp::Logger::VERBOSE);
 #endif
+		auto start = std::chrono::steady_clock::now();
+		directory = path.substr(0, path.find_last_of('/'));
 
-		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path,
-			aiProcess_GenSmoothNormals |
-			aiProcess_CalcTangentSpace |
-			aiProcess_Triangulate |
-			aiProcess_FlipUVs);
-
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		MappedFile source;
+		if (!source.open(path))
 		{
-			std::cerr << "ERROR::ASSIMP" << importer.GetErrorString() << std::endl;
+			std::cerr << "ERROR::MODEL::FILE_NOT_FOUND " << path << std::endl;
 			return;
 		}
 
-		directory = path.substr(0, path.find_last_of('/'));
-		processNode(scene->mRootNode, scene);
+		const uint64_t key = MeshCache::key(source, IMPORT_FLAGS);
+		const std::string cacheFile = cachePath(toHex(key) + ".smesh");
+		source.close();
+
+		MeshCache cache;
+		if (useCache && cache.open(cacheFile, key))
+		{
+			// Blobs go straight from the mapped file into the GL buffers.
+			for (const auto& view : cache.getMeshes())
+			{
+				meshes.push_back(std::unique_ptr<Mesh>(new Mesh(arena, view.vertices, view.vertexCount,
+					view.indices, view.indexCount, loadMaterialTextures(view.textures, loader), view.lods)));
+			}
+			loadedFromCache = true;
+		}
+		else
+		{
+			std::vector<MeshData> data;
+			if (!import(path, data))
+				return;
+
+			if (useCache)
+				MeshCache::write(cacheFile, key, data);
+
+			for (const auto& mesh : data)
+			{
+				meshes.push_back(std::unique_ptr<Mesh>(new Mesh(arena, mesh.vertices, mesh.indices,
+					loadMaterialTextures(mesh.textures, loader), mesh.lods)));
+			}
+		}
+
+		bounds.reserve(meshes.size());
+		for (const auto& mesh : meshes)
+			bounds.add(mesh->boundsCenter, mesh->boundsRadius, mesh->boundsMin, mesh->boundsMax);
+		visibility.resize(getVisibilityMaskSize(meshes.size()));
+
+		loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "INFO::MODEL::LOADED " << path << " in " << loadTime << " ms"
+			<< (loadedFromCache ? " (cache hit)" : " (cache miss)") << std::endl;
 	}
 
 	Model::~Model()
 	{
+		for (auto texture : textureReferences)
+		{
+			TextureCache::get().release(texture);
+		}
+		// Frees the ranges now so the arena can compact the holes they leave.
+		meshes.clear();
+		arena.maybeDefragment();
 #if DEBUG_ASSIMP
 		Assimp::DefaultLogger::kill();
 #endif
 	}
 
-	void Model::draw(Shader& shader)
+	void Model::selectLods(LodSelector& selector, const glm::mat4& transform, const Frustum& frustum)
 	{
+		// Culling happens in model space, the box test stays exact under any affine transform.
+		visibleMeshes = cullBoxes(frustum.transformed(transform), bounds, visibility.data());
+
+		const float scale = getScale(transform);
 		for (int i = 0; i < meshes.size(); i++)
 		{
-			meshes[i].get()->draw(shader);
+			if (!isVisible(visibility.data(), i))
+				continue;
+
+			Mesh& mesh = *meshes[i];
+			const glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f));
+			mesh.currentLod = selector.select(mesh.lods, center, mesh.boundsRadius * scale, scale, mesh.currentLod);
 		}
 	}
 
-	void Model::processNode(const aiNode* node, const aiScene* scene)
+	void Model::submit(RenderQueue& queue, ShaderVariants& variants, LodSelector& selector, const glm::mat4& transform,
+		const Frustum& frustum, const Camera& camera)
 	{
-		for (unsigned int i = 0; i < node->mNumMeshes; i++)
-		{
-			processMesh(scene->mMeshes[node->mMeshes[i]], scene);
-		}
-		for (unsigned int i = 0; i < node->mNumChildren; i++)
+		selectLods(selector, transform, frustum);
+
+		DrawObject object;
+		object.model = transform;
+		object.invModel = glm::mat3(glm::inverseTranspose(transform));
+		object.flags = DrawObject::MODEL | DrawObject::NORMAL_MATRIX;
+		if (arena.getFormat().quantized)
+			object.flags |= DrawObject::COMPACT;
+
+		const glm::mat4 view = camera.getViewMatrix() * transform;
+		const float invFar = 1.0f / camera.getFar();
+		for (int i = 0; i < meshes.size(); i++)
 		{
-			processNode(node->mChildren[i], scene);
+			if (!isVisible(visibility.data(), i))
+				continue;
+
+			// Meshes share the transform but not the dequantization, each gets its own object.
+			const Mesh& mesh = *meshes[i];
+			object.positionScale = mesh.positionScale;
+			object.positionOffset = mesh.positionOffset;
+			const float depth = -(view * glm::vec4(mesh.boundsCenter, 1.0f)).z * invFar;
+			mesh.submit(queue, variants.get(mesh.material.maps), queue.addObject(object), mesh.currentLod, depth);
 		}
 	}
 
-	void Model::processMesh(const aiMesh* mesh, const aiScene* scene)
+	void Model::submit(InstanceBatch& batch, RenderQueue& queue, ShaderVariants& variants, LodSelector& selector,
+		const std::vector<InstanceData>& instances, const Frustum& frustum)
 	{
-		std::vector<Vertex> vertices;
-		std::vector<GLuint> indices;
-		std::vector<Texture> textures;
+		// Instances only differ in their transform, the object of a mesh carries its dequantization.
+		DrawObject object;
+		object.invModel = glm::mat3(1.0f);
+		object.flags = DrawObject::NORMAL_MATRIX;
+		if (arena.getFormat().quantized)
+			object.flags |= DrawObject::COMPACT;
+		std::vector<uint32_t> objects(meshes.size());
+		std::vector<Shader*> shaders(meshes.size());
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			object.positionScale = meshes[i]->positionScale;
+			object.positionOffset = meshes[i]->positionOffset;
+			objects[i] = queue.addObject(object);
+			shaders[i] = &variants.get(meshes[i]->material.maps | INSTANCED);
+		}
 
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+		visibleMeshes = 0;
+		for (const InstanceData& instance : instances)
 		{
-			Vertex vertex;
-			vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
-			vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-			vertex.tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
-			// vertex.bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+			const glm::mat4& transform = instance.model;
+			const size_t visible = cullBoxes(frustum.transformed(transform), bounds, visibility.data());
+			if (visible == 0)
+				continue;
+			visibleMeshes += visible;
 
-			if (mesh->mTextureCoords[0])
+			const float scale = getScale(transform);
+			for (int i = 0; i < meshes.size(); i++)
 			{
-				vertex.uv = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-			}
-			else
-			{
-				vertex.uv = glm::vec2(0.0f, 0.0f);
+				if (!isVisible(visibility.data(), i))
+					continue;
+
+				// Levels are picked per instance, the hysteresis of the mesh is only a hint here.
+				const Mesh& mesh = *meshes[i];
+				const glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundsCenter, 1.0f));
+				const unsigned int lod = selector.select(mesh.lods, center, mesh.boundsRadius * scale, scale, mesh.currentLod);
+				batch.add(mesh.makePacket(*shaders[i], objects[i], lod, 0.0f), instance);
 			}
+		}
+	}
+
+	bool Model::import(const std::string& path, std::vector<MeshData>& data)
+	{
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
 
-			vertices.push_back(vertex);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		{
+			std::cerr << "ERROR::ASSIMP" << importer.GetErrorString() << std::endl;
+			return false;
 		}
 
-		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+		processNode(scene->mRootNode, scene, data);
+
+		// Runs once per asset, the optimized meshes end up in the mesh cache.
+		std::vector<MeshOptimizationStats> stats(data.size());
+		parallelFor(0, data.size(), [&](size_t i)
 		{
-			for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
-			{
-				indices.push_back(mesh->mFaces[i].mIndices[j]);
-			}
+			stats[i] = optimizeMesh(data[i]);
+			generateLods(data[i]);
+		});
+		for (size_t i = 0; i < stats.size(); i++)
+		{
+			const std::vector<LodLevel>& lods = data[i].lods;
+			std::cout << "INFO::MESH_OPTIMIZER::MESH " << i << " ACMR " << stats[i].before.acmr << " -> "
+				<< stats[i].after.acmr << ", ATVR " << stats[i].before.atvr << " -> " << stats[i].after.atvr
+				<< ", " << lods.size() << " LODs";
+			if (lods.size() > 1)
+				std::cout << ", LOD1 " << lods[0].indexCount / 3 << " -> " << lods[1].indexCount / 3 << " triangles";
+			std::cout << std::endl;
+			// Meshes this big always have a first level unless the simplifier locked them, e.g. an unwelded import.
+			if (lods.size() < 2 && lods[0].indexCount / 3 >= 4 * MIN_LOD_TRIANGLES)
+				std::cerr << "WARNING::MESH_SIMPLIFIER::NO_LOD mesh " << i << " with " << lods[0].indexCount / 3
+					<< " triangles" << std::endl;
+		}
+		return true;
+	}
+
+	void Model::processNode(const aiNode* node, const aiScene* scene, std::vector<MeshData>& data)
+	{
+		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		{
+			data.emplace_back();
+			processMesh(scene->mMeshes[node->mMeshes[i]], scene, data.back());
+		}
+		for (unsigned int i = 0; i < node->mNumChildren; i++)
+		{
+			processNode(node->mChildren[i], scene, data);
 		}
+	}
 
+	void Model::processMesh(const aiMesh* mesh, const aiScene* scene, MeshData& data)
+	{
+		convertMesh(mesh, data);
 		if (mesh->mMaterialIndex >= 0)
 		{
-			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-			auto diffuse = loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Diffuse);
-			auto specular = loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Specular);
-			auto normals = loadMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal);
-			textures.insert(textures.begin(), diffuse.begin(), diffuse.end());
-			textures.insert(textures.begin(), specular.begin(), specular.end());
-			textures.insert(textures.begin(), normals.begin(), normals.end());
+			const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+			collectMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal, data.textures);
+			collectMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Specular, data.textures);
+			collectMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Diffuse, data.textures);
+		}
+	}
+
+	void Model::convertMesh(const aiMesh* mesh, MeshData& data)
+	{
+		data.vertices.resize(mesh->mNumVertices);
+		const aiVector3D* uvs = mesh->mTextureCoords[0];
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+		{
+			Vertex& vertex = data.vertices[i];
+			vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+			vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+			const glm::vec3 tangent(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+			const glm::vec3 bitangent(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+			// Only the handedness of the bitangent is kept, the shader rebuilds it from the normal and tangent.
+			const float sign = glm::dot(glm::cross(vertex.normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+			vertex.tangent = glm::vec4(tangent, sign);
+			vertex.uv = uvs ? glm::vec2(uvs[i].x, uvs[i].y) : glm::vec2(0.0f, 0.0f);
 		}
 
-		meshes.push_back(std::unique_ptr<Mesh>(new Mesh(vertices, indices, textures)));
+		data.indices.reserve(mesh->mNumFaces * 3);
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+		{
+			const aiFace& face = mesh->mFaces[i];
+			data.indices.insert(data.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+		}
 	}
 
-	std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType aiType, TextureType type)
+	void Model::collectMaterialTextures(const aiMaterial* mat, aiTextureType aiType, TextureType type,
+										std::vector<Texture>& textures) const
 	{
-		std::vector<Texture> textures;
 		for (unsigned int i = 0; i < mat->GetTextureCount(aiType); i++)
 		{
 			aiString str;
 			mat->GetTexture(aiType, i, &str);
 
-			auto relPath = std::string(str.C_Str());
-			bool skip = false;
-			for (unsigned int j = 0; j < texturesLoaded.size(); j++)
-			{
-				if (std::strcmp(texturesLoaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(texturesLoaded[j]);
-					skip = true;
-					break;
-				}
-			}
-
-			if (skip)
-				return textures;
-
 			Texture texture;
-			texture.id = loadTexture(directory + '/' + relPath, true);
+			texture.id = 0;
 			texture.type = type;
-			texture.path = relPath;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
+		}
+	}
+
+	std::vector<Texture> Model::loadMaterialTextures(const std::vector<Texture>& references, TextureLoader& loader)
+	{
+		std::vector<Texture> textures;
+		for (const auto& reference : references)
+		{
+			Texture texture = reference;
+			texture.id = TextureCache::get().acquire(directory + '/' + reference.path, true, loader);
 			textures.push_back(texture);
-			texturesLoaded.push_back(texture);
+			textureReferences.push_back(texture.id);
 		}
 
 		return textures;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,315 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace Simp
+{
+	namespace
+	{
+		double percentile(const std::vector<double>& sorted, double p)
+		{
+			if (sorted.empty())
+				return 0.0;
+			const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+			return sorted[std::min(index, sorted.size() - 1)];
+		}
+
+		void writeEscaped(std::ostream& out, const char* text)
+		{
+			for (const char* c = text; *c != '\0'; c++)
+			{
+				if (*c == '"' || *c == '\\')
+					out << '\\';
+				out << *c;
+			}
+		}
+	}
+
+	Profiler& Profiler::get()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	Profiler::Profiler() : enabled(false), tracing(false), inFrame(false), traceCapacity(0),
+		epoch(std::chrono::steady_clock::now()), gpuDepth(0), frame(0), droppedGpuScopes(0)
+	{
+	}
+
+	int64_t Profiler::now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	void Profiler::setEnabled(bool _enabled)
+	{
+		if (enabled == _enabled)
+			return;
+		enabled = _enabled;
+		// Scopes in flight belong to the old state.
+		inFrame = false;
+		events.clear();
+		stack.clear();
+		gpuDepth = 0;
+		for (GpuFrame& gpuFrame : gpuFrames)
+		{
+			gpuFrame.scopes.clear();
+			gpuFrame.usedQueries = 0;
+			gpuFrame.lastQuery = 0;
+		}
+	}
+
+	void Profiler::setTracing(bool _tracing, size_t capacity)
+	{
+		tracing = _tracing;
+		traceCapacity = capacity;
+		trace.clear();
+		if (tracing)
+			trace.reserve(std::min<size_t>(capacity, 1 << 16));
+	}
+
+	void Profiler::beginFrame()
+	{
+		if (!enabled)
+			return;
+
+		frameSamples.clear();
+		// The slot was last used GPU_FRAMES frames ago.
+		GpuFrame& gpuFrame = gpuFrames[frame % GPU_FRAMES];
+		collectGpu(gpuFrame);
+
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		gpuFrame.clockOffset = now() - gpuTime;
+		inFrame = true;
+	}
+
+	void Profiler::endFrame()
+	{
+		if (!enabled || !inFrame)
+			return;
+
+		for (const Event& event : events)
+			record(event);
+		flushSeries(false);
+		events.clear();
+		stack.clear();
+		inFrame = false;
+		frame++;
+	}
+
+	uint32_t Profiler::beginCpu(const char* name)
+	{
+		if (!enabled || !inFrame)
+			return NO_SCOPE;
+
+		Event event;
+		event.name = name;
+		event.start = now();
+		event.end = event.start;
+		event.depth = static_cast<uint32_t>(stack.size());
+		event.gpu = false;
+		const uint32_t index = static_cast<uint32_t>(events.size());
+		events.push_back(event);
+		stack.push_back(index);
+		return index;
+	}
+
+	void Profiler::endCpu(uint32_t index)
+	{
+		if (index == NO_SCOPE || index >= events.size())
+			return;
+		events[index].end = now();
+		if (!stack.empty())
+			stack.pop_back();
+	}
+
+	GLuint Profiler::acquireQuery(GpuFrame& gpuFrame)
+	{
+		if (gpuFrame.usedQueries == gpuFrame.queries.size())
+		{
+			// Grows in blocks, the pool of a frame is reused GPU_FRAMES frames later.
+			const size_t count = std::max<size_t>(gpuFrame.queries.size(), 16);
+			gpuFrame.queries.resize(gpuFrame.queries.size() + count);
+			glGenQueries(static_cast<GLsizei>(count), &gpuFrame.queries[gpuFrame.usedQueries]);
+		}
+		return gpuFrame.queries[gpuFrame.usedQueries++];
+	}
+
+	uint32_t Profiler::beginGpu(const char* name)
+	{
+		if (!enabled || !inFrame)
+			return NO_SCOPE;
+
+		GpuFrame& gpuFrame = gpuFrames[frame % GPU_FRAMES];
+		GpuPending scope;
+		scope.name = name;
+		scope.begin = acquireQuery(gpuFrame);
+		scope.end = acquireQuery(gpuFrame);
+		scope.depth = gpuDepth++;
+		scope.ended = false;
+		// Timestamps nest, unlike GL_TIME_ELAPSED queries.
+		glQueryCounter(scope.begin, GL_TIMESTAMP);
+		gpuFrame.lastQuery = scope.begin;
+		gpuFrame.scopes.push_back(scope);
+		return static_cast<uint32_t>(gpuFrame.scopes.size() - 1);
+	}
+
+	void Profiler::endGpu(uint32_t index)
+	{
+		if (index == NO_SCOPE)
+			return;
+
+		GpuFrame& gpuFrame = gpuFrames[frame % GPU_FRAMES];
+		if (index < gpuFrame.scopes.size())
+		{
+			GpuPending& scope = gpuFrame.scopes[index];
+			glQueryCounter(scope.end, GL_TIMESTAMP);
+			scope.ended = true;
+			gpuFrame.lastQuery = scope.end;
+		}
+		if (gpuDepth > 0)
+			gpuDepth--;
+	}
+
+	void Profiler::collectGpu(GpuFrame& gpuFrame)
+	{
+		if (!gpuFrame.scopes.empty())
+		{
+			// The last query issued finishes last, if it is not ready the frame is dropped instead of waited for.
+			GLint available = 0;
+			glGetQueryObjectiv(gpuFrame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				for (const GpuPending& scope : gpuFrame.scopes)
+				{
+					if (!scope.ended)
+					{
+						droppedGpuScopes++;
+						continue;
+					}
+
+					GLuint64 begin = 0;
+					GLuint64 end = 0;
+					glGetQueryObjectui64v(scope.begin, GL_QUERY_RESULT, &begin);
+					glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &end);
+
+					Event event;
+					event.name = scope.name;
+					event.start = static_cast<int64_t>(begin) + gpuFrame.clockOffset;
+					event.end = static_cast<int64_t>(end) + gpuFrame.clockOffset;
+					event.depth = scope.depth;
+					event.gpu = true;
+					record(event);
+				}
+				flushSeries(true);
+			}
+			else
+			{
+				droppedGpuScopes += static_cast<unsigned int>(gpuFrame.scopes.size());
+			}
+		}
+		gpuFrame.scopes.clear();
+		gpuFrame.usedQueries = 0;
+		gpuFrame.lastQuery = 0;
+		gpuDepth = 0;
+	}
+
+	void Profiler::record(const Event& event)
+	{
+		const std::string key = event.gpu ? std::string(event.name) + "#gpu" : std::string(event.name);
+		auto found = seriesIndex.find(key);
+		if (found == seriesIndex.end())
+		{
+			found = seriesIndex.emplace(key, series.size()).first;
+			series.emplace_back();
+			series.back().name = event.name;
+			series.back().gpu = event.gpu;
+		}
+		Series& scope = series[found->second];
+		scope.frameTotal += (event.end - event.start) * 1e-6;
+		scope.touched = true;
+
+		if (tracing && trace.size() < traceCapacity)
+			trace.push_back(event);
+	}
+
+	void Profiler::flushSeries(bool gpu)
+	{
+		for (Series& scope : series)
+		{
+			if (!scope.touched || scope.gpu != gpu)
+				continue;
+			if (scope.samples.size() < WINDOW)
+				scope.samples.push_back(scope.frameTotal);
+			else
+				scope.samples[scope.next] = scope.frameTotal;
+			scope.next = (scope.next + 1) % WINDOW;
+			frameSamples.push_back({ &scope.name, gpu, scope.frameTotal });
+			scope.frameTotal = 0.0;
+			scope.touched = false;
+		}
+	}
+
+	std::vector<Profiler::ScopeStats> Profiler::getStats() const
+	{
+		std::vector<ScopeStats> stats;
+		std::vector<double> sorted;
+		for (const Series& scope : series)
+		{
+			sorted = scope.samples;
+			std::sort(sorted.begin(), sorted.end());
+			ScopeStats entry;
+			entry.name = scope.name;
+			entry.gpu = scope.gpu;
+			entry.samples = sorted.size();
+			entry.p50 = percentile(sorted, 0.50);
+			entry.p95 = percentile(sorted, 0.95);
+			entry.p99 = percentile(sorted, 0.99);
+			entry.max = sorted.empty() ? 0.0 : sorted.back();
+			stats.push_back(entry);
+		}
+		return stats;
+	}
+
+	void Profiler::print() const
+	{
+		for (const ScopeStats& scope : getStats())
+		{
+			std::cout << "INFO::PROFILER " << (scope.gpu ? "GPU " : "CPU ") << scope.name << " p50 " << scope.p50
+				<< " p95 " << scope.p95 << " p99 " << scope.p99 << " max " << scope.max << " ms over "
+				<< scope.samples << " frames" << std::endl;
+		}
+		if (droppedGpuScopes > 0)
+			std::cout << "INFO::PROFILER " << droppedGpuScopes << " GPU scopes dropped, results were late" << std::endl;
+	}
+
+	bool Profiler::writeTrace(const std::string& path) const
+	{
+		std::ofstream out(path);
+		if (!out)
+		{
+			std::cerr << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+			return false;
+		}
+
+		// Complete events in microseconds, CPU scopes on thread 1 and GPU scopes on thread 2.
+		out << "{\"traceEvents\":[\n";
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+		out.precision(3);
+		out << std::fixed;
+		for (const Event& event : trace)
+		{
+			out << ",\n{\"name\":\"";
+			writeEscaped(out, event.name);
+			out << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+				<< (event.gpu ? 2 : 1) << ",\"ts\":" << event.start * 1e-3 << ",\"dur\":" << (event.end - event.start) * 1e-3 << "}";
+		}
+		out << "\n]}\n";
+		std::cout << "INFO::PROFILER::TRACE " << trace.size() << " events written to " << path << std::endl;
+		return true;
+	}
+}
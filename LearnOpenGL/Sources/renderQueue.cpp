@@ -0,0 +1,258 @@
+#include "renderQueue.hpp"
+#include "glState.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+// ARB_indirect_parameters, core in 4.6.
+#ifndef GL_PARAMETER_BUFFER_ARB
+	#define GL_PARAMETER_BUFFER_ARB 0x80EE
+#endif
+
+namespace Simp
+{
+	namespace
+	{
+		const unsigned int RADIX_BITS = 8;
+		const unsigned int RADIX_BUCKETS = 1 << RADIX_BITS;
+		const unsigned int RADIX_PASSES = 64 / RADIX_BITS;
+
+		uint32_t nextMaterialId = 0;
+
+		double milliseconds(std::chrono::steady_clock::duration duration)
+		{
+			return std::chrono::duration<double, std::milli>(duration).count();
+		}
+	}
+
+	Material::Material() : id(nextMaterialId++), textureCount(0), textures(), maps(0), specular(1.0f), shininess(32.0f)
+	{
+	}
+
+	void Material::addTexture(GLuint texture, UniformName sampler)
+	{
+		if (textureCount == MAX_TEXTURES)
+		{
+			std::cerr << "WARNING::MATERIAL::TOO_MANY_TEXTURES " << sampler.name << std::endl;
+			return;
+		}
+		textures[textureCount] = texture;
+		samplers[textureCount] = sampler;
+		textureCount++;
+	}
+
+	RenderQueue::DrawIndirectCount RenderQueue::drawIndirectCount = nullptr;
+
+	uint64_t RenderQueue::makeKey(unsigned int pass, bool transparent, uint32_t program, uint32_t material, uint32_t mesh, float depth)
+	{
+		const uint64_t depthBits = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * 0xFFFFFF);
+		const uint64_t state = (static_cast<uint64_t>(program & 0x3FF) << 22) | (static_cast<uint64_t>(material & 0xFFF) << 10) | (mesh & 0x3FF);
+
+		uint64_t key = static_cast<uint64_t>(pass & 0xF) << 60;
+		if (transparent)
+			key |= (1ull << 59) | ((0xFFFFFF - depthBits) << 35) | (state << 3);
+		else
+			key |= (state << 27) | (depthBits << 3);
+		return key;
+	}
+
+	uint32_t RenderQueue::addObject(const DrawObject& object)
+	{
+		objects.push_back(object);
+		return static_cast<uint32_t>(objects.size() - 1);
+	}
+
+	void RenderQueue::submit(const DrawPacket& packet)
+	{
+		packets.push_back(packet);
+	}
+
+	void RenderQueue::clear()
+	{
+		packets.clear();
+		objects.clear();
+	}
+
+	void RenderQueue::sort()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const size_t count = packets.size();
+		items.resize(count);
+		scratch.resize(count);
+
+		// Histograms of every digit in one pass over the keys.
+		std::vector<size_t> histograms(RADIX_PASSES * RADIX_BUCKETS, 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint64_t key = packets[i].key;
+			items[i].key = key;
+			items[i].index = static_cast<uint32_t>(i);
+			for (unsigned int pass = 0; pass < RADIX_PASSES; pass++)
+				histograms[pass * RADIX_BUCKETS + ((key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+		}
+
+		for (unsigned int pass = 0; pass < RADIX_PASSES && count > 0; pass++)
+		{
+			size_t* histogram = &histograms[pass * RADIX_BUCKETS];
+			const unsigned int shift = pass * RADIX_BITS;
+			// Digits every key shares need no scatter, usually the pass and the unused low bits.
+			if (histogram[(items[0].key >> shift) & (RADIX_BUCKETS - 1)] == count)
+				continue;
+
+			size_t offset = 0;
+			for (unsigned int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+			{
+				const size_t size = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += size;
+			}
+			for (const SortItem& item : items)
+				scratch[histogram[(item.key >> shift) & (RADIX_BUCKETS - 1)]++] = item;
+			items.swap(scratch);
+		}
+		stats.sortTime = milliseconds(std::chrono::steady_clock::now() - start);
+	}
+
+	void RenderQueue::execute()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const double sortTime = stats.sortTime;
+		stats = Stats();
+		stats.sortTime = sortTime;
+
+		// Bindings are filtered by GLState, the queue only tracks what it needs for the uniforms.
+		GLState& glState = GLState::get();
+		Shader* shader = nullptr;
+		ProgramUniforms uniforms;
+		const Material* material = nullptr;
+		uint32_t object = NO_OBJECT;
+#if SIMP_PROFILER
+		Profiler& profiler = Profiler::get();
+		unsigned int pass = 16;
+		uint32_t passScope = Profiler::NO_SCOPE;
+#endif
+
+		for (const SortItem& item : items)
+		{
+			const DrawPacket& packet = packets[item.index];
+#if SIMP_PROFILER
+			if (static_cast<unsigned int>(item.key >> 60) != pass)
+			{
+				profiler.endGpu(passScope);
+				pass = static_cast<unsigned int>(item.key >> 60);
+				passScope = passNames[pass] != nullptr ? profiler.beginGpu(passNames[pass]) : Profiler::NO_SCOPE;
+			}
+#endif
+			if (packet.shader != shader)
+			{
+				shader = packet.shader;
+				shader->use();
+				stats.programChanges++;
+				uniforms.model = shader->getUniform(SIMP_UNIFORM("model"), false);
+				uniforms.invModel = shader->getUniform(SIMP_UNIFORM("invModel"), false);
+				uniforms.compactVertex = shader->getUniform(SIMP_UNIFORM("compactVertex"), false);
+				uniforms.positionScale = shader->getUniform(SIMP_UNIFORM("positionScale"), false);
+				uniforms.positionOffset = shader->getUniform(SIMP_UNIFORM("positionOffset"), false);
+				uniforms.maps = shader->getUniform(SIMP_UNIFORM("material.maps"), false);
+				uniforms.specular = shader->getUniform(SIMP_UNIFORM("material.specular"), false);
+				uniforms.shininess = shader->getUniform(SIMP_UNIFORM("material.shininess"), false);
+				uniforms.instanceOffset = shader->getUniform(SIMP_UNIFORM("instanceOffset"), false);
+				// Uniforms live in the program, the next material and object have to be bound again.
+				material = nullptr;
+				object = NO_OBJECT;
+			}
+			if (glState.bindVertexArray(packet.vertexArray))
+				stats.vertexArrayChanges++;
+			if (glState.setEnabled(GL_CULL_FACE, (packet.state & DrawPacket::NO_CULL) == 0))
+				stats.stateChanges++;
+			if (packet.material != nullptr && packet.material != material)
+			{
+				material = packet.material;
+				bindMaterial(*shader, uniforms, *material);
+				stats.materialChanges++;
+			}
+			if (packet.object != NO_OBJECT && packet.object != object)
+			{
+				object = packet.object;
+				bindObject(*shader, uniforms, objects[object]);
+				stats.objectChanges++;
+			}
+
+			const size_t indexSize = packet.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+			const void* indices = reinterpret_cast<void*>(packet.first * indexSize);
+			if (packet.indirect != nullptr)
+			{
+				const IndirectDraw& indirect = *packet.indirect;
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.commandBuffer);
+				if (drawIndirectCount != nullptr)
+				{
+					glBindBuffer(GL_PARAMETER_BUFFER_ARB, indirect.countBuffer);
+					drawIndirectCount(packet.mode, packet.indexType, reinterpret_cast<void*>(indirect.commandOffset),
+						indirect.countOffset, indirect.maxDrawCount, 0);
+				}
+				else
+				{
+					glMultiDrawElementsIndirect(packet.mode, packet.indexType, reinterpret_cast<void*>(indirect.commandOffset),
+						indirect.maxDrawCount, 0);
+				}
+				stats.indirectDraws++;
+			}
+			else if (packet.instanceCount > 0)
+			{
+				// GLSL 4.30 has no gl_BaseInstance, the offset into the instance buffer is a uniform.
+				shader->bind(uniforms.instanceOffset, packet.baseInstance);
+				if (packet.indexType == 0)
+					glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instanceCount);
+				else
+					glDrawElementsInstancedBaseVertex(packet.mode, packet.count, packet.indexType, indices,
+						packet.instanceCount, packet.baseVertex);
+				stats.instances += packet.instanceCount;
+			}
+			else if (packet.indexType == 0)
+			{
+				glDrawArrays(packet.mode, packet.first, packet.count);
+			}
+			else
+			{
+				glDrawElementsBaseVertex(packet.mode, packet.count, packet.indexType, indices, packet.baseVertex);
+			}
+			stats.draws++;
+		}
+#if SIMP_PROFILER
+		profiler.endGpu(passScope);
+#endif
+
+		stats.submitTime = milliseconds(std::chrono::steady_clock::now() - start);
+	}
+
+	void RenderQueue::bindMaterial(Shader& shader, const ProgramUniforms& uniforms, const Material& material)
+	{
+		for (unsigned int unit = 0; unit < material.textureCount; unit++)
+		{
+			shader.bind(material.samplers[unit], static_cast<int>(unit));
+			if (GLState::get().bindTexture(unit, GL_TEXTURE_2D, material.textures[unit]))
+				stats.textureBinds++;
+		}
+		// Missing uniforms are skipped by bind, e.g. material.maps in specialized variants.
+		shader.bind(uniforms.maps, material.maps);
+		shader.bind(uniforms.specular, material.specular);
+		shader.bind(uniforms.shininess, material.shininess);
+	}
+
+	void RenderQueue::bindObject(Shader& shader, const ProgramUniforms& uniforms, const DrawObject& object)
+	{
+		if (object.flags & DrawObject::MODEL)
+			shader.bind(uniforms.model, object.model);
+		if (object.flags & DrawObject::NORMAL_MATRIX)
+		{
+			shader.bind(uniforms.invModel, object.invModel);
+			shader.bind(uniforms.compactVertex, (object.flags & DrawObject::COMPACT) != 0);
+		}
+		if (object.flags & DrawObject::COMPACT)
+		{
+			shader.bind(uniforms.positionScale, object.positionScale);
+			shader.bind(uniforms.positionOffset, object.positionOffset);
+		}
+	}
+}
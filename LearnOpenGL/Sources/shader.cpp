@@ -1,50 +1,235 @@
 #include "shader.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "fileCache.hpp"
+
+// KHR_parallel_shader_compile, not part of the core headers.
+#ifndef GL_COMPLETION_STATUS_KHR
+	#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace Simp
 {
+	bool Shader::binaryCache = true;
+	Shader::CacheStats Shader::cacheStats = {};
+	uint32_t Shader::nextSerial = 0;
+
+	namespace
+	{
+		// Whether glProgramUniform of setter, one of the scalar, vector or matrix types, may write a uniform of type.
+		// Bools take any scalar setter, samplers and images are set by index like ints.
+		bool matchesType(GLenum type, GLenum setter)
+		{
+			if (type == setter)
+				return true;
+			switch (type)
+			{
+				case GL_BOOL:
+					return setter == GL_INT || setter == GL_UNSIGNED_INT || setter == GL_FLOAT;
+				case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+				case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+				case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x2:
+				case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+				case GL_DOUBLE: case GL_DOUBLE_VEC2: case GL_DOUBLE_VEC3: case GL_DOUBLE_VEC4:
+				case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+				case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+				case GL_BOOL_VEC2: case GL_BOOL_VEC3: case GL_BOOL_VEC4:
+					return false;
+				default:
+					return setter == GL_INT;
+			}
+		}
+
+		// Program binaries are only valid for the driver that produced them.
+		uint64_t getDriverHash()
+		{
+			static uint64_t hash = 0;
+			if (hash == 0)
+			{
+				hash = HASH_SEED;
+				const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+				for (GLenum name : names)
+				{
+					auto value = reinterpret_cast<const char*>(glGetString(name));
+					hash = hashString(value != nullptr ? value : "", hash);
+				}
+			}
+			return hash;
+		}
+
+		bool hasParallelCompile()
+		{
+			static int supported = -1;
+			if (supported < 0)
+			{
+				supported = 0;
+				GLint count = 0;
+				glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+				for (GLint i = 0; i < count; i++)
+				{
+					auto name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+					if (name != nullptr && (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0
+						|| std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+						supported = 1;
+				}
+				if (!supported)
+					std::cout << "INFO::SHADER::NO_PARALLEL_COMPILE reloads compile one stage per frame" << std::endl;
+			}
+			return supported == 1;
+		}
+
+		bool hasProgramBinary()
+		{
+			static int supported = -1;
+			if (supported < 0)
+			{
+				GLint formats = 0;
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+				supported = formats > 0 ? 1 : 0;
+				if (!supported)
+					std::cout << "INFO::SHADER::NO_PROGRAM_BINARY_FORMATS caching disabled" << std::endl;
+			}
+			return supported == 1;
+		}
+	}
+
 	void Shader::use()
 	{
-		glUseProgram(id);
+		GLState::get().useProgram(id);
 	}
 
-	Shader& Shader::attach(const std::string& fileName)
+	std::string Shader::getPath(const std::string& fileName)
 	{
-		const std::string path = PROJECT_SOURCE_DIR "/LearnOpenGL/Shaders/";
+		return PROJECT_SOURCE_DIR "/LearnOpenGL/Shaders/" + fileName;
+	}
 
-		std::string code;
+	bool Shader::readFile(const std::string& fileName, std::string& code, bool required)
+	{
 		std::ifstream vShaderFile;
 		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 		try
 		{
-			vShaderFile.open(path + fileName);
+			vShaderFile.open(getPath(fileName));
 			std::stringstream vShaderStream;
 			vShaderStream << vShaderFile.rdbuf();
 			code = vShaderStream.str();
 		}
 		catch (std::ifstream::failure e)
 		{
-			std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: "
-				<< path + fileName << std::endl;
+			if (required)
+				std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: "
+					<< getPath(fileName) << std::endl;
+			return false;
 		}
-		vShaderFile.close();
+		return true;
+	}
 
-		GLuint shader = create(fileName);
+	bool Shader::readSource(Source& source)
+	{
+		std::string code;
+		source.code.clear();
+		source.includes.clear();
+		return readFile(source.fileName, code) && expandIncludes(source.fileName, code, 0, source, source.code);
+	}
 
-		const char* codePointer = code.c_str();
-		glShaderSource(shader, 1, &codePointer, NULL);
-		glCompileShader(shader);
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-		if (status != GL_TRUE)
+	bool Shader::expandIncludes(const std::string& fileName, const std::string& code, int number, Source& source, std::string& output)
+	{
+		const auto slash = fileName.rfind('/');
+		const std::string directory = slash == std::string::npos ? std::string() : fileName.substr(0, slash + 1);
+
+		bool expanded = true;
+		std::istringstream stream(code);
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(stream, line))
 		{
-			glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
-			std::unique_ptr<char[]> infoLog(new char[length]);
-			glGetShaderInfoLog(shader, length, NULL, infoLog.get());
-			std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED "
-				<< fileName << "\n" << infoLog.get() << std::endl;
+			lineNumber++;
+			const size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+			{
+				output += line;
+				output += '\n';
+				continue;
+			}
+
+			// Directives are replaced by empty lines so the line numbers of the file stay intact.
+			output += '\n';
+			const size_t open = line.find_first_of("\"<", start + 8);
+			const size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+			if (close == std::string::npos)
+			{
+				std::cerr << "ERROR::SHADER::INCLUDE_MALFORMED " << fileName << "(" << lineNumber << ")" << std::endl;
+				expanded = false;
+				continue;
+			}
+
+			// Relative to the including file first, then to the shader directory.
+			const std::string name = line.substr(open + 1, close - open - 1);
+			std::string include = directory + name;
+			std::string text;
+			if (!readFile(include, text, false))
+			{
+				include = name;
+				if (!readFile(include, text))
+				{
+					expanded = false;
+					continue;
+				}
+			}
+			// Every file is included once, which also breaks include cycles.
+			if (include == source.fileName || std::find(source.includes.begin(), source.includes.end(), include) != source.includes.end())
+				continue;
+
+			source.includes.push_back(include);
+			const int includeNumber = static_cast<int>(source.includes.size());
+			output += "#line 1 " + std::to_string(includeNumber) + "\n";
+			expanded = expandIncludes(include, text, includeNumber, source, output) && expanded;
+			output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(number) + "\n";
 		}
+		return expanded;
+	}
 
-		glAttachShader(id, shader);
-		glDeleteShader(shader);
+	Shader& Shader::attach(const std::string& fileName)
+	{
+		Source source;
+		source.fileName = fileName;
+		readSource(source);
+		sources.push_back(source);
+		return *this;
+	}
+
+	bool Shader::hasSource(const std::string& fileName) const
+	{
+		for (const auto& source : sources)
+		{
+			if (source.fileName == fileName || std::find(source.includes.begin(), source.includes.end(), fileName) != source.includes.end())
+				return true;
+		}
+		return false;
+	}
+
+	std::vector<std::string> Shader::getFileNames() const
+	{
+		std::vector<std::string> fileNames;
+		for (const auto& source : sources)
+		{
+			fileNames.push_back(source.fileName);
+			for (const auto& include : source.includes)
+			{
+				if (std::find(fileNames.begin(), fileNames.end(), include) == fileNames.end())
+					fileNames.push_back(include);
+			}
+		}
+		return fileNames;
+	}
+
+	Shader& Shader::define(const std::string& name, const std::string& value)
+	{
+		defines.emplace_back(name, value);
 		return *this;
 	}
 
@@ -59,54 +244,476 @@ namespace Simp
 		else                    return false;
 	}
 
-	Shader& Shader::link()
+	uint64_t Shader::getCacheKey() const
 	{
-		glLinkProgram(id);
-		glGetProgramiv(id, GL_LINK_STATUS, &status);
+		const uint32_t version = BINARY_VERSION;
+		uint64_t key = hashBytes(&version, sizeof(version), getDriverHash());
+		for (const auto& source : sources)
+		{
+			key = hashString(source.fileName, key);
+			key = hashString(source.code, key);
+		}
+		for (const auto& define : defines)
+		{
+			key = hashString(define.first, key);
+			key = hashString(define.second, key);
+		}
+		return key;
+	}
+
+	GLuint Shader::compileStage(const Source& source) const
+	{
+		std::string header;
+		for (const auto& define : defines)
+			header += "#define " + define.first + " " + define.second + "\n";
+
+		// Defines go right after #version, which has to stay the first statement.
+		std::string code = source.code;
+		size_t insert = 0;
+		size_t version = code.find("#version");
+		if (version != std::string::npos)
+		{
+			insert = code.find('\n', version);
+			if (insert == std::string::npos)
+			{
+				code += '\n';
+				insert = code.size() - 1;
+			}
+			insert++;
+		}
+		// #line keeps the line numbers of compile errors matching the file.
+		const auto line = std::count(code.begin(), code.begin() + insert, '\n') + 1;
+		if (!header.empty())
+			code.insert(insert, header + "#line " + std::to_string(line) + "\n");
+
+		GLuint shader = create(source.fileName);
+		const char* codePointer = code.c_str();
+		glShaderSource(shader, 1, &codePointer, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	bool Shader::checkStage(GLuint shader, const Source& source)
+	{
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+			std::unique_ptr<char[]> infoLog(new char[std::max(length, 1)]());
+			glGetShaderInfoLog(shader, length, NULL, infoLog.get());
+			std::cerr << "ERROR::SHADER::COMPILATION_FAILED "
+				<< source.fileName << "\n" << infoLog.get();
+			// Errors in included files are reported with their source string number.
+			for (size_t i = 0; i < source.includes.size(); i++)
+				std::cerr << "  " << i + 1 << ": " << source.includes[i] << "\n";
+			std::cerr << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool Shader::checkProgram(GLuint program)
+	{
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
 		if (status != GL_TRUE)
 		{
-			glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
-			std::unique_ptr<char[]> infoLog(new char[length]);
-			glGetProgramInfoLog(id, length, NULL, infoLog.get());
+			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			std::unique_ptr<char[]> infoLog(new char[std::max(length, 1)]());
+			glGetProgramInfoLog(program, length, NULL, infoLog.get());
 			std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
 				<< infoLog.get() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void Shader::detachStages(GLuint program)
+	{
+		GLint count = 0;
+		glGetProgramiv(program, GL_ATTACHED_SHADERS, &count);
+		std::vector<GLuint> shaders(std::max(count, 1));
+		glGetAttachedShaders(program, count, NULL, shaders.data());
+		for (GLint i = 0; i < count; i++)
+			glDetachShader(program, shaders[i]);
+	}
+
+	bool Shader::loadBinary(const std::string& path, uint64_t key)
+	{
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+
+		BinaryHeader header;
+		if (file.getSize() < sizeof(header))
+			return false;
+		std::memcpy(&header, file.getData(), sizeof(header));
+		if (header.magic != BINARY_MAGIC || header.version != BINARY_VERSION || header.key != key
+			|| file.getSize() < sizeof(header) + header.size)
+			return false;
+
+		glProgramBinary(id, header.format, file.getData() + sizeof(header), header.size);
+		glGetProgramiv(id, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			// Driver updates or a different GPU, the program is left unlinked and is built from source.
+			std::cout << "WARNING::SHADER::BINARY_REJECTED " << path << std::endl;
+			cacheStats.rejected++;
+			return false;
+		}
+		return true;
+	}
+
+	void Shader::saveBinary(const std::string& path, uint64_t key)
+	{
+		GLint size = 0;
+		glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &size);
+		if (size <= 0)
+			return;
+
+		std::vector<char> buffer(sizeof(BinaryHeader) + size);
+		BinaryHeader header;
+		header.magic = BINARY_MAGIC;
+		header.version = BINARY_VERSION;
+		header.key = key;
+		GLenum format = 0;
+		GLsizei written = 0;
+		glGetProgramBinary(id, size, &written, &format, buffer.data() + sizeof(header));
+		header.format = format;
+		header.size = static_cast<uint32_t>(written);
+		std::memcpy(buffer.data(), &header, sizeof(header));
+		buffer.resize(sizeof(header) + written);
+
+		// Write to a temporary file first so a crash never leaves a truncated binary behind.
+		const std::string temporary = path + ".tmp";
+		{
+			std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+			if (!stream.write(buffer.data(), buffer.size()))
+			{
+				std::cerr << "WARNING::SHADER::CACHE_WRITE_FAILED " << temporary << std::endl;
+				return;
+			}
+		}
+		std::remove(path.c_str());
+		if (std::rename(temporary.c_str(), path.c_str()) != 0)
+			std::remove(temporary.c_str());
+	}
+
+	Shader& Shader::link()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const bool cacheable = hasProgramBinary();
+		const uint64_t key = getCacheKey();
+		const std::string path = cacheable ? cachePath("program_" + toHex(key) + ".bin") : std::string();
+
+		if (cacheable && binaryCache && loadBinary(path, key))
+		{
+			cacheStats.hits++;
+		}
+		else
+		{
+			cacheStats.misses++;
+			for (const auto& source : sources)
+			{
+				GLuint shader = compileStage(source);
+				checkStage(shader, source);
+				glAttachShader(id, shader);
+				// Only flagged for deletion, it goes away once detached after linking.
+				glDeleteShader(shader);
+			}
+			if (cacheable)
+				glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			glLinkProgram(id);
+			if (checkProgram(id) && cacheable)
+				saveBinary(path, key);
+			detachStages(id);
 		}
 		assert(status);
+		cacheStats.linkTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		reflect();
 		return *this;
 	}
 
-	void Shader::bind(GLuint location, GLuint value)
+	void Shader::reload()
+	{
+		cancelReload();
+		for (auto& source : sources)
+			readSource(source);
+
+		pending.program = glCreateProgram();
+		pending.start = std::chrono::steady_clock::now();
+		// With parallel compile every stage is handed to the driver threads now, otherwise poll compiles one per frame.
+		if (hasParallelCompile())
+		{
+			while (pending.shaders.size() < sources.size())
+				compileNext();
+		}
+	}
+
+	void Shader::compileNext()
+	{
+		GLuint shader = compileStage(sources[pending.shaders.size()]);
+		glAttachShader(pending.program, shader);
+		glDeleteShader(shader);
+		pending.shaders.push_back(shader);
+	}
+
+	void Shader::cancelReload()
+	{
+		if (pending.program != 0)
+			GLState::get().deleteProgram(pending.program);
+		pending.program = 0;
+		pending.shaders.clear();
+		pending.linking = false;
+	}
+
+	bool Shader::poll()
+	{
+		if (pending.program == 0)
+			return false;
+
+		const bool parallel = hasParallelCompile();
+		if (pending.shaders.size() < sources.size())
+		{
+			compileNext();
+			return false;
+		}
+
+		if (!pending.linking)
+		{
+			if (parallel)
+			{
+				for (GLuint shader : pending.shaders)
+				{
+					GLint complete = GL_FALSE;
+					glGetShaderiv(shader, GL_COMPLETION_STATUS_KHR, &complete);
+					if (complete != GL_TRUE)
+						return false;
+				}
+			}
+			bool compiled = true;
+			for (size_t i = 0; i < pending.shaders.size(); i++)
+				compiled = checkStage(pending.shaders[i], sources[i]) && compiled;
+			if (!compiled)
+			{
+				std::cerr << "ERROR::SHADER::RELOAD_FAILED keeping the previous program" << std::endl;
+				cancelReload();
+				return false;
+			}
+			if (hasProgramBinary())
+				glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			glLinkProgram(pending.program);
+			pending.linking = true;
+			return false;
+		}
+
+		if (parallel)
+		{
+			GLint complete = GL_FALSE;
+			glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+			if (complete != GL_TRUE)
+				return false;
+		}
+		if (!checkProgram(pending.program))
+		{
+			std::cerr << "ERROR::SHADER::RELOAD_FAILED keeping the previous program" << std::endl;
+			cancelReload();
+			return false;
+		}
+
+		// The new program only replaces the old one once it is ready to draw.
+		detachStages(pending.program);
+		GLState::get().deleteProgram(id);
+		id = pending.program;
+		pending.program = 0;
+		pending.shaders.clear();
+		pending.linking = false;
+		reflect();
+
+		if (hasProgramBinary())
+		{
+			const uint64_t key = getCacheKey();
+			saveBinary(cachePath("program_" + toHex(key) + ".bin"), key);
+		}
+		reloadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.start).count();
+		return true;
+	}
+
+	void Shader::reflect()
+	{
+		uniforms.clear();
+		keys.clear();
+		blocks.clear();
+		missing.clear();
+
+		GLint count = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> name(std::max(maxLength, 1) + 16);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLint size;
+			GLenum type;
+			glGetActiveUniform(id, i, static_cast<GLsizei>(name.size()), NULL, &size, &type, name.data());
+			// Members of uniform blocks have no location.
+			if (glGetUniformLocation(id, name.data()) < 0)
+				continue;
+
+			// Arrays are reported as name[0], every element is registered and name is a second key of element 0,
+			// so both names share one shadow copy.
+			std::string base = name.data();
+			const bool array = base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0;
+			if (array)
+				base.resize(base.size() - 3);
+			for (GLint element = 0; element < size; element++)
+			{
+				UniformInfo uniform = {};
+				uniform.name = array ? base + "[" + std::to_string(element) + "]" : base;
+				uniform.location = glGetUniformLocation(id, uniform.name.c_str());
+				uniform.type = type;
+				const int slot = static_cast<int>(uniforms.size());
+				keys.push_back({ hashUniformName(uniform.name.c_str()), slot });
+				if (array && element == 0)
+					keys.push_back({ hashUniformName(base.c_str()), slot });
+				uniforms.push_back(std::move(uniform));
+			}
+		}
+
+		size_t capacity = 16;
+		while (capacity < keys.size() * 2)
+			capacity *= 2;
+		table.assign(capacity, -1);
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			size_t bucket = keys[i].hash & (capacity - 1);
+			while (table[bucket] >= 0)
+			{
+				if (keys[table[bucket]].hash == keys[i].hash)
+					std::cerr << "ERROR::SHADER::UNIFORM_HASH_COLLISION " << keys[i].hash << std::endl;
+				bucket = (bucket + 1) & (capacity - 1);
+			}
+			table[bucket] = static_cast<int>(i);
+		}
+
+		glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+		name.resize(std::max(maxLength, 1));
+		for (GLint i = 0; i < count; i++)
+		{
+			glGetActiveUniformBlockName(id, i, static_cast<GLsizei>(name.size()), NULL, name.data());
+			blocks.push_back({ hashUniformName(name.data()), static_cast<GLuint>(i) });
+		}
+	}
+
+	int Shader::find(uint32_t hash) const
+	{
+		if (table.empty())
+			return -1;
+		const size_t mask = table.size() - 1;
+		for (size_t bucket = hash & mask; table[bucket] >= 0; bucket = (bucket + 1) & mask)
+		{
+			const UniformKey& key = keys[table[bucket]];
+			if (key.hash == hash)
+				return key.slot;
+		}
+		return -1;
+	}
+
+	Shader::Uniform Shader::getUniform(UniformName name, bool required) const
+	{
+		Uniform uniform;
+		uniform.slot = find(name.hash);
+		if (uniform.valid())
+			uniform.type = uniforms[uniform.slot].type;
+		else if (required)
+			std::cout << "WARNING::uniform location missing! " << name.name << std::endl;
+		return uniform;
+	}
+
+	GLuint Shader::getUniformBlock(UniformName name) const
+	{
+		for (const auto& block : blocks)
+		{
+			if (block.hash == name.hash)
+				return block.index;
+		}
+		return GL_INVALID_INDEX;
+	}
+
+	void Shader::warnMissing(UniformName name)
+	{
+		// Warn once per name instead of every frame.
+		if (missing.insert(name.hash).second)
+			std::cout << "WARNING::uniform location missing! " << name.name << std::endl;
+	}
+
+	bool Shader::update(UniformInfo& uniform, GLenum type, const void* value, size_t size)
+	{
+#ifndef NDEBUG
+		if (!uniform.mismatched && !matchesType(uniform.type, type))
+		{
+			uniform.mismatched = true;
+			std::cerr << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << uniform.name << " is 0x" << std::hex << uniform.type
+				<< ", set as 0x" << type << std::dec << std::endl;
+		}
+#endif
+		if (uniform.cached && std::memcmp(uniform.value, value, size) == 0)
+		{
+			skippedCount++;
+			return false;
+		}
+		std::memcpy(uniform.value, value, size);
+		uniform.cached = true;
+		uploadCount++;
+		return true;
+	}
+
+	// The program does not have to be in use, glProgramUniform writes to it directly.
+	void Shader::set(UniformInfo& uniform, GLuint value)
+	{
+		if (update(uniform, GL_UNSIGNED_INT, &value, sizeof(value)))
+			glProgramUniform1ui(id, uniform.location, value);
+	}
+
+	void Shader::set(UniformInfo& uniform, int value)
 	{
-		glUniform1ui(location, value);
+		if (update(uniform, GL_INT, &value, sizeof(value)))
+			glProgramUniform1i(id, uniform.location, value);
 	}
 
-	void Shader::bind(GLuint location, int value)
+	void Shader::set(UniformInfo& uniform, bool value)
 	{
-		glUniform1i(location, value);
+		set(uniform, (int)value);
 	}
 
-	void Shader::bind(GLuint location, bool value)
+	void Shader::set(UniformInfo& uniform, float value)
 	{
-		bind(location, (int)value);
+		if (update(uniform, GL_FLOAT, &value, sizeof(value)))
+			glProgramUniform1f(id, uniform.location, value);
 	}
 
-	void Shader::bind(GLuint location, float value)
+	void Shader::set(UniformInfo& uniform, const glm::vec3& value)
 	{
-		glUniform1f(location, value);
+		if (update(uniform, GL_FLOAT_VEC3, glm::value_ptr(value), sizeof(float) * 3))
+			glProgramUniform3f(id, uniform.location, value.x, value.y, value.z);
 	}
 
-	void Shader::bind(GLuint location, const glm::vec3& value)
+	void Shader::set(UniformInfo& uniform, const glm::vec4& value)
 	{
-		glUniform3f(location, value.x, value.y, value.z);
+		if (update(uniform, GL_FLOAT_VEC4, glm::value_ptr(value), sizeof(float) * 4))
+			glProgramUniform4f(id, uniform.location, value.x, value.y, value.z, value.w);
 	}
 
-	void Shader::bind(GLuint location, const glm::mat3& value)
+	void Shader::set(UniformInfo& uniform, const glm::mat3& value)
 	{
-		glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+		if (update(uniform, GL_FLOAT_MAT3, glm::value_ptr(value), sizeof(float) * 9))
+			glProgramUniformMatrix3fv(id, uniform.location, 1, GL_FALSE, glm::value_ptr(value));
 	}
 
-	void Shader::bind(GLuint location, const glm::mat4& value)
+	void Shader::set(UniformInfo& uniform, const glm::mat4& value)
 	{
-		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+		if (update(uniform, GL_FLOAT_MAT4, glm::value_ptr(value), sizeof(float) * 16))
+			glProgramUniformMatrix4fv(id, uniform.location, 1, GL_FALSE, glm::value_ptr(value));
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,59 @@
+#include "shaderVariants.hpp"
+
+namespace Simp
+{
+	ShaderVariants::ShaderVariants(const std::vector<std::string>& _files, const std::vector<std::string>& _features,
+		uint32_t _interfaceFeatures)
+		: files(_files), features(_features), interfaceFeatures(_interfaceFeatures), specialized(true)
+	{
+	}
+
+	Shader& ShaderVariants::get(uint32_t mask)
+	{
+		const uint32_t key = specialized ? mask : UBER | (mask & interfaceFeatures);
+		auto found = variants.find(key);
+		if (found != variants.end())
+			return *found->second;
+
+		std::unique_ptr<Shader> shader(new Shader());
+		for (const auto& file : files)
+			shader->attach(file);
+		if (!(key & UBER))
+			shader->define("VARIANT");
+		for (size_t i = 0; i < features.size(); i++)
+		{
+			if (key & (1u << i))
+				shader->define(features[i]);
+		}
+		shader->link();
+		for (const auto& value : shared)
+			value.second(*shader);
+
+		std::cout << "INFO::SHADER::VARIANT " << files.back() << " 0x" << std::hex << key << std::dec
+			<< " (" << variants.size() + 1 << " compiled)" << std::endl;
+		Shader& variant = *shader;
+		variants.emplace(key, std::move(shader));
+		return variant;
+	}
+
+	std::vector<Shader*> ShaderVariants::getShaders() const
+	{
+		std::vector<Shader*> shaders;
+		for (const auto& variant : variants)
+			shaders.push_back(variant.second.get());
+		return shaders;
+	}
+
+	void ShaderVariants::setShared(uint32_t hash, std::function<void(Shader&)> apply)
+	{
+		for (auto& value : shared)
+		{
+			if (value.first == hash)
+			{
+				value.second = std::move(apply);
+				return;
+			}
+		}
+		shared.emplace_back(hash, std::move(apply));
+	}
+}
@@ -0,0 +1,178 @@
+#include "shaderWatcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+namespace Simp
+{
+	namespace
+	{
+		double milliseconds(std::chrono::steady_clock::duration duration)
+		{
+			return std::chrono::duration<double, std::milli>(duration).count();
+		}
+
+		std::time_t getModificationTime(const std::string& path)
+		{
+			struct stat info;
+			return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+		}
+	}
+
+	ShaderWatcher::ShaderWatcher() : descriptor(-1), lastPoll(Clock::now()), longestStall(0.0), longestFrame(0.0)
+	{
+#ifdef __linux__
+		descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (descriptor < 0)
+			std::cout << "WARNING::SHADER_WATCHER::NO_INOTIFY polling modification times" << std::endl;
+#endif
+	}
+
+	ShaderWatcher::~ShaderWatcher()
+	{
+#ifdef __linux__
+		if (descriptor >= 0)
+			close(descriptor);
+#endif
+	}
+
+	void ShaderWatcher::watch(Shader& shader)
+	{
+		shaders.push_back(&shader);
+		watchFiles(shader);
+	}
+
+	void ShaderWatcher::watch(ShaderVariants& variants)
+	{
+		variantSets.emplace_back(&variants, 0);
+	}
+
+	void ShaderWatcher::watchFiles(const Shader& shader)
+	{
+		for (const auto& fileName : shader.getFileNames())
+		{
+			if (times.count(fileName) == 0)
+				times[fileName] = getModificationTime(Shader::getPath(fileName));
+#ifdef __linux__
+			if (descriptor < 0)
+				continue;
+			// Watch directories rather than files, editors often save by replacing the file.
+			auto slash = fileName.rfind('/');
+			const std::string directory = slash == std::string::npos ? std::string() : fileName.substr(0, slash + 1);
+			const int watch = inotify_add_watch(descriptor, Shader::getPath(directory).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (watch < 0)
+				std::cerr << "ERROR::SHADER_WATCHER::WATCH_FAILED " << Shader::getPath(directory) << std::endl;
+			else
+				directories[watch] = directory;
+#endif
+		}
+	}
+
+	std::set<std::string> ShaderWatcher::readChanges()
+	{
+		std::set<std::string> changes;
+#ifdef __linux__
+		if (descriptor >= 0)
+		{
+			alignas(inotify_event) char buffer[4096];
+			ssize_t size;
+			while ((size = read(descriptor, buffer, sizeof(buffer))) > 0)
+			{
+				for (ssize_t offset = 0; offset < size;)
+				{
+					auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+					auto directory = directories.find(event->wd);
+					if (event->len > 0 && directory != directories.end())
+						changes.insert(directory->second + event->name);
+					offset += sizeof(inotify_event) + event->len;
+				}
+			}
+			return changes;
+		}
+#endif
+		// Stat every watched file a few times per second.
+		const auto now = Clock::now();
+		if (milliseconds(now - lastPoll) < 250.0)
+			return changes;
+		lastPoll = now;
+		for (auto& file : times)
+		{
+			const std::time_t time = getModificationTime(Shader::getPath(file.first));
+			if (time != file.second)
+			{
+				file.second = time;
+				changes.insert(file.first);
+			}
+		}
+		return changes;
+	}
+
+	void ShaderWatcher::update()
+	{
+		const auto start = Clock::now();
+		if (!reloading.empty())
+			longestFrame = std::max(longestFrame, milliseconds(start - lastUpdate));
+
+		std::vector<Shader*> watched = shaders;
+		for (auto& variants : variantSets)
+		{
+			const std::vector<Shader*> compiled = variants.first->getShaders();
+			if (compiled.size() != variants.second)
+			{
+				for (Shader* shader : compiled)
+					watchFiles(*shader);
+				variants.second = compiled.size();
+			}
+			watched.insert(watched.end(), compiled.begin(), compiled.end());
+		}
+
+		for (const auto& fileName : readChanges())
+		{
+			for (Shader* shader : watched)
+			{
+				if (!shader->hasSource(fileName))
+					continue;
+				if (reloading.empty())
+				{
+					reloadStart = start;
+					longestStall = 0.0;
+					longestFrame = 0.0;
+				}
+				shader->reload();
+				if (std::find(reloading.begin(), reloading.end(), shader) == reloading.end())
+					reloading.push_back(shader);
+				std::cout << "INFO::SHADER_WATCHER::CHANGED " << fileName << std::endl;
+			}
+		}
+
+		for (size_t i = 0; i < reloading.size();)
+		{
+			Shader* shader = reloading[i];
+			if (shader->poll())
+				std::cout << "INFO::SHADER::RELOADED " << shader->getFileNames().front() << " in " << shader->getReloadTime() << " ms" << std::endl;
+			if (!shader->isReloading())
+				reloading.erase(reloading.begin() + i);
+			else
+				i++;
+		}
+
+		lastUpdate = Clock::now();
+		if (reloadStart != Clock::time_point())
+		{
+			longestStall = std::max(longestStall, milliseconds(lastUpdate - start));
+			if (reloading.empty())
+			{
+				std::cout << "INFO::SHADER_WATCHER::RELOAD finished in " << milliseconds(lastUpdate - reloadStart)
+					<< " ms, longest stall " << longestStall << " ms, longest frame " << longestFrame << " ms" << std::endl;
+				reloadStart = Clock::time_point();
+			}
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#include "streamBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Simp
+{
+	namespace
+	{
+		GLint getOffsetAlignment(GLenum target)
+		{
+			GLint alignment = 256;
+			if (target == GL_UNIFORM_BUFFER)
+				glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			else if (target == GL_SHADER_STORAGE_BUFFER)
+				glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			return alignment > 0 ? alignment : 256;
+		}
+	}
+
+	StreamBuffer::BufferStorage StreamBuffer::bufferStorage = nullptr;
+
+	StreamBuffer::StreamBuffer(GLenum _target, GLsizeiptr _size) : target(_target), size(_size), stride(0), buffer(0),
+		mapped(nullptr), fences(), section(0), stats()
+	{
+		create();
+	}
+
+	StreamBuffer::~StreamBuffer()
+	{
+		destroy();
+	}
+
+	void StreamBuffer::create()
+	{
+		const GLsizeiptr alignment = getOffsetAlignment(target);
+		stride = (size + alignment - 1) / alignment * alignment;
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+		if (bufferStorage != nullptr)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			bufferStorage(target, stride * FRAMES, NULL, flags);
+			mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, stride * FRAMES, flags));
+			stats.calls++;
+			if (mapped == nullptr)
+				std::cerr << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl;
+		}
+		else
+		{
+			glBufferData(target, stride * FRAMES, NULL, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(target, 0);
+		stats.calls += 4;
+	}
+
+	void StreamBuffer::destroy()
+	{
+		for (auto& fence : fences)
+		{
+			if (fence != nullptr)
+			{
+				glDeleteSync(fence);
+				stats.calls++;
+			}
+			fence = nullptr;
+		}
+		if (mapped != nullptr)
+		{
+			glBindBuffer(target, buffer);
+			glUnmapBuffer(target);
+			glBindBuffer(target, 0);
+			mapped = nullptr;
+			stats.calls += 3;
+		}
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		stats.calls++;
+	}
+
+	void StreamBuffer::advance()
+	{
+		fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		section = (section + 1) % FRAMES;
+		stats.calls++;
+
+		GLsync& fence = fences[section];
+		if (fence == nullptr)
+			return;
+		// The section was last used FRAMES - 1 frames ago, usually its fence has long been signaled.
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		stats.calls++;
+		while (result == GL_TIMEOUT_EXPIRED)
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			stats.calls++;
+		}
+		if (result == GL_WAIT_FAILED)
+			std::cerr << "ERROR::STREAM_BUFFER::WAIT_FAILED" << std::endl;
+		glDeleteSync(fence);
+		fence = nullptr;
+		stats.calls++;
+	}
+
+	bool StreamBuffer::reserve(GLsizeiptr _size)
+	{
+		if (_size <= size)
+			return false;
+
+		// Buffer storage is immutable, the whole buffer has to be replaced.
+		destroy();
+		size = std::max(_size, size * 2);
+		section = 0;
+		create();
+		return true;
+	}
+
+	void StreamBuffer::write(GLintptr offset, const void* data, GLsizeiptr bytes)
+	{
+		if (bytes <= 0)
+			return;
+
+		const GLintptr start = section * stride + offset;
+		if (mapped != nullptr)
+		{
+			std::memcpy(mapped + start, data, bytes);
+		}
+		else
+		{
+			glBindBuffer(target, buffer);
+			glBufferSubData(target, start, bytes, data);
+			glBindBuffer(target, 0);
+			stats.calls += 3;
+		}
+		stats.bytes += bytes;
+	}
+
+	void StreamBuffer::bind(GLuint binding, GLsizeiptr bytes)
+	{
+		glBindBufferRange(target, binding, buffer, section * stride, std::max<GLsizeiptr>(bytes, 4));
+		stats.calls++;
+	}
+}
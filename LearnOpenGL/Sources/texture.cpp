@@ -0,0 +1,220 @@
+#include "texture.hpp"
+#include "bakedTexture.hpp"
+#include "glState.hpp"
+
+#include <stb_image.h>
+
+#include <cstring>
+#include <iostream>
+
+namespace Simp
+{
+	GLuint getFormat(int channelNum)
+	{
+		GLuint format{ GL_RED };
+		switch (channelNum)
+		{
+		case 1: format = GL_RED;       break;
+		case 2: format = GL_RG;        break;
+		case 3: format = GL_RGB;       break;
+		case 4: format = GL_RGBA;      break;
+		}
+		return 	format;
+	}
+
+	size_t uploadTexture(GLuint texture, const unsigned char* data, int width, int height, int channelNum)
+	{
+		GLuint format = getFormat(channelNum);
+		GLState::get().bindTexture(GL_TEXTURE_2D, texture);
+		// Rows of one to three channel images are not necessarily 4 byte aligned.
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		// Core profile has no luminance formats, swizzle gray and gray alpha images instead.
+		if (channelNum == 1)
+		{
+			const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		else if (channelNum == 2)
+		{
+			const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+
+		GLint wrap = GL_REPEAT;
+		if (format == GL_RGBA || format == GL_RG)
+		{
+			wrap = GL_CLAMP_TO_EDGE;
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+
+		// The mip chain adds another third on top of the base level.
+		return static_cast<size_t>(width) * height * channelNum * 4 / 3;
+	}
+
+	size_t uploadBakedTexture(GLuint texture, const unsigned char* data, size_t size)
+	{
+		BakedTextureHeader header;
+		if (size < sizeof(header))
+			return 0;
+		std::memcpy(&header, data, sizeof(header));
+		if (header.magic != BAKED_TEXTURE_MAGIC || header.version != BAKED_TEXTURE_VERSION || header.mipCount == 0)
+			return 0;
+
+		size_t offset = sizeof(header) + header.mipCount * sizeof(BakedMipLevel);
+		if (offset > size)
+			return 0;
+
+		GLState::get().bindTexture(GL_TEXTURE_2D, texture);
+		size_t bytes = 0;
+		for (uint32_t level = 0; level < header.mipCount; level++)
+		{
+			BakedMipLevel mip;
+			std::memcpy(&mip, data + sizeof(header) + level * sizeof(BakedMipLevel), sizeof(mip));
+			if (offset + mip.size > size)
+			{
+				GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+				return 0;
+			}
+
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, header.format, mip.width, mip.height, 0,
+				mip.size, data + offset);
+			offset += mip.size;
+			bytes += mip.size;
+		}
+
+		// Drivers without BPTC or S3TC reject the upload and leave level 0 without a compressed image, the caller falls
+		// back to the source image. Asking the texture keeps errors of earlier, unrelated calls out of the decision.
+		GLint compressed = GL_FALSE;
+		GLint internalFormat = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+		if (compressed != GL_TRUE || static_cast<uint32_t>(internalFormat) != header.format)
+		{
+			GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+			return 0;
+		}
+
+		// All levels come from the file, nothing is generated at runtime.
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.mipCount - 1);
+		if (header.format == GL_COMPRESSED_RED_RGTC1)
+		{
+			const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+
+		GLint wrap = (header.flags & BAKED_ALPHA) ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+		return bytes;
+	}
+
+	GLuint loadTexture(const std::string& path, bool flip)
+	{
+		GLuint texture;
+
+		int width;
+		int height;
+		int channelNum;
+
+		stbi_set_flip_vertically_on_load_thread(flip);
+		unsigned char* data = stbi_load(path.c_str(), &width, &height, &channelNum, 0);
+		if (data == nullptr)
+		{
+			std::cerr << "WARNING::Failed to load image! " << path << std::endl;
+			stbi_image_free(data);
+			return 0;
+		}
+
+		glGenTextures(1, &texture);
+		uploadTexture(texture, data, width, height, channelNum);
+		stbi_image_free(data);
+
+		return texture;
+	}
+
+	GLuint loadHDR(const std::string& path, bool flip)
+	{
+		GLuint texture;
+
+		int width;
+		int height;
+		int channelNum;
+
+		stbi_set_flip_vertically_on_load_thread(flip);
+		float* data = stbi_loadf(path.c_str(), &width, &height, &channelNum, 0);
+		if (data == nullptr)
+		{
+			std::cerr << "WARNING::Failed to load hdr image! " << path << std::endl;
+			stbi_image_free(data);
+			return 0;
+		}
+
+		glGenTextures(1, &texture);
+		GLState::get().bindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16, width, height, 0, GL_RGB, GL_FLOAT, data);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+
+		stbi_image_free(data);
+
+		return texture;
+	}
+
+
+	GLuint loadCubemap(const std::vector<std::string> images, bool flip)
+	{
+		GLuint handle;
+		GLuint format;
+
+		glGenTextures(0, &handle);
+		GLState::get().bindTexture(GL_TEXTURE_CUBE_MAP, handle);
+
+		int width;
+		int height;
+		int channelNum;
+
+		stbi_set_flip_vertically_on_load_thread(flip);
+
+		for (int i = 0; i < images.size(); i++)
+		{
+			unsigned char* data = stbi_load(images[i].c_str(), &width, &height, &channelNum, 0);
+			format = getFormat(channelNum);
+
+			if (data == nullptr)
+			{
+				std::cerr << "WARNING::Failed to load cube map image!" << std::endl;
+			}
+			else
+			{
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+			}
+
+			stbi_image_free(data);
+		}
+
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		GLState::get().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
+		return handle;
+	}
+}
\ No newline at end of file
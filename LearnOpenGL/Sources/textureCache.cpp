@@ -0,0 +1,166 @@
+#include "textureCache.hpp"
+#include "glState.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <vector>
+
+namespace Simp
+{
+	TextureCache& TextureCache::get()
+	{
+		static TextureCache cache;
+		return cache;
+	}
+
+	GLuint TextureCache::acquire(const std::string& path, bool flip, TextureLoader& loader)
+	{
+		// Flipped and unflipped versions are different images.
+		const std::string key = normalize(path) + (flip ? "#flip" : "");
+
+		auto it = entries.find(key);
+		if (it != entries.end())
+		{
+			it->second.references++;
+			stats.hits++;
+			return it->second.texture;
+		}
+
+		Entry entry;
+		entry.texture = loader.request(path, flip, &entry.upload);
+		entry.references = 1;
+		entry.bytes = 0;
+		entry.deferred = false;
+		entries.emplace(key, entry);
+		keys.emplace(entry.texture, key);
+
+		stats.misses++;
+		stats.textures++;
+		return entry.texture;
+	}
+
+	void TextureCache::release(GLuint texture)
+	{
+		auto key = keys.find(texture);
+		if (key == keys.end())
+			return;
+
+		Entry& entry = entries[key->second];
+		if (--entry.references > 0)
+			return;
+
+		// Deleting the name under a queued upload would let it write into whatever texture gets the name next.
+		if (!entry.upload.isDone())
+		{
+			if (!entry.deferred)
+			{
+				entry.deferred = true;
+				JobSystem::get().schedule([texture] { TextureCache::get().destroy(texture); }, { entry.upload },
+					JobLane::Main);
+			}
+			return;
+		}
+		destroy(texture);
+	}
+
+	void TextureCache::destroy(GLuint texture)
+	{
+		auto key = keys.find(texture);
+		if (key == keys.end())
+			return;
+
+		auto it = entries.find(key->second);
+		it->second.deferred = false;
+		if (it->second.references > 0)
+			return;
+
+		GLState::get().deleteTexture(texture);
+		stats.textures--;
+		stats.bytes -= it->second.bytes;
+		entries.erase(it);
+		keys.erase(key);
+	}
+
+	void TextureCache::trackUpload(GLuint texture, size_t bytes)
+	{
+		auto key = keys.find(texture);
+		if (key == keys.end())
+			return;
+
+		Entry& entry = entries[key->second];
+		stats.bytes += bytes - entry.bytes;
+		entry.bytes = bytes;
+	}
+
+	void TextureCache::clear()
+	{
+		// Waiting runs Main jobs, which may destroy deferred entries, so the handles are copied first.
+		std::vector<JobHandle> uploads;
+		for (auto& entry : entries)
+		{
+			uploads.push_back(entry.second.upload);
+		}
+		for (const auto& upload : uploads)
+		{
+			JobSystem::get().wait(upload);
+		}
+		for (auto& entry : entries)
+		{
+			GLState::get().deleteTexture(entry.second.texture);
+		}
+		entries.clear();
+		keys.clear();
+		stats.textures = 0;
+		stats.bytes = 0;
+	}
+
+	void TextureCache::printStats() const
+	{
+		std::cout << "INFO::TEXTURE_CACHE hits " << stats.hits << ", misses " << stats.misses
+			<< ", textures " << stats.textures << ", " << stats.bytes / 1024 << " KiB" << std::endl;
+	}
+
+	std::string TextureCache::normalize(const std::string& path)
+	{
+		std::string unified = path;
+		std::replace(unified.begin(), unified.end(), '\\', '/');
+#ifdef _WIN32
+		std::transform(unified.begin(), unified.end(), unified.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+
+		// Collapse empty and "." segments and resolve ".." where possible.
+		std::vector<std::string> segments;
+		size_t start = 0;
+		while (start <= unified.size())
+		{
+			size_t end = unified.find('/', start);
+			if (end == std::string::npos)
+				end = unified.size();
+
+			std::string segment = unified.substr(start, end - start);
+			if (segment == "..")
+			{
+				if (!segments.empty() && segments.back() != ".." && !segments.back().empty())
+					segments.pop_back();
+				else
+					segments.push_back(segment);
+			}
+			else if (!(segment.empty() && !segments.empty()) && segment != ".")
+			{
+				segments.push_back(segment);
+			}
+			start = end + 1;
+		}
+
+		std::string normalized;
+		for (size_t i = 0; i < segments.size(); i++)
+		{
+			if (i > 0)
+				normalized += '/';
+			normalized += segments[i];
+		}
+		return normalized;
+	}
+}
@@ -0,0 +1,121 @@
+#include "textureLoader.hpp"
+#include "bakedTexture.hpp"
+#include "texture.hpp"
+#include "textureCache.hpp"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+namespace Simp
+{
+	TextureLoader::Image::Image(GLuint _texture, const std::string& _path, bool _flip) : texture(_texture),
+		path(_path), flip(_flip), data(nullptr), width(0), height(0), channelNum(0)
+	{
+	}
+
+	TextureLoader::Image::~Image()
+	{
+		stbi_image_free(data);
+	}
+
+	GLuint TextureLoader::request(const std::string& path, bool flip, JobHandle* upload)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+
+		JobSystem& jobs = JobSystem::get();
+		auto image = std::make_shared<Image>(texture, path, flip);
+		JobHandle decoded = jobs.schedule([image] { decode(*image); });
+		uploads.push_back(jobs.schedule([image] { TextureLoader::upload(*image); }, { decoded }, JobLane::Main));
+		if (upload != nullptr)
+			*upload = uploads.back();
+		return texture;
+	}
+
+	size_t TextureLoader::poll()
+	{
+		JobSystem::get().runMainThreadJobs();
+		const size_t count = uploads.size();
+		uploads.erase(std::remove_if(uploads.begin(), uploads.end(),
+			[](const JobHandle& upload) { return upload.isDone(); }), uploads.end());
+		return count - uploads.size();
+	}
+
+	void TextureLoader::flush()
+	{
+		for (const auto& upload : uploads)
+		{
+			JobSystem::get().wait(upload);
+		}
+		uploads.clear();
+	}
+
+	void TextureLoader::decode(Image& image)
+	{
+		if (readBaked(image, image.baked))
+			return;
+
+		// The thread local flag keeps concurrent requests from racing on stb's global state.
+		stbi_set_flip_vertically_on_load_thread(image.flip);
+		image.data = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channelNum, 0);
+	}
+
+	bool TextureLoader::readBaked(const Image& image, std::vector<unsigned char>& baked)
+	{
+		std::ifstream stream(bakedTexturePath(image.path), std::ios::binary | std::ios::ate);
+		if (!stream)
+			return false;
+
+		auto size = static_cast<size_t>(stream.tellg());
+		if (size < sizeof(BakedTextureHeader))
+			return false;
+
+		baked.resize(size);
+		stream.seekg(0);
+		stream.read(reinterpret_cast<char*>(baked.data()), size);
+
+		BakedTextureHeader header;
+		std::memcpy(&header, baked.data(), sizeof(header));
+		const bool flipped = (header.flags & BAKED_FLIPPED) != 0;
+		if (!stream || header.magic != BAKED_TEXTURE_MAGIC || flipped != image.flip)
+		{
+			baked.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void TextureLoader::upload(Image& image)
+	{
+		if (!image.baked.empty())
+		{
+			size_t bytes = uploadBakedTexture(image.texture, image.baked.data(), image.baked.size());
+			std::vector<unsigned char>().swap(image.baked);
+			if (bytes > 0)
+			{
+				TextureCache::get().trackUpload(image.texture, bytes);
+				return;
+			}
+
+			std::cerr << "WARNING::Baked texture rejected, decoding source image! " << image.path << std::endl;
+			stbi_set_flip_vertically_on_load_thread(image.flip);
+			image.data = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channelNum, 0);
+		}
+
+		if (image.data == nullptr)
+		{
+			std::cerr << "WARNING::Failed to load image! " << image.path << std::endl;
+			return;
+		}
+
+		size_t bytes = uploadTexture(image.texture, image.data, image.width, image.height, image.channelNum);
+		TextureCache::get().trackUpload(image.texture, bytes);
+		stbi_image_free(image.data);
+		image.data = nullptr;
+	}
+}
@@ -0,0 +1,109 @@
+#include "vertexCompression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Simp
+{
+	namespace
+	{
+		uint32_t packSnorm10(float value)
+		{
+			int quantized = static_cast<int>(std::round(std::min(std::max(value, -1.0f), 1.0f) * 511.0f));
+			return static_cast<uint32_t>(quantized) & 0x3ffu;
+		}
+	}
+
+	uint16_t packHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000u;
+		const int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x007fffffu;
+
+		if (exponent >= 31)
+			return static_cast<uint16_t>(sign | 0x7c00u);
+		if (exponent <= 0)
+		{
+			// Subnormal half, anything below its range flushes to zero.
+			if (exponent < -10)
+				return static_cast<uint16_t>(sign);
+			mantissa |= 0x00800000u;
+			const int shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1u)
+				half++;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		// Round to nearest, a carry into the exponent is still the correct result.
+		if (mantissa & 0x00001000u)
+			half++;
+		return static_cast<uint16_t>(half);
+	}
+
+	uint32_t packOctahedral(const glm::vec3& direction, float w)
+	{
+		const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		float x = 0.0f;
+		float y = 0.0f;
+		if (length > 0.0f)
+		{
+			x = direction.x / length;
+			y = direction.y / length;
+			if (direction.z < 0.0f)
+			{
+				// Fold the lower hemisphere over the diagonals.
+				const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = foldedX;
+				y = foldedY;
+			}
+		}
+
+		const uint32_t sign = w < 0.0f ? 0x3u : 0x1u;
+		return packSnorm10(x) | (packSnorm10(y) << 10) | (sign << 30);
+	}
+
+	Dequantization quantizeVertices(const Vertex* vertices, size_t count, CompactVertex* output)
+	{
+		glm::vec3 minimum(0.0f);
+		glm::vec3 maximum(0.0f);
+		if (count > 0)
+		{
+			minimum = vertices[0].position;
+			maximum = vertices[0].position;
+		}
+		for (size_t i = 1; i < count; i++)
+		{
+			minimum = glm::min(minimum, vertices[i].position);
+			maximum = glm::max(maximum, vertices[i].position);
+		}
+
+		Dequantization dequantization;
+		dequantization.scale = maximum - minimum;
+		dequantization.offset = minimum;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const Vertex& vertex = vertices[i];
+			CompactVertex& compact = output[i];
+			for (int c = 0; c < 3; c++)
+			{
+				const float extent = dequantization.scale[c];
+				const float t = extent > 0.0f ? (vertex.position[c] - minimum[c]) / extent : 0.0f;
+				compact.position[c] = static_cast<uint16_t>(std::round(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f));
+			}
+			compact.position[3] = 0;
+			compact.normal = packOctahedral(vertex.normal, 1.0f);
+			compact.tangent = packOctahedral(glm::vec3(vertex.tangent), vertex.tangent.w);
+			compact.uv[0] = packHalf(vertex.uv.x);
+			compact.uv[1] = packHalf(vertex.uv.y);
+		}
+		return dequantization;
+	}
+}
@@ -1,16 +1,24 @@
 #include "world.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <iostream>
 
 namespace Simp
 {
+	static_assert(sizeof(DirectionalLight) == sizeof(glm::vec4) * 2, "DirectionalLight has to match std140");
+	static_assert(sizeof(OtherLight) == sizeof(glm::vec4) * 4, "OtherLight has to match std430");
+
 	OtherLight::OtherLight(glm::vec4 _pos, glm::vec3 _color) :
-		pos(_pos), color(_color), dir(glm::vec3(1.0f, 0.0f, 0.0f)), angles(calculateSpotAngle(360.0f, 360.0f))
+		pos(_pos), color(_color), colorPadding(0.0f), dir(glm::vec3(1.0f, 0.0f, 0.0f)), dirPadding(0.0f),
+		angles(calculateSpotAngle(360.0f, 360.0f)), anglesPadding(0.0f)
 	{
 	}
 
 	OtherLight::OtherLight(glm::vec4 _pos, glm::vec3 _color, glm::vec3 _dir, float outter, float inner)
-		: pos(_pos), color(_color), dir(_dir), angles(calculateSpotAngle(outter, inner))
+		: pos(_pos), color(_color), colorPadding(0.0f), dir(_dir), dirPadding(0.0f),
+		angles(calculateSpotAngle(outter, inner)), anglesPadding(0.0f)
 	{
 	}
 
@@ -32,12 +40,14 @@ namespace Simp
 		return glm::vec2(invRange, -outCos * invRange);
 	}
 
-	World::World()
+	World::World() : lightBlock(GL_UNIFORM_BUFFER, uboSize),
+		lightBuffer(GL_SHADER_STORAGE_BUFFER, MAX_OTHER_LIGHTS * sizeof(OtherLight)),
+		blockData(uboSize / sizeof(glm::vec4), glm::vec4(0.0f)), blockDirty(StreamBuffer::FRAMES), uploadStats()
+	{
+	}
+
+	World::~World()
 	{
-		glGenBuffers(1, &ubo);
-		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-		glBufferData(GL_UNIFORM_BUFFER, uboSize, NULL, GL_DYNAMIC_DRAW);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 
 	World& World::attachLight(std::unique_ptr<DirectionalLight>& light)
@@ -56,75 +66,123 @@ namespace Simp
 
 	void World::bindBuffer(const Shader& shader)
 	{
-		auto id = shader.getHandle();
-		GLsizei uniformBlockSize;
-
-		GLuint uniformBlockIndex = glGetUniformBlockIndex(id, uboName);
-		glGetActiveUniformBlockiv(id, uniformBlockIndex,
-									GL_UNIFORM_BLOCK_DATA_SIZE,
-									&uniformBlockSize);
-
-		// Attach the buffer to UBO binding point 0.
-		glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
-		// Associate the uniform block to this binding point.
-		glUniformBlockBinding(id, uniformBlockIndex, 0);
+		GLuint uniformBlockIndex = shader.getUniformBlock(uboName);
+		// Associate the uniform block to binding point 0, bindLights attaches the buffer.
+		glUniformBlockBinding(shader.getHandle(), uniformBlockIndex, 0);
 	}
 
-	void World::bindLights()
+	size_t World::packLights(const std::vector<std::unique_ptr<OtherLight>>& lights, std::vector<glm::vec4>& data,
+		std::vector<uint8_t>& dirty)
 	{
-		GLuint offset = 0;
+		// Every section of the stream buffer has to see a change, so a changed light is written FRAMES times.
+		const size_t lightVectors = sizeof(OtherLight) / sizeof(glm::vec4);
+		data.resize(lights.size() * lightVectors);
+		dirty.resize(lights.size(), StreamBuffer::FRAMES);
+		size_t changed = 0;
+		for (size_t i = 0; i < lights.size(); i++)
+		{
+			if (std::memcmp(&data[i * lightVectors], lights[i].get(), sizeof(OtherLight)) != 0)
+			{
+				std::memcpy(glm::value_ptr(data[i * lightVectors]), lights[i].get(), sizeof(OtherLight));
+				dirty[i] = StreamBuffer::FRAMES;
+				changed++;
+			}
+		}
+		return changed;
+	}
+
+	void World::bindLights(const Camera& camera)
+	{
+		lightBlock.advance();
+		lightBuffer.advance();
+		clusters.build(camera, otherLights);
 
 		// layout 140 explenation
 		// https://registry.khronos.org/OpenGL/extensions/ARB/ARB_uniform_buffer_object.txt
-
-		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-		auto size = static_cast<GLint>(directionalLights.size());
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, 4, &size);
-		size = static_cast<GLint>(otherLights.size());
-		glBufferSubData(GL_UNIFORM_BUFFER, 4, 4, &size);
-		offset += 16;
-
+		glm::vec4 block[uboSize / sizeof(glm::vec4)];
+		std::fill(std::begin(block), std::end(block), glm::vec4(0.0f));
+		GLint counts[4] = { static_cast<GLint>(directionalLights.size()), static_cast<GLint>(otherLights.size()), 0, 0 };
+		const glm::uvec4 grid(LightClusters::TILES_X, LightClusters::TILES_Y, LightClusters::SLICES, 0);
+		std::memcpy(glm::value_ptr(block[0]), counts, sizeof(counts));
+		std::memcpy(glm::value_ptr(block[1]), glm::value_ptr(grid), sizeof(grid));
+		block[2] = clusters.getParameters();
 		for (unsigned int i = 0; i < directionalLights.size(); i++)
+			std::memcpy(glm::value_ptr(block[3 + i * 2]), directionalLights[i].get(), sizeof(DirectionalLight));
+		if (std::memcmp(blockData.data(), block, sizeof(block)) != 0)
 		{
-			glBufferSubData(GL_UNIFORM_BUFFER, offset, 16, glm::value_ptr(directionalLights[i].get()->dir));
-			offset += 16;
-			glBufferSubData(GL_UNIFORM_BUFFER, offset, 16, glm::value_ptr(directionalLights[i].get()->color));
-			offset += 16;
+			std::memcpy(blockData.data(), block, sizeof(block));
+			blockDirty = StreamBuffer::FRAMES;
 		}
-		offset += (MAX_DIRECTIONAL_LIGHTS - static_cast<int>(directionalLights.size())) * 32;
+		if (blockDirty > 0)
+		{
+			lightBlock.write(0, blockData.data(), uboSize);
+			blockDirty--;
+		}
+		lightBlock.bind(0, uboSize);
 
-		for (unsigned int i = 0; i < otherLights.size(); i++)
+		const size_t lightCount = otherLights.size();
+		const size_t lightVectors = sizeof(OtherLight) / sizeof(glm::vec4);
+		packLights(otherLights, lightData, lightDirty);
+
+		// Runs of dirty lights are written with one copy.
+		for (size_t i = 0; i < lightCount;)
 		{
-			glBufferSubData(GL_UNIFORM_BUFFER, offset, 16, glm::value_ptr(otherLights[i].get()->pos));
-			offset += 16;
-			glBufferSubData(GL_UNIFORM_BUFFER, offset, 16, glm::value_ptr(otherLights[i].get()->color));
-			offset += 16;
-			glBufferSubData(GL_UNIFORM_BUFFER, offset, 16, glm::value_ptr(otherLights[i].get()->dir));
-			offset += 16;
-			glBufferSubData(GL_UNIFORM_BUFFER, offset, 16, glm::value_ptr(otherLights[i].get()->angles));
-			offset += 16;
+			if (lightDirty[i] == 0)
+			{
+				i++;
+				continue;
+			}
+			size_t end = i;
+			while (end < lightCount && lightDirty[end] > 0)
+				lightDirty[end++]--;
+			lightBuffer.write(i * sizeof(OtherLight), &lightData[i * lightVectors], (end - i) * sizeof(OtherLight));
+			i = end;
 		}
+		lightBuffer.bind(LightClusters::LIGHTS_BINDING, lightCount * sizeof(OtherLight));
+
+		clusters.upload();
 
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		uploadStats = clusters.getUploadStats();
+		for (StreamBuffer* buffer : { &lightBlock, &lightBuffer })
+		{
+			uploadStats.bytes += buffer->getStats().bytes;
+			uploadStats.calls += buffer->getStats().calls;
+			buffer->resetStats();
+		}
 	}
 
-	void World::drawPointLights(const Camera& camera, Shader& shader, GLuint vao, GLuint size) const
+	void World::submitPointLights(const Camera& camera, InstanceBatch& batch, Shader& shader, GLuint vao, GLuint size) const
 	{
-		shader.use();
-		glBindVertexArray(vao);
-		shader.bind("view", camera.getViewMatrix());
-		shader.bind("projection", camera.getProjectionMatrix());
-
+		// One instanced draw for all cubes, the sort key does not need a depth.
+		DrawPacket packet;
+		packet.key = RenderQueue::makeKey(0, false, shader.getSerial(), 0, vao, 0.0f);
+		packet.shader = &shader;
+		packet.material = nullptr;
+		packet.vertexArray = vao;
+		packet.object = RenderQueue::NO_OBJECT;
+		packet.state = 0;
+		packet.mode = GL_TRIANGLES;
+		packet.indexType = 0;
+		packet.baseVertex = 0;
+		packet.first = 0;
+		packet.count = size;
+		packet.instanceCount = 0;
+		packet.baseInstance = 0;
+		packet.indirect = nullptr;
+
+		// Light cubes are unit cubes scaled by 0.2.
+		const Frustum frustum = camera.getFrustum();
+		const float radius = 0.1f * 1.7321f;
 		for (unsigned int i = 0; i < otherLights.size(); i++)
 		{
-			glm::mat4 model(1.0f);
-			glm::vec3 position(otherLights[i].get()->pos);
-			model = glm::translate(model, position);
+			const OtherLight& light = *otherLights[i];
+			const glm::vec3 position(light.pos);
+			if (!frustum.intersectsSphere(position, radius))
+				continue;
+
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
 			model = glm::scale(model, glm::vec3(0.2f));
-			shader.bind("model", model);
-			glDrawArrays(GL_TRIANGLES, 0, size);
+			batch.add(packet, InstanceData::make(model, glm::vec4(light.color, 1.0f)));
 		}
-
-		glBindVertexArray(0);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "blockCompression.hpp"
+#include "bakedTexture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Simp
+{
+	namespace
+	{
+		const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// Principal axis of the texels through power iteration on the covariance matrix.
+		template<int N>
+		void principalAxis(const uint8_t texels[64], float mean[N], float axis[N])
+		{
+			for (int c = 0; c < N; c++)
+			{
+				mean[c] = 0.0f;
+				for (int i = 0; i < 16; i++)
+					mean[c] += texels[i * 4 + c];
+				mean[c] /= 16.0f;
+			}
+
+			float covariance[N][N] = {};
+			for (int i = 0; i < 16; i++)
+			{
+				float d[N];
+				for (int c = 0; c < N; c++)
+					d[c] = texels[i * 4 + c] - mean[c];
+				for (int a = 0; a < N; a++)
+					for (int b = 0; b < N; b++)
+						covariance[a][b] += d[a] * d[b];
+			}
+
+			for (int c = 0; c < N; c++)
+				axis[c] = 1.0f;
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				float next[N] = {};
+				float length = 0.0f;
+				for (int a = 0; a < N; a++)
+				{
+					for (int b = 0; b < N; b++)
+						next[a] += covariance[a][b] * axis[b];
+					length += next[a] * next[a];
+				}
+				if (length < 1e-12f)
+					break;
+				length = std::sqrt(length);
+				for (int c = 0; c < N; c++)
+					axis[c] = next[c] / length;
+			}
+		}
+
+		// Endpoints at the extremes of the texels projected onto the principal axis.
+		template<int N>
+		void fitEndpoints(const uint8_t texels[64], float e0[N], float e1[N])
+		{
+			float mean[N];
+			float axis[N];
+			principalAxis<N>(texels, mean, axis);
+
+			float minT = 0.0f;
+			float maxT = 0.0f;
+			for (int i = 0; i < 16; i++)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < N; c++)
+					t += (texels[i * 4 + c] - mean[c]) * axis[c];
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+
+			for (int c = 0; c < N; c++)
+			{
+				e0[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+				e1[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+			}
+		}
+
+		uint16_t packRGB565(const float color[3])
+		{
+			int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+			int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+			int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		void unpackRGB565(uint16_t packed, int color[3])
+		{
+			int r = (packed >> 11) & 31;
+			int g = (packed >> 5) & 63;
+			int b = packed & 31;
+			color[0] = (r << 3) | (r >> 2);
+			color[1] = (g << 2) | (g >> 4);
+			color[2] = (b << 3) | (b >> 2);
+		}
+
+		void encodeBC1(const uint8_t texels[64], uint8_t* block)
+		{
+			float e0[3];
+			float e1[3];
+			fitEndpoints<3>(texels, e0, e1);
+
+			uint16_t c0 = packRGB565(e0);
+			uint16_t c1 = packRGB565(e1);
+			// c0 > c1 selects the four color mode without punch through alpha.
+			if (c0 < c1)
+				std::swap(c0, c1);
+
+			uint32_t indices = 0;
+			if (c0 != c1)
+			{
+				int palette[4][3];
+				unpackRGB565(c0, palette[0]);
+				unpackRGB565(c1, palette[1]);
+				for (int c = 0; c < 3; c++)
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+
+				for (int i = 0; i < 16; i++)
+				{
+					int best = 0;
+					int bestError = 1 << 30;
+					for (int p = 0; p < 4; p++)
+					{
+						int error = 0;
+						for (int c = 0; c < 3; c++)
+						{
+							int d = texels[i * 4 + c] - palette[p][c];
+							error += d * d;
+						}
+						if (error < bestError)
+						{
+							bestError = error;
+							best = p;
+						}
+					}
+					indices |= static_cast<uint32_t>(best) << (2 * i);
+				}
+			}
+
+			block[0] = static_cast<uint8_t>(c0 & 0xff);
+			block[1] = static_cast<uint8_t>(c0 >> 8);
+			block[2] = static_cast<uint8_t>(c1 & 0xff);
+			block[3] = static_cast<uint8_t>(c1 >> 8);
+			for (int i = 0; i < 4; i++)
+				block[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+		}
+
+		// Single channel block, shared by BC3 alpha, BC4 and both BC5 channels.
+		void encodeBC4(const uint8_t texels[64], int channel, uint8_t* block)
+		{
+			int maxValue = 0;
+			int minValue = 255;
+			for (int i = 0; i < 16; i++)
+			{
+				maxValue = std::max<int>(maxValue, texels[i * 4 + channel]);
+				minValue = std::min<int>(minValue, texels[i * 4 + channel]);
+			}
+
+			uint64_t indices = 0;
+			if (maxValue != minValue)
+			{
+				// r0 > r1 selects the mode with six interpolated values.
+				int palette[8];
+				palette[0] = maxValue;
+				palette[1] = minValue;
+				for (int i = 1; i < 7; i++)
+					palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7;
+
+				for (int i = 0; i < 16; i++)
+				{
+					int best = 0;
+					int bestError = 1 << 30;
+					for (int p = 0; p < 8; p++)
+					{
+						int error = std::abs(texels[i * 4 + channel] - palette[p]);
+						if (error < bestError)
+						{
+							bestError = error;
+							best = p;
+						}
+					}
+					indices |= static_cast<uint64_t>(best) << (3 * i);
+				}
+			}
+
+			block[0] = static_cast<uint8_t>(maxValue);
+			block[1] = static_cast<uint8_t>(minValue);
+			for (int i = 0; i < 6; i++)
+				block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+		}
+
+		struct BitWriter
+		{
+			uint8_t* data;
+			int position;
+
+			void write(uint32_t value, int count)
+			{
+				for (int i = 0; i < count; i++, position++)
+				{
+					if ((value >> i) & 1u)
+						data[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+				}
+			}
+		};
+
+		// 7 bit endpoint plus a p-bit shared by all channels of that endpoint.
+		void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pbit)
+		{
+			int bestError = 1 << 30;
+			for (int p = 0; p < 2; p++)
+			{
+				int candidate[4];
+				int error = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					candidate[c] = static_cast<int>(std::floor((endpoint[c] - p) * 0.5f + 0.5f));
+					candidate[c] = std::min(std::max(candidate[c], 0), 127);
+					int d = ((candidate[c] << 1) | p) - static_cast<int>(endpoint[c] + 0.5f);
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					pbit = p;
+					std::memcpy(quantized, candidate, sizeof(candidate));
+				}
+			}
+		}
+
+		void encodeBC7(const uint8_t texels[64], uint8_t* block)
+		{
+			float e0[4];
+			float e1[4];
+			fitEndpoints<4>(texels, e0, e1);
+
+			int q0[4];
+			int q1[4];
+			int p0 = 0;
+			int p1 = 0;
+			quantizeBC7Endpoint(e0, q0, p0);
+			quantizeBC7Endpoint(e1, q1, p1);
+
+			int palette[16][4];
+			for (int c = 0; c < 4; c++)
+			{
+				int d0 = (q0[c] << 1) | p0;
+				int d1 = (q1[c] << 1) | p1;
+				for (int w = 0; w < 16; w++)
+					palette[w][c] = ((64 - BC7_WEIGHTS[w]) * d0 + BC7_WEIGHTS[w] * d1 + 32) >> 6;
+			}
+
+			int indices[16];
+			for (int i = 0; i < 16; i++)
+			{
+				int bestError = 1 << 30;
+				for (int w = 0; w < 16; w++)
+				{
+					int error = 0;
+					for (int c = 0; c < 4; c++)
+					{
+						int d = texels[i * 4 + c] - palette[w][c];
+						error += d * d;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						indices[i] = w;
+					}
+				}
+			}
+
+			// The anchor index is stored without its top bit, so it has to be below 8.
+			if (indices[0] >= 8)
+			{
+				std::swap(q0, q1);
+				std::swap(p0, p1);
+				for (int i = 0; i < 16; i++)
+					indices[i] = 15 - indices[i];
+			}
+
+			std::memset(block, 0, 16);
+			BitWriter writer = { block, 0 };
+			writer.write(1u << 6, 7);
+			for (int c = 0; c < 4; c++)
+			{
+				writer.write(q0[c], 7);
+				writer.write(q1[c], 7);
+			}
+			writer.write(p0, 1);
+			writer.write(p1, 1);
+			writer.write(indices[0], 3);
+			for (int i = 1; i < 16; i++)
+				writer.write(indices[i], 4);
+		}
+	}
+
+	size_t getBlockSize(BlockFormat format)
+	{
+		return format == BC1 || format == BC4 ? 8 : 16;
+	}
+
+	uint32_t getGLFormat(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case BC4: return GL_COMPRESSED_RED_RGTC1;
+		case BC5: return GL_COMPRESSED_RG_RGTC2;
+		case BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+		return 0;
+	}
+
+	const char* getFormatName(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BC1: return "BC1";
+		case BC3: return "BC3";
+		case BC4: return "BC4";
+		case BC5: return "BC5";
+		case BC7: return "BC7";
+		}
+		return "?";
+	}
+
+	void encodeBlock(BlockFormat format, const uint8_t texels[64], uint8_t* block)
+	{
+		switch (format)
+		{
+		case BC1:
+			encodeBC1(texels, block);
+			break;
+		case BC3:
+			encodeBC4(texels, 3, block);
+			encodeBC1(texels, block + 8);
+			break;
+		case BC4:
+			encodeBC4(texels, 0, block);
+			break;
+		case BC5:
+			encodeBC4(texels, 0, block);
+			encodeBC4(texels, 1, block + 8);
+			break;
+		case BC7:
+			encodeBC7(texels, block);
+			break;
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Simp
+{
+	enum BlockFormat
+	{
+		BC1 = 0, // RGB, 4 bpp
+		BC3 = 1, // RGBA with separate alpha block, 8 bpp
+		BC4 = 2, // R, 4 bpp
+		BC5 = 3, // RG, 8 bpp, used for tangent space normal maps
+		BC7 = 4  // RGBA, 8 bpp, mode 6 only
+	};
+
+	size_t getBlockSize(BlockFormat format);
+	uint32_t getGLFormat(BlockFormat format);
+	const char* getFormatName(BlockFormat format);
+
+	// Encodes a 4x4 block of RGBA8 texels stored row by row.
+	void encodeBlock(BlockFormat format, const uint8_t texels[64], uint8_t* block);
+}
@@ -0,0 +1,290 @@
+// simp_texbake - bakes images into block compressed .stex files with a precomputed mip chain.
+//
+// usage: simp_texbake [--format bc1|bc3|bc4|bc5|bc7] [--normal] [--linear] [--no-flip]
+//                     [--threads N] image...
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "bakedTexture.hpp"
+#include "blockCompression.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		int format = -1;
+		bool normal = false;
+		bool linear = false;
+		bool flip = true;
+		unsigned int threads = 0;
+	};
+
+	struct Level
+	{
+		int width;
+		int height;
+		std::vector<float> texels; // RGBA, linear
+	};
+
+	float decodeSRGB(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float encodeSRGB(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t toByte(float value)
+	{
+		return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	bool isNormalMap(const std::string& path)
+	{
+		std::string lower = path;
+		std::transform(lower.begin(), lower.end(), lower.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return lower.find("normal") != std::string::npos;
+	}
+
+	// Box filter into the next level, color is filtered in linear space and normals are renormalized.
+	Level downsample(const Level& source, bool normal)
+	{
+		Level level;
+		level.width = std::max(source.width / 2, 1);
+		level.height = std::max(source.height / 2, 1);
+		level.texels.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+		for (int y = 0; y < level.height; y++)
+		{
+			for (int x = 0; x < level.width; x++)
+			{
+				float sum[4] = {};
+				for (int dy = 0; dy < 2; dy++)
+				{
+					for (int dx = 0; dx < 2; dx++)
+					{
+						int sx = std::min(x * 2 + dx, source.width - 1);
+						int sy = std::min(y * 2 + dy, source.height - 1);
+						const float* texel = &source.texels[(static_cast<size_t>(sy) * source.width + sx) * 4];
+						for (int c = 0; c < 4; c++)
+							sum[c] += texel[c] * 0.25f;
+					}
+				}
+
+				if (normal)
+				{
+					float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+					if (length > 1e-6f)
+					{
+						for (int c = 0; c < 3; c++)
+							sum[c] /= length;
+					}
+				}
+
+				std::memcpy(&level.texels[(static_cast<size_t>(y) * level.width + x) * 4], sum, sizeof(sum));
+			}
+		}
+		return level;
+	}
+
+	std::vector<uint8_t> encodeLevel(const Level& level, Simp::BlockFormat format, bool srgb, bool normal,
+									 unsigned int threads)
+	{
+		const int blocksX = (level.width + 3) / 4;
+		const int blocksY = (level.height + 3) / 4;
+		const size_t blockSize = Simp::getBlockSize(format);
+		std::vector<uint8_t> data(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+		Simp::parallelFor(0, blocksY, [&](size_t by)
+		{
+			uint8_t texels[64];
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					// Clamp to the edge for levels that are not a multiple of four.
+					int x = std::min(bx * 4 + (i & 3), level.width - 1);
+					int y = std::min(static_cast<int>(by) * 4 + (i >> 2), level.height - 1);
+					const float* texel = &level.texels[(static_cast<size_t>(y) * level.width + x) * 4];
+					for (int c = 0; c < 3; c++)
+					{
+						float value = texel[c];
+						if (normal)
+							value = value * 0.5f + 0.5f;
+						else if (srgb)
+							value = encodeSRGB(value);
+						texels[i * 4 + c] = toByte(value);
+					}
+					texels[i * 4 + 3] = toByte(texel[3]);
+				}
+				Simp::encodeBlock(format, texels, &data[(by * blocksX + bx) * blockSize]);
+			}
+		}, 1, threads);
+
+		return data;
+	}
+
+	bool bake(const std::string& path, const Options& options)
+	{
+		int width;
+		int height;
+		int channelNum;
+		stbi_set_flip_vertically_on_load(options.flip);
+		unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channelNum, 4);
+		if (pixels == nullptr)
+		{
+			std::cerr << "ERROR::TEXBAKE::LOAD_FAILED " << path << ": " << stbi_failure_reason() << std::endl;
+			return false;
+		}
+
+		const bool normal = options.normal || (options.format < 0 && isNormalMap(path));
+		const bool srgb = !normal && !options.linear && channelNum >= 3;
+
+		Simp::BlockFormat format = Simp::BC7;
+		if (options.format >= 0)
+			format = static_cast<Simp::BlockFormat>(options.format);
+		else if (normal)
+			format = Simp::BC5;
+		// Gray with alpha is expanded to RGBA on load and keeps its alpha in BC7.
+		else if (channelNum == 1)
+			format = Simp::BC4;
+
+		auto start = std::chrono::steady_clock::now();
+
+		Level level;
+		level.width = width;
+		level.height = height;
+		level.texels.resize(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < level.texels.size(); i++)
+		{
+			float value = pixels[i] / 255.0f;
+			bool color = (i & 3) != 3;
+			if (color && normal)
+				value = value * 2.0f - 1.0f;
+			else if (color && srgb)
+				value = decodeSRGB(value);
+			level.texels[i] = value;
+		}
+		stbi_image_free(pixels);
+
+		std::vector<Simp::BakedMipLevel> mips;
+		std::vector<std::vector<uint8_t>> mipData;
+		for (;;)
+		{
+			mipData.push_back(encodeLevel(level, format, srgb, normal, options.threads));
+
+			Simp::BakedMipLevel mip;
+			mip.width = static_cast<uint32_t>(level.width);
+			mip.height = static_cast<uint32_t>(level.height);
+			mip.size = static_cast<uint32_t>(mipData.back().size());
+			mips.push_back(mip);
+
+			if (level.width == 1 && level.height == 1)
+				break;
+			level = downsample(level, normal);
+		}
+
+		Simp::BakedTextureHeader header;
+		header.magic = Simp::BAKED_TEXTURE_MAGIC;
+		header.version = Simp::BAKED_TEXTURE_VERSION;
+		header.format = Simp::getGLFormat(format);
+		header.width = static_cast<uint32_t>(width);
+		header.height = static_cast<uint32_t>(height);
+		header.mipCount = static_cast<uint32_t>(mips.size());
+		header.flags = (options.flip ? Simp::BAKED_FLIPPED : 0u) |
+			(normal ? Simp::BAKED_NORMAL_MAP : 0u) |
+			(srgb ? Simp::BAKED_SRGB : 0u) |
+			(channelNum == 2 || channelNum == 4 ? Simp::BAKED_ALPHA : 0u);
+		header.reserved = 0;
+
+		const std::string output = Simp::bakedTexturePath(path);
+		std::ofstream stream(output, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(mips.data()), mips.size() * sizeof(Simp::BakedMipLevel));
+		size_t bakedBytes = 0;
+		for (const auto& data : mipData)
+		{
+			stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+			bakedBytes += data.size();
+		}
+		if (!stream)
+		{
+			std::cerr << "ERROR::TEXBAKE::WRITE_FAILED " << output << std::endl;
+			return false;
+		}
+
+		// Uncompressed textures end up as RGBA8 in VRAM, plus a third for runtime generated mips.
+		const double sourceBytes = static_cast<double>(width) * height * 4 * 4 / 3;
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << output << ": " << width << "x" << height << ", " << mips.size() << " mips, "
+			<< Simp::getFormatName(format) << (srgb ? " (sRGB mips)" : "") << ", "
+			<< sourceBytes / (1024.0 * 1024.0) << " MiB -> " << bakedBytes / (1024.0 * 1024.0) << " MiB ("
+			<< sourceBytes / bakedBytes << "x) in " << seconds << " s" << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			const char* names[] = { "bc1", "bc3", "bc4", "bc5", "bc7" };
+			for (int f = 0; f < 5; f++)
+			{
+				if (name == names[f])
+					options.format = f;
+			}
+			if (options.format < 0)
+			{
+				std::cerr << "Unknown format " << name << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--normal")
+			options.normal = true;
+		else if (arg == "--linear")
+			options.linear = true;
+		else if (arg == "--no-flip")
+			options.flip = false;
+		else if (arg == "--threads" && i + 1 < argc)
+			options.threads = static_cast<unsigned int>(std::atoi(argv[++i]));
+		else
+			paths.push_back(arg);
+	}
+
+	if (paths.empty())
+	{
+		std::cerr << "usage: simp_texbake [--format bc1|bc3|bc4|bc5|bc7] [--normal] [--linear] [--no-flip] "
+			"[--threads N] image..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success = true;
+	for (const auto& path : paths)
+	{
+		success &= bake(path, options);
+	}
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}